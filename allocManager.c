@@ -0,0 +1,257 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "utils.h"
+
+#undef stringMalloc
+#undef stringRealloc
+#undef stringCalloc
+#undef memoryMalloc
+#undef memoryRealloc
+#undef memoryCalloc
+
+/**
+ * The maximum amount of different call sites (per stage) that can be profiled.
+ */
+#define SITE_SLOTS 4096
+
+/**
+ * The amount of blocks whose realloc chain is remembered: the slot of a block is chosen by its
+ * address, so a block can only lose its chain when another live block takes its slot.
+ */
+#define BLOCK_SLOTS 65536
+
+typedef struct {
+    const char *site;
+    const char *stage;
+    uint64_t allocations;
+    uint64_t reallocations;
+    uint64_t bytes;
+    uint64_t movedBytes;
+    size_t largest;
+    unsigned longestChain;
+} SITE_PROFILE;
+
+typedef struct {
+    const void *pointer;
+    unsigned chain;
+} BLOCK_PROFILE;
+
+static pthread_mutex_t profileLock = PTHREAD_MUTEX_INITIALIZER;
+static SITE_PROFILE sites[SITE_SLOTS];
+static BLOCK_PROFILE blocks[BLOCK_SLOTS];
+static int nSites = 0;
+static int reportRegistered = 0;
+static size_t peakLiveBytes = 0;
+static const char *peakSite = NULL;
+
+/**
+ * The stage the allocations of the calling thread are labelled with, or NULL.
+ */
+static __thread const char *allocStage = NULL;
+
+/**
+ * Labels the next allocations of the calling thread with the given stage (e.g. "keys" or "file"),
+ * so that the same call site is reported once per stage.
+ */
+void setAllocStage(const char *stage) {
+    allocStage = stage;
+}
+
+/**
+ * Returns the given call site without the directories of its file.
+ */
+static const char *getSiteName(const char *site) {
+    const char *name = strrchr(site, '/');
+    return name != NULL ? name + 1 : site;
+}
+
+/**
+ * Returns the SITE_PROFILE of the given call site and stage, creating it the first time, or NULL
+ * if there are too many call sites.
+ */
+static SITE_PROFILE *getSiteProfile(const char *site, const char *stage) {
+    uint32_t hash = 2166136261u;
+    for (const char *c = site; *c != '\0'; c++)
+        hash = (hash ^ (unsigned char) *c) * 16777619u;
+    for (const char *c = stage != NULL ? stage : ""; *c != '\0'; c++)
+        hash = (hash ^ (unsigned char) *c) * 16777619u;
+
+    for (int probe = 0; probe < SITE_SLOTS; probe++) {
+        SITE_PROFILE *profile = &sites[(hash + probe) % SITE_SLOTS];
+        if (profile->site == NULL) {
+            profile->site = site;
+            profile->stage = stage;
+            nSites++;
+            return profile;
+        }
+        if (strcmp(profile->site, site) == 0 &&
+            (profile->stage == stage || (profile->stage != NULL && stage != NULL && strcmp(profile->stage, stage) == 0)))
+            return profile;
+    }
+    return NULL;
+}
+
+/**
+ * Returns the slot of the block with the given address.
+ */
+static BLOCK_PROFILE *getBlockProfile(const void *pointer) {
+    uintptr_t address = (uintptr_t) pointer >> 4;
+    return &blocks[(address ^ address >> 16) % BLOCK_SLOTS];
+}
+
+/**
+ * Compares two SITE_PROFILEs by their bytes, in descending order.
+ */
+static int compareSiteBytes(const void *first, const void *second) {
+    const SITE_PROFILE *a = first, *b = second;
+    return a->bytes < b->bytes ? 1 : a->bytes > b->bytes ? -1 : 0;
+}
+
+/**
+ * Prints the allocation profile to the standard error, when the program ends: the peak of the
+ * live heap (with the call site that reached it) and the maximum resident set size, followed by
+ * every call site and stage, sorted by the bytes they requested.
+ */
+static void printAllocProfile() {
+    SITE_PROFILE *sorted = malloc(SITE_SLOTS * sizeof(SITE_PROFILE));
+    struct rusage usage;
+    int n = 0;
+
+    if (sorted == NULL)
+        return;
+    pthread_mutex_lock(&profileLock);
+    for (int slot = 0; slot < SITE_SLOTS; slot++)
+        if (sites[slot].site != NULL)
+            sorted[n++] = sites[slot];
+    pthread_mutex_unlock(&profileLock);
+    qsort(sorted, n, sizeof(SITE_PROFILE), compareSiteBytes);
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(stderr, "\nALLOCATION PROFILE\n");
+    fprintf(stderr, "peak live heap: %zu bytes (at %s), max RSS: %ld KB\n", peakLiveBytes,
+            peakSite != NULL ? getSiteName(peakSite) : "-", usage.ru_maxrss);
+    fprintf(stderr, "%-28s %-10s %10s %10s %14s %12s %14s %6s\n", "site", "stage", "allocs", "reallocs", "bytes",
+            "largest", "moved", "chain");
+    for (int i = 0; i < n; i++)
+        fprintf(stderr, "%-28s %-10s %10llu %10llu %14llu %12zu %14llu %6u\n", getSiteName(sorted[i].site),
+                sorted[i].stage != NULL ? sorted[i].stage : "-", (unsigned long long) sorted[i].allocations,
+                (unsigned long long) sorted[i].reallocations, (unsigned long long) sorted[i].bytes, sorted[i].largest,
+                (unsigned long long) sorted[i].movedBytes, sorted[i].longestChain);
+    free(sorted);
+}
+
+/**
+ * Records an allocation of the given call site. A reallocation continues the chain of the
+ * reallocated block (a block allocated from scratch starts a new one): its length is the amount
+ * of reallocations the block went through, and the bytes of the block are counted as moved when
+ * the reallocation returned a different address. The live heap is sampled after every allocation
+ * to keep its peak.
+ *
+ * @param site - the call site of the allocation ("file:line")
+ * @param pointer - the allocated block
+ * @param size - the requested size
+ * @param previous - the reallocated block, or NULL
+ * @param previousSize - the usable size of the reallocated block
+ */
+static void recordAllocation(const char *site, const void *pointer, size_t size, const void *previous,
+                             size_t previousSize) {
+    struct mallinfo2 info = mallinfo2();
+    size_t liveBytes = info.uordblks + info.hblkhd;
+    unsigned chain = 0;
+
+    pthread_mutex_lock(&profileLock);
+    if (!reportRegistered) {
+        atexit(printAllocProfile);
+        reportRegistered = 1;
+    }
+    if (previous != NULL) {
+        BLOCK_PROFILE *block = getBlockProfile(previous);
+        chain = block->pointer == previous ? block->chain + 1 : 1;
+        block->pointer = NULL;
+    }
+    BLOCK_PROFILE *block = getBlockProfile(pointer);
+    block->pointer = pointer;
+    block->chain = chain;
+
+    SITE_PROFILE *profile = getSiteProfile(site, allocStage);
+    if (profile != NULL) {
+        if (previous != NULL) {
+            profile->reallocations++;
+            if (pointer != previous)
+                profile->movedBytes += previousSize;
+        } else profile->allocations++;
+        profile->bytes += size;
+        if (size > profile->largest)
+            profile->largest = size;
+        if (chain > profile->longestChain)
+            profile->longestChain = chain;
+    }
+    if (liveBytes > peakLiveBytes) {
+        peakLiveBytes = liveBytes;
+        peakSite = site;
+    }
+    pthread_mutex_unlock(&profileLock);
+}
+
+/**
+ * Profiled version of @stringMalloc(), labelled with its call site.
+ */
+char *profileMalloc(size_t size, const char *site) {
+    char *newString = stringMalloc(size);
+    recordAllocation(site, newString, size, NULL, 0);
+    return newString;
+}
+
+/**
+ * Profiled version of @stringRealloc(), labelled with its call site.
+ */
+char *profileRealloc(char *in, size_t size, const char *site) {
+    size_t previousSize = in != NULL ? malloc_usable_size(in) : 0;
+    char *reallocatedString = stringRealloc(in, size);
+    recordAllocation(site, reallocatedString, size, in, previousSize);
+    return reallocatedString;
+}
+
+/**
+ * Profiled version of @stringCalloc(), labelled with its call site.
+ */
+char *profileCalloc(size_t size, const char *site) {
+    char *newString = stringCalloc(size);
+    recordAllocation(site, newString, size, NULL, 0);
+    return newString;
+}
+
+/**
+ * Profiled version of @memoryMalloc(), labelled with its call site.
+ */
+void *profileMemoryMalloc(size_t size, const char *site) {
+    void *block = memoryMalloc(size);
+    recordAllocation(site, block, size, NULL, 0);
+    return block;
+}
+
+/**
+ * Profiled version of @memoryRealloc(), labelled with its call site.
+ */
+void *profileMemoryRealloc(void *in, size_t size, const char *site) {
+    size_t previousSize = in != NULL ? malloc_usable_size(in) : 0;
+    void *block = memoryRealloc(in, size);
+    recordAllocation(site, block, size, in, previousSize);
+    return block;
+}
+
+/**
+ * Profiled version of @memoryCalloc(), labelled with its call site.
+ */
+void *profileMemoryCalloc(size_t count, size_t size, const char *site) {
+    void *block = memoryCalloc(count, size);
+    recordAllocation(site, block, count * size, NULL, 0);
+    return block;
+}
@@ -0,0 +1,41 @@
+
+#ifndef PLAYFAIR_ALLOCMANAGER_H
+#define PLAYFAIR_ALLOCMANAGER_H
+
+#include <stddef.h>
+
+#ifdef PLAYFAIR_ALLOC_PROFILE
+
+#define ALLOC_STRING(value) #value
+#define ALLOC_SITE_AT(line) __FILE__ ":" ALLOC_STRING(line)
+#define ALLOC_SITE ALLOC_SITE_AT(__LINE__)
+
+#define stringMalloc(size) profileMalloc(size, ALLOC_SITE)
+#define stringRealloc(in, size) profileRealloc(in, size, ALLOC_SITE)
+#define stringCalloc(size) profileCalloc(size, ALLOC_SITE)
+#define memoryMalloc(size) profileMemoryMalloc(size, ALLOC_SITE)
+#define memoryRealloc(in, size) profileMemoryRealloc(in, size, ALLOC_SITE)
+#define memoryCalloc(count, size) profileMemoryCalloc(count, size, ALLOC_SITE)
+#define ALLOC_STAGE(stage) setAllocStage(stage)
+
+char *profileMalloc(size_t size, const char *site);
+
+char *profileRealloc(char *in, size_t size, const char *site);
+
+char *profileCalloc(size_t size, const char *site);
+
+void *profileMemoryMalloc(size_t size, const char *site);
+
+void *profileMemoryRealloc(void *in, size_t size, const char *site);
+
+void *profileMemoryCalloc(size_t count, size_t size, const char *site);
+
+void setAllocStage(const char *stage);
+
+#else
+
+#define ALLOC_STAGE(stage) ((void) 0)
+
+#endif
+
+#endif //PLAYFAIR_ALLOCMANAGER_H
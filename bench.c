@@ -0,0 +1,525 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "keyFileManager.h"
+#include "matrixManager.h"
+#include "cipherManager.h"
+#include "streamManager.h"
+
+/**
+ * The maximum amount of values of every dimension of the matrix.
+ */
+#define MAX_VALUES 16
+
+/**
+ * The size of the blocks the synthetic input files are generated with.
+ */
+#define GENERATION_BLOCK (1 << 20)
+
+/**
+ * The characters the non-letters of the synthetic input are chosen from.
+ */
+static const char nonLetters[] = " .,;:!?'-0123456789\n";
+
+typedef struct {
+    size_t values[MAX_VALUES];
+    int count;
+} SIZE_LIST;
+
+typedef struct {
+    double values[MAX_VALUES];
+    int count;
+} RATIO_LIST;
+
+typedef struct {
+    const char *operation;
+    size_t size;
+    double nonLetterRatio;
+    double doubleRatio;
+    size_t bufferSize;
+    int repeat;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+    double mbPerSecond;
+    long peakRssKb;
+} BENCH_RESULT;
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds.
+ */
+static uint64_t nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Returns the next value of the given xorshift64* generator, so that the synthetic inputs are
+ * the same on every run.
+ */
+static uint64_t nextRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717u;
+}
+
+/**
+ * Returns a random number in [0, 1) from the given generator.
+ */
+static double nextUniform(uint64_t *state) {
+    return (double) (nextRandom(state) >> 11) / 9007199254740992.0;
+}
+
+/**
+ * Parses a size with an optional K, M or G suffix (powers of 1024).
+ *
+ * @return the size, or 0 if it is not valid
+ */
+static size_t parseSize(const char *text) {
+    char *end;
+    double value = strtod(text, &end);
+    size_t unit = *end == 'K' || *end == 'k' ? 1u << 10 : *end == 'M' || *end == 'm' ? 1u << 20 :
+                  *end == 'G' || *end == 'g' ? 1u << 30 : 1;
+
+    if (end == text || value <= 0 || (unit > 1 && end[1] != '\0') || (unit == 1 && *end != '\0'))
+        return 0;
+    return (size_t) (value * (double) unit);
+}
+
+/**
+ * Parses a comma separated list of sizes (e.g. "1K,1M,4G").
+ *
+ * @return 0 if the list is valid, -1 otherwise
+ */
+static int parseSizeList(const char *text, SIZE_LIST *list) {
+    char *copy = strdup(text), *token, *rest = copy;
+
+    list->count = 0;
+    while ((token = strtok_r(rest, ",", &rest)) != NULL) {
+        if (list->count == MAX_VALUES || (list->values[list->count++] = parseSize(token)) == 0) {
+            free(copy);
+            return -1;
+        }
+    }
+    free(copy);
+    return list->count > 0 ? 0 : -1;
+}
+
+/**
+ * Parses a comma separated list of ratios in [0, 1] (e.g. "0,0.2,0.5").
+ *
+ * @return 0 if the list is valid, -1 otherwise
+ */
+static int parseRatioList(const char *text, RATIO_LIST *list) {
+    char *copy = strdup(text), *token, *rest = copy, *end;
+
+    list->count = 0;
+    while ((token = strtok_r(rest, ",", &rest)) != NULL) {
+        double value = strtod(token, &end);
+        if (list->count == MAX_VALUES || end == token || *end != '\0' || value < 0 || value > 1) {
+            free(copy);
+            return -1;
+        }
+        list->values[list->count++] = value;
+    }
+    free(copy);
+    return list->count > 0 ? 0 : -1;
+}
+
+/**
+ * Writes a synthetic input file of the given size: every character is a non-letter with the
+ * given probability, and every letter repeats the previous one with the given probability (so
+ * that the doubles needing the special character can be made rare or frequent).
+ *
+ * @return 0 if the file was written, -1 otherwise
+ */
+static int generateInput(const char *path, size_t size, double nonLetterRatio, double doubleRatio) {
+    FILE *file = fopen(path, "w");
+    char *block = malloc(GENERATION_BLOCK);
+    uint64_t state = 0x9E3779B97F4A7C15u ^ size;
+    char previous = 'a';
+
+    if (file == NULL || block == NULL) {
+        if (file != NULL) fclose(file);
+        free(block);
+        return -1;
+    }
+    for (size_t written = 0; written < size;) {
+        size_t length = size - written < GENERATION_BLOCK ? size - written : GENERATION_BLOCK;
+        for (size_t i = 0; i < length; i++) {
+            if (nextUniform(&state) < nonLetterRatio)
+                block[i] = nonLetters[nextRandom(&state) % (sizeof(nonLetters) - 1)];
+            else {
+                if (nextUniform(&state) >= doubleRatio)
+                    previous = (char) ('a' + nextRandom(&state) % 26);
+                block[i] = previous;
+            }
+        }
+        fwrite(block, sizeof(char), length, file);
+        written += length;
+    }
+    free(block);
+    int failed = ferror(file);
+    failed |= fclose(file) != 0;
+    return failed ? -1 : 0;
+}
+
+/**
+ * Resets the peak resident set size of the process (Linux only), so that it can be measured
+ * for every configuration.
+ */
+static void resetPeakRss() {
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+    if (file != NULL) {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+/**
+ * Returns the peak resident set size of the process in KB since the last @resetPeakRss(),
+ * or -1 if it cannot be read.
+ */
+static long getPeakRss() {
+    FILE *file = fopen("/proc/self/status", "r");
+    char line[256];
+    long peak = -1;
+
+    if (file == NULL)
+        return -1;
+    while (fgets(line, sizeof(line), file) != NULL)
+        if (strncmp(line, "VmHWM:", 6) == 0)
+            peak = strtol(line + 6, NULL, 10);
+    fclose(file);
+    return peak;
+}
+
+/**
+ * Encodes or decodes the given file into the given output with the stream of the program,
+ * opening and closing both files, as a single file of a batch does.
+ *
+ * @return the time of the run, or 0 if it failed
+ */
+static uint64_t runOnce(const char *inputPath, const char *outputPath, const CIPHER_TABLE *table, size_t bufferSize) {
+    uint64_t start = nowNanoseconds();
+    FILE *in = fopen(inputPath, "r");
+    FILE *out = fopen(outputPath, "w");
+    CIPHER_STREAM stream;
+
+    if (in == NULL || out == NULL) {
+        if (in != NULL) fclose(in);
+        if (out != NULL) fclose(out);
+        return 0;
+    }
+    initStream(&stream, table);
+    stream.bufferSize = bufferSize;
+    processStream(in, out, &stream, NULL);
+    int failed = ferror(in) || ferror(out);
+    failed |= fclose(out) != 0;
+    fclose(in);
+    return failed ? 0 : nowNanoseconds() - start;
+}
+
+static int compareLatencies(const void *a, const void *b) {
+    uint64_t first = *(const uint64_t *) a, second = *(const uint64_t *) b;
+    return (first > second) - (first < second);
+}
+
+/**
+ * Returns the given percentile of the given sorted latencies.
+ */
+static uint64_t percentile(const uint64_t *latencies, size_t size, double percent) {
+    return latencies[(size_t) (percent / 100.0 * (double) (size - 1) + 0.5)];
+}
+
+/**
+ * Runs a single configuration of the matrix the given amount of times and fills its result.
+ * The throughput refers to the median run, and the peak resident set size to all of them.
+ *
+ * @return 0 if every run succeeded, -1 otherwise
+ */
+static int runConfiguration(const char *inputPath, const char *outputPath, const CIPHER_TABLE *table,
+                            BENCH_RESULT *result) {
+    uint64_t *latencies = calloc(result->repeat, sizeof(uint64_t));
+
+    if (latencies == NULL)
+        return -1;
+    resetPeakRss();
+    for (int run = 0; run < result->repeat; run++)
+        if ((latencies[run] = runOnce(inputPath, outputPath, table, result->bufferSize)) == 0) {
+            free(latencies);
+            return -1;
+        }
+    result->peakRssKb = getPeakRss();
+    qsort(latencies, result->repeat, sizeof(uint64_t), compareLatencies);
+    result->p50 = percentile(latencies, result->repeat, 50);
+    result->p90 = percentile(latencies, result->repeat, 90);
+    result->p99 = percentile(latencies, result->repeat, 99);
+    result->max = latencies[result->repeat - 1];
+    result->mbPerSecond = (double) result->size / ((double) result->p50 / 1e9) / 1e6;
+    free(latencies);
+    return 0;
+}
+
+/**
+ * Writes the given results to a CSV file, which can be used as a baseline.
+ *
+ * @return 0 if the file was written, -1 otherwise
+ */
+static int writeCsv(const char *path, const BENCH_RESULT *results, int nResults) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return -1;
+    fprintf(file, "operation,size,non_letters,doubles,buffer,repeat,p50_ns,p90_ns,p99_ns,max_ns,mb_per_second,"
+                  "peak_rss_kb\n");
+    for (int i = 0; i < nResults; i++)
+        fprintf(file, "%s,%zu,%g,%g,%zu,%d,%llu,%llu,%llu,%llu,%.2f,%ld\n", results[i].operation, results[i].size,
+                results[i].nonLetterRatio, results[i].doubleRatio, results[i].bufferSize, results[i].repeat,
+                (unsigned long long) results[i].p50, (unsigned long long) results[i].p90,
+                (unsigned long long) results[i].p99, (unsigned long long) results[i].max, results[i].mbPerSecond,
+                results[i].peakRssKb);
+    return fclose(file) != 0 ? -1 : 0;
+}
+
+/**
+ * Writes the given results to a JSON file, as an array of records.
+ *
+ * @return 0 if the file was written, -1 otherwise
+ */
+static int writeJson(const char *path, const BENCH_RESULT *results, int nResults) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return -1;
+    fprintf(file, "[\n");
+    for (int i = 0; i < nResults; i++)
+        fprintf(file, "{\"operation\":\"%s\",\"size\":%zu,\"non_letters\":%g,\"doubles\":%g,\"buffer\":%zu,"
+                      "\"repeat\":%d,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu,"
+                      "\"mb_per_second\":%.2f,\"peak_rss_kb\":%ld}%s\n", results[i].operation, results[i].size,
+                results[i].nonLetterRatio, results[i].doubleRatio, results[i].bufferSize, results[i].repeat,
+                (unsigned long long) results[i].p50, (unsigned long long) results[i].p90,
+                (unsigned long long) results[i].p99, (unsigned long long) results[i].max, results[i].mbPerSecond,
+                results[i].peakRssKb, i + 1 < nResults ? "," : "");
+    fprintf(file, "]\n");
+    return fclose(file) != 0 ? -1 : 0;
+}
+
+/**
+ * Compares the given results with the baseline stored in the given CSV file (written by a previous
+ * run with "--csv"): a configuration regresses if its throughput is lower than the one of the
+ * baseline by more than the given percentage, or if its peak resident set size is higher by more
+ * than the given percentage. Every regression is printed, and the configurations that are not in
+ * the baseline are ignored.
+ *
+ * @return the number of regressions, or -1 if the baseline cannot be read
+ */
+static int compareBaseline(const char *path, const BENCH_RESULT *results, int nResults, double throughputThreshold,
+                           double rssThreshold) {
+    FILE *file = fopen(path, "r");
+    char line[512], operation[16];
+    int nRegressions = 0, nCompared = 0;
+
+    if (file == NULL || fgets(line, sizeof(line), file) == NULL) {
+        if (file != NULL) fclose(file);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        BENCH_RESULT base;
+        unsigned long long p50, p90, p99, max;
+        if (sscanf(line, "%15[^,],%zu,%lf,%lf,%zu,%d,%llu,%llu,%llu,%llu,%lf,%ld", operation, &base.size,
+                   &base.nonLetterRatio, &base.doubleRatio, &base.bufferSize, &base.repeat, &p50, &p90, &p99, &max,
+                   &base.mbPerSecond, &base.peakRssKb) != 12)
+            continue;
+        for (int i = 0; i < nResults; i++) {
+            const BENCH_RESULT *result = &results[i];
+            if (strcmp(result->operation, operation) != 0 || result->size != base.size ||
+                result->bufferSize != base.bufferSize || fabs(result->nonLetterRatio - base.nonLetterRatio) > 1e-9 ||
+                fabs(result->doubleRatio - base.doubleRatio) > 1e-9)
+                continue;
+            double throughputChange = (result->mbPerSecond / base.mbPerSecond - 1) * 100;
+            double rssChange = base.peakRssKb > 0 && result->peakRssKb >= 0 ?
+                               ((double) result->peakRssKb / (double) base.peakRssKb - 1) * 100 : 0;
+            nCompared++;
+            if (throughputChange < -throughputThreshold || rssChange > rssThreshold) {
+                printf("REGRESSION %s size %zu non-letters %g doubles %g buffer %zu: %.2f -> %.2f MB/s (%+.1f%%), "
+                       "peak RSS %ld -> %ld KB (%+.1f%%)\n", operation, result->size, result->nonLetterRatio,
+                       result->doubleRatio, result->bufferSize, base.mbPerSecond, result->mbPerSecond,
+                       throughputChange, base.peakRssKb, result->peakRssKb, rssChange);
+                nRegressions++;
+            }
+        }
+    }
+    fclose(file);
+    printf("baseline: %d configurations compared, %d regressions (thresholds: throughput -%.1f%%, "
+           "peak RSS +%.1f%%)\n", nCompared, nRegressions, throughputThreshold, rssThreshold);
+    return nRegressions;
+}
+
+/**
+ * Prints the syntax of the benchmark and ends the program.
+ */
+static void printSyntax(const char *program) {
+    fprintf(stderr, "Syntax: %s [--sizes <s1,...>] [--non-letters <r1,...>] [--doubles <r1,...>] "
+                    "[--buffers <b1,...>] [--repeat <n>] [--dir <dir>] [--key <keyfile>] [--csv <file>] "
+                    "[--json <file>] [--baseline <csv>] [--threshold <percent>] [--rss-threshold <percent>]\n",
+            program);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * An end-to-end benchmark of the encoding and decoding of files: for every combination of input
+ * size, ratio of non-letters, ratio of doubled letters and buffer size, a synthetic input file is
+ * generated in the work directory, encoded, and its encoded version decoded, the given amount of
+ * times each, through the same stream (and file I/O) the program uses. Every configuration reports
+ * the throughput of its median run, the latency percentiles of its runs and its peak resident
+ * set size. The results can be written to CSV and JSON files, and compared with a baseline CSV
+ * file: the program fails if any configuration regresses by more than the given thresholds.
+ *
+ * Syntax: playfair_bench [--sizes <s1,...>] [--non-letters <r1,...>] [--doubles <r1,...>]
+ *         [--buffers <b1,...>] [--repeat <n>] [--dir <dir>] [--key <keyfile>] [--csv <file>]
+ *         [--json <file>] [--baseline <csv>] [--threshold <percent>] [--rss-threshold <percent>]
+ */
+int main(int argc, char **argv) {
+    SIZE_LIST sizes, buffers;
+    RATIO_LIST nonLetterRatios, doubleRatios;
+    const char *workDir = "/tmp", *keyFilePath = NULL, *csvPath = NULL, *jsonPath = NULL, *baselinePath = NULL;
+    double throughputThreshold = 10, rssThreshold = 20;
+    int repeat = 5;
+
+    parseSizeList("1K,1M,64M", &sizes);
+    parseSizeList("64K,500K,4M", &buffers);
+    parseRatioList("0,0.2,0.5", &nonLetterRatios);
+    parseRatioList("0,0.1,0.5", &doubleRatios);
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc)
+            printSyntax(argv[0]);
+        if (strcmp(argv[i], "--sizes") == 0) {
+            if (parseSizeList(argv[i + 1], &sizes) != 0)
+                printSyntax(argv[0]);
+        } else if (strcmp(argv[i], "--buffers") == 0) {
+            if (parseSizeList(argv[i + 1], &buffers) != 0)
+                printSyntax(argv[0]);
+        } else if (strcmp(argv[i], "--non-letters") == 0) {
+            if (parseRatioList(argv[i + 1], &nonLetterRatios) != 0)
+                printSyntax(argv[0]);
+        } else if (strcmp(argv[i], "--doubles") == 0) {
+            if (parseRatioList(argv[i + 1], &doubleRatios) != 0)
+                printSyntax(argv[0]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && atoi(argv[i + 1]) > 0)
+            repeat = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--dir") == 0)
+            workDir = argv[i + 1];
+        else if (strcmp(argv[i], "--key") == 0)
+            keyFilePath = argv[i + 1];
+        else if (strcmp(argv[i], "--csv") == 0)
+            csvPath = argv[i + 1];
+        else if (strcmp(argv[i], "--json") == 0)
+            jsonPath = argv[i + 1];
+        else if (strcmp(argv[i], "--baseline") == 0)
+            baselinePath = argv[i + 1];
+        else if (strcmp(argv[i], "--threshold") == 0 && atof(argv[i + 1]) >= 0)
+            throughputThreshold = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "--rss-threshold") == 0 && atof(argv[i + 1]) >= 0)
+            rssThreshold = atof(argv[i + 1]);
+        else printSyntax(argv[0]);
+        i++;
+    }
+
+    char inputPath[4096], encodedPath[4096], decodedPath[4096], generatedKeyPath[4096];
+    snprintf(inputPath, sizeof(inputPath), "%s/playfair_bench_%d.txt", workDir, (int) getpid());
+    snprintf(encodedPath, sizeof(encodedPath), "%s/playfair_bench_%d.pf", workDir, (int) getpid());
+    snprintf(decodedPath, sizeof(decodedPath), "%s/playfair_bench_%d.dec", workDir, (int) getpid());
+    snprintf(generatedKeyPath, sizeof(generatedKeyPath), "%s/playfair_bench_%d.key", workDir, (int) getpid());
+    if (keyFilePath == NULL) {
+        FILE *keyFile = fopen(generatedKeyPath, "w");
+        if (keyFile == NULL) {
+            fprintf(stderr, "ERROR: the work directory '%s' cannot be written\n", workDir);
+            return EXIT_FAILURE;
+        }
+        fprintf(keyFile, "ABCDEFGHIKLMNOPQRSTUVWXYZ\nI\nX\nPLAYFAIRBENCHMARK\n");
+        fclose(keyFile);
+        keyFilePath = generatedKeyPath;
+    }
+
+    KEYFILE keyFile;
+    if (loadKeyFile((char *) keyFilePath, &keyFile) != 0)
+        return EXIT_FAILURE;
+    MATRIX matrix = createMatrix(keyFile);
+    CIPHER_TABLE encodeTable = createCipherTable(matrix, keyFile, "encode");
+    CIPHER_TABLE decodeTable = createCipherTable(matrix, keyFile, "decode");
+
+    int nResults = 0, failed = 0;
+    BENCH_RESULT *results = calloc((size_t) 2 * sizes.count * nonLetterRatios.count * doubleRatios.count *
+                                   buffers.count, sizeof(BENCH_RESULT));
+    if (results == NULL) {
+        fprintf(stderr, "ERROR: The memory allocation has failed\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-9s %12s %11s %8s %10s %10s %10s %10s %10s %10s %12s\n", "operation", "size", "non-letters", "doubles",
+           "buffer", "MB/s", "p50 ms", "p90 ms", "p99 ms", "max ms", "peak RSS KB");
+    for (int s = 0; s < sizes.count && !failed; s++)
+        for (int n = 0; n < nonLetterRatios.count && !failed; n++)
+            for (int d = 0; d < doubleRatios.count && !failed; d++) {
+                if (generateInput(inputPath, sizes.values[s], nonLetterRatios.values[n], doubleRatios.values[d]) != 0 ||
+                    runOnce(inputPath, encodedPath, &encodeTable, 0) == 0) {
+                    fprintf(stderr, "ERROR: the input files cannot be written to '%s'\n", workDir);
+                    failed = 1;
+                    break;
+                }
+                for (int b = 0; b < buffers.count && !failed; b++)
+                    for (int decode = 0; decode <= 1 && !failed; decode++) {
+                        BENCH_RESULT *result = &results[nResults];
+                        *result = (BENCH_RESULT) {.operation = decode ? "decode" : "encode",
+                                                  .size = sizes.values[s],
+                                                  .nonLetterRatio = nonLetterRatios.values[n],
+                                                  .doubleRatio = doubleRatios.values[d],
+                                                  .bufferSize = buffers.values[b], .repeat = repeat};
+                        if (runConfiguration(decode ? encodedPath : inputPath, decode ? decodedPath : encodedPath,
+                                             decode ? &decodeTable : &encodeTable, result) != 0) {
+                            fprintf(stderr, "ERROR: the benchmark files in '%s' cannot be processed\n", workDir);
+                            failed = 1;
+                            break;
+                        }
+                        nResults++;
+                        printf("%-9s %12zu %11g %8g %10zu %10.2f %10.3f %10.3f %10.3f %10.3f %12ld\n",
+                               result->operation, result->size, result->nonLetterRatio, result->doubleRatio,
+                               result->bufferSize, result->mbPerSecond, (double) result->p50 / 1e6,
+                               (double) result->p90 / 1e6, (double) result->p99 / 1e6, (double) result->max / 1e6,
+                               result->peakRssKb);
+                        fflush(stdout);
+                    }
+            }
+    remove(inputPath);
+    remove(encodedPath);
+    remove(decodedPath);
+    remove(generatedKeyPath);
+
+    if (csvPath != NULL && writeCsv(csvPath, results, nResults) != 0) {
+        fprintf(stderr, "ERROR: the CSV file '%s' cannot be written\n", csvPath);
+        failed = 1;
+    }
+    if (jsonPath != NULL && writeJson(jsonPath, results, nResults) != 0) {
+        fprintf(stderr, "ERROR: the JSON file '%s' cannot be written\n", jsonPath);
+        failed = 1;
+    }
+    if (baselinePath != NULL && !failed) {
+        int nRegressions = compareBaseline(baselinePath, results, nResults, throughputThreshold, rssThreshold);
+        if (nRegressions < 0)
+            fprintf(stderr, "ERROR: the baseline '%s' cannot be read\n", baselinePath);
+        failed = nRegressions != 0;
+    }
+
+    free(results);
+    freeMatrix(matrix);
+    freeKeyFile(keyFile);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,352 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+
+#include "cacheManager.h"
+#include "fileManager.h"
+#include "utils.h"
+
+/**
+ * The name of the index file stored in the output directory and its magic header.
+ */
+#define CACHE_INDEX_NAME ".playfair-cache"
+#define CACHE_MAGIC "PFCACHE1"
+
+/**
+ * The amount of bytes read at a time when hashing or comparing files.
+ */
+#define CACHE_BUFFER 65536
+
+/**
+ * Compares two CACHE_RECORD by input path and fingerprint.
+ */
+static int compareRecords(const void *a, const void *b) {
+    const CACHE_RECORD *first = a, *second = b;
+    int result = strcmp(first->inputPath, second->inputPath);
+    if (result != 0) return result;
+    return (first->fingerprint > second->fingerprint) - (first->fingerprint < second->fingerprint);
+}
+
+/**
+ * Returns the modification time of the given file status in nanoseconds.
+ */
+static uint64_t getModificationTime(const struct stat *fileStat) {
+    return (uint64_t) fileStat->st_mtim.tv_sec * 1000000000u + (uint64_t) fileStat->st_mtim.tv_nsec;
+}
+
+/**
+ * Adds the given record to the cache, growing its array if needed.
+ */
+static void appendRecord(CACHE *cache, CACHE_RECORD *record) {
+    if (cache->size == cache->capacity) {
+        cache->capacity = cache->capacity == 0 ? 64 : cache->capacity * 2;
+        cache->records = memoryRealloc(cache->records, cache->capacity * sizeof(CACHE_RECORD));
+    }
+    cache->records[cache->size++] = *record;
+}
+
+/**
+ * Loads the cache index stored in the given output directory. If there is no index yet,
+ * or if it cannot be read, the cache starts empty.
+ *
+ * @param outputDir - the output directory of the run
+ * @param cache - the CACHE to fill
+ */
+void loadCache(char *outputDir, CACHE *cache) {
+    char magic[sizeof(CACHE_MAGIC) - 1];
+    uint64_t nRecords = 0;
+
+    memset(cache, 0, sizeof(CACHE));
+    cache->indexPath = joinPath(outputDir, CACHE_INDEX_NAME);
+
+    FILE *index = fopen(cache->indexPath, "rb");
+    if (index == NULL)
+        return;
+
+    if (fread(magic, 1, sizeof(magic), index) == sizeof(magic) && memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0 &&
+        fread(&nRecords, sizeof(nRecords), 1, index) == 1) {
+        for (uint64_t i = 0; i < nRecords; i++) {
+            CACHE_RECORD record;
+            uint32_t pathLength;
+
+            if (fread(&record.device, sizeof(uint64_t), 7, index) != 7 ||
+                fread(&pathLength, sizeof(pathLength), 1, index) != 1 || pathLength > PATH_MAX)
+                break;
+            record.inputPath = stringMalloc(pathLength + 1);
+            if (fread(record.inputPath, 1, pathLength, index) != pathLength) {
+                free(record.inputPath);
+                break;
+            }
+            record.inputPath[pathLength] = '\0';
+            appendRecord(cache, &record);
+        }
+    }
+    fclose(index);
+
+    qsort(cache->records, cache->size, sizeof(CACHE_RECORD), compareRecords);
+    cache->nSorted = cache->size;
+}
+
+/**
+ * Fills the given record with the current identity (absolute path, device, inode, size and
+ * modification time) of the input file and checks whether the cache says that the input is
+ * unchanged since it was last processed with the same CIPHER_TABLE fingerprint and that the
+ * output file has not been touched since then.
+ *
+ * @param cache - the CACHE to search
+ * @param inputPath - the path of the input file
+ * @param outputPath - the path of the output file
+ * @param fingerprint - the fingerprint of the CIPHER_TABLE of the run
+ * @param record - the CACHE_RECORD where to store the identity of the input
+ * @return 1 if the input can be skipped, 0 otherwise
+ */
+int lookupCache(CACHE *cache, const char *inputPath, const char *outputPath, uint64_t fingerprint,
+                CACHE_RECORD *record) {
+    char absolutePath[PATH_MAX];
+    struct stat inputStat, outputStat;
+
+    memset(record, 0, sizeof(CACHE_RECORD));
+    if (realpath(inputPath, absolutePath) == NULL || stat(absolutePath, &inputStat) != 0)
+        return 0;
+
+    record->inputPath = stringMalloc(strlen(absolutePath) + 1);
+    strcpy(record->inputPath, absolutePath);
+    record->device = inputStat.st_dev;
+    record->inode = inputStat.st_ino;
+    record->size = inputStat.st_size;
+    record->modificationTime = getModificationTime(&inputStat);
+    record->fingerprint = fingerprint;
+
+    CACHE_RECORD *cached = cache->nSorted > 0 ? bsearch(record, cache->records, cache->nSorted, sizeof(CACHE_RECORD),
+                                                      compareRecords) : NULL;
+    if (cached == NULL || cached->device != record->device || cached->inode != record->inode ||
+        cached->size != record->size || cached->modificationTime != record->modificationTime)
+        return 0;
+
+    return stat(outputPath, &outputStat) == 0 && (uint64_t) outputStat.st_size == cached->outputSize &&
+           getModificationTime(&outputStat) == cached->outputModificationTime;
+}
+
+/**
+ * Stores in the cache the given record (filled by @lookupCache() before the input was processed)
+ * together with the current size and modification time of the output file.
+ * The cache takes ownership of the input path of the record.
+ *
+ * @param cache - the CACHE to update
+ * @param record - the record describing the input file
+ * @param outputPath - the path of the output file that was written
+ */
+void updateCache(CACHE *cache, CACHE_RECORD *record, const char *outputPath) {
+    struct stat outputStat;
+
+    if (record->inputPath == NULL || stat(outputPath, &outputStat) != 0) {
+        free(record->inputPath);
+        return;
+    }
+    record->outputSize = outputStat.st_size;
+    record->outputModificationTime = getModificationTime(&outputStat);
+
+    CACHE_RECORD *cached = cache->nSorted > 0 ? bsearch(record, cache->records, cache->nSorted, sizeof(CACHE_RECORD),
+                                                      compareRecords) : NULL;
+    if (cached != NULL) {
+        free(cached->inputPath);
+        *cached = *record;
+    } else appendRecord(cache, record);
+}
+
+/**
+ * Writes the cache index to the output directory. The index is written to a temporary file
+ * which then replaces the old index, so that an interrupted run never leaves a corrupted index.
+ *
+ * @param cache - the CACHE to save
+ */
+void saveCache(CACHE *cache) {
+    char *tempPath = stringMalloc(strlen(cache->indexPath) + 5);
+    size_t nRecords = 0;
+
+    qsort(cache->records, cache->size, sizeof(CACHE_RECORD), compareRecords);
+    for (size_t i = 0; i < cache->size; i++) {
+        if (nRecords > 0 && compareRecords(&cache->records[nRecords - 1], &cache->records[i]) == 0) {
+            free(cache->records[nRecords - 1].inputPath);
+            nRecords--;
+        }
+        cache->records[nRecords++] = cache->records[i];
+    }
+    cache->size = cache->nSorted = nRecords;
+
+    sprintf(tempPath, "%s.tmp", cache->indexPath);
+    FILE *index = fopen(tempPath, "wb");
+    if (index == NULL) {
+        fprintf(stderr, "WARNING: the cache index '%s' cannot be written\n", cache->indexPath);
+        free(tempPath);
+        return;
+    }
+
+    uint64_t count = nRecords;
+    fwrite(CACHE_MAGIC, 1, sizeof(CACHE_MAGIC) - 1, index);
+    fwrite(&count, sizeof(count), 1, index);
+    for (size_t i = 0; i < nRecords; i++) {
+        uint32_t pathLength = (uint32_t) strlen(cache->records[i].inputPath);
+        fwrite(&cache->records[i].device, sizeof(uint64_t), 7, index);
+        fwrite(&pathLength, sizeof(pathLength), 1, index);
+        fwrite(cache->records[i].inputPath, 1, pathLength, index);
+    }
+
+    if ((ferror(index) | fclose(index)) != 0 || rename(tempPath, cache->indexPath) != 0) {
+        fprintf(stderr, "WARNING: the cache index '%s' cannot be written\n", cache->indexPath);
+        unlink(tempPath);
+    }
+    free(tempPath);
+}
+
+/**
+ * Frees all the records of the given cache.
+ *
+ * @param cache - the CACHE to free
+ */
+void freeCache(CACHE *cache) {
+    for (size_t i = 0; i < cache->size; i++)
+        free(cache->records[i].inputPath);
+    free(cache->records);
+    free(cache->indexPath);
+}
+
+/**
+ * Computes a 64-bit FNV-1a hash of the content of the given file.
+ *
+ * @return 0 if the file was read, -1 otherwise
+ */
+static int hashFileContent(const char *path, uint64_t *hash) {
+    unsigned char buffer[CACHE_BUFFER];
+    FILE *file = fopen(path, "rb");
+    size_t nRead;
+
+    *hash = 14695981039346656037u;
+    if (file == NULL) return -1;
+    while ((nRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        for (size_t i = 0; i < nRead; i++) {
+            *hash ^= buffer[i];
+            *hash *= 1099511628211u;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * Checks byte by byte whether the two given files have the same content.
+ */
+static int haveSameContent(const char *firstPath, const char *secondPath) {
+    char *firstBuffer = stringMalloc(CACHE_BUFFER), *secondBuffer = stringMalloc(CACHE_BUFFER);
+    FILE *first = fopen(firstPath, "rb"), *second = fopen(secondPath, "rb");
+    int same = first != NULL && second != NULL;
+    size_t nFirst, nSecond;
+
+    while (same) {
+        nFirst = fread(firstBuffer, 1, CACHE_BUFFER, first);
+        nSecond = fread(secondBuffer, 1, CACHE_BUFFER, second);
+        same = nFirst == nSecond && memcmp(firstBuffer, secondBuffer, nFirst) == 0;
+        if (nFirst == 0) break;
+    }
+    if (first != NULL) fclose(first);
+    if (second != NULL) fclose(second);
+    free(firstBuffer);
+    free(secondBuffer);
+    return same;
+}
+
+typedef struct {
+    int index;
+    uint64_t size;
+    uint64_t hash;
+} INPUT_IDENTITY;
+
+static int compareIdentities(const void *a, const void *b) {
+    const INPUT_IDENTITY *first = a, *second = b;
+    if (first->size != second->size) return (first->size > second->size) - (first->size < second->size);
+    if (first->hash != second->hash) return (first->hash > second->hash) - (first->hash < second->hash);
+    return first->index - second->index;
+}
+
+/**
+ * Finds the inputs of a batch that have identical content, so that they can be processed once.
+ * Only the files whose size is shared with another file are hashed, and equal hashes are confirmed
+ * by comparing the files. For every input, @duplicateOf is set to the index of the first identical
+ * input that precedes it, or to -1 if there is none.
+ *
+ * @param inputPaths - the paths of the inputs
+ * @param nInputs - the amount of inputs
+ * @param duplicateOf - the array (of @nInputs elements) to fill
+ */
+void findDuplicateInputs(char **inputPaths, int nInputs, int *duplicateOf) {
+    INPUT_IDENTITY *identities = memoryMalloc(nInputs * sizeof(INPUT_IDENTITY));
+    int nIdentities = 0;
+
+    for (int i = 0; i < nInputs; i++) {
+        struct stat inputStat;
+        duplicateOf[i] = -1;
+        if (stat(inputPaths[i], &inputStat) == 0 && S_ISREG(inputStat.st_mode) && inputStat.st_size > 0)
+            identities[nIdentities++] = (INPUT_IDENTITY) {i, (uint64_t) inputStat.st_size, 0};
+    }
+
+    qsort(identities, nIdentities, sizeof(INPUT_IDENTITY), compareIdentities);
+    for (int start = 0, end; start < nIdentities; start = end) {
+        for (end = start + 1; end < nIdentities && identities[end].size == identities[start].size; end++);
+        if (end - start < 2)
+            continue;
+        for (int i = start; i < end; i++)
+            hashFileContent(inputPaths[identities[i].index], &identities[i].hash);
+        qsort(identities + start, end - start, sizeof(INPUT_IDENTITY), compareIdentities);
+
+        for (int i = start + 1; i < end; i++) {
+            for (int j = start; j < i; j++) {
+                int primary = identities[j].index;
+                if (identities[j].hash == identities[i].hash && duplicateOf[primary] == -1 &&
+                    haveSameContent(inputPaths[primary], inputPaths[identities[i].index])) {
+                    duplicateOf[identities[i].index] = primary;
+                    break;
+                }
+            }
+        }
+    }
+    free(identities);
+}
+
+/**
+ * Makes the destination file have the same content of the source file, as a file of its own: the
+ * data is cloned when the file system supports it (the two files share their blocks copy-on-write),
+ * otherwise it is copied. The files are never hard-linked, since every output is later rewritten
+ * in place and a shared inode would make it overwrite its sibling. A previous destination file is
+ * replaced.
+ *
+ * @param source - the path of the existing file
+ * @param destination - the path of the file to create
+ * @return 0 on success, -1 otherwise
+ */
+int cloneOrCopyFile(const char *source, const char *destination) {
+    char buffer[CACHE_BUFFER];
+    size_t nRead;
+
+    if (strcmp(source, destination) == 0)
+        return 0;
+    unlink(destination);
+
+    FILE *in = fopen(source, "rb"), *out = fopen(destination, "wb");
+    int result = in != NULL && out != NULL ? 0 : -1;
+    if (result == 0 && ioctl(fileno(out), FICLONE, fileno(in)) == 0) {
+        fclose(in);
+        return fclose(out) == 0 ? 0 : -1;
+    }
+    while (result == 0 && (nRead = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        if (fwrite(buffer, 1, nRead, out) != nRead)
+            result = -1;
+    if (in != NULL) fclose(in);
+    if (out != NULL && fclose(out) != 0) result = -1;
+    return result;
+}
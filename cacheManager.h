@@ -0,0 +1,42 @@
+
+#ifndef PLAYFAIR_CACHEMANAGER_H
+#define PLAYFAIR_CACHEMANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    char *inputPath;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    uint64_t modificationTime;
+    uint64_t fingerprint;
+    uint64_t outputSize;
+    uint64_t outputModificationTime;
+} CACHE_RECORD;
+
+typedef struct {
+    char *indexPath;
+    CACHE_RECORD *records;
+    size_t size;
+    size_t nSorted;
+    size_t capacity;
+} CACHE;
+
+void loadCache(char *outputDir, CACHE *cache);
+
+int lookupCache(CACHE *cache, const char *inputPath, const char *outputPath, uint64_t fingerprint,
+                CACHE_RECORD *record);
+
+void updateCache(CACHE *cache, CACHE_RECORD *record, const char *outputPath);
+
+void saveCache(CACHE *cache);
+
+void freeCache(CACHE *cache);
+
+void findDuplicateInputs(char **inputPaths, int nInputs, int *duplicateOf);
+
+int cloneOrCopyFile(const char *source, const char *destination);
+
+#endif //PLAYFAIR_CACHEMANAGER_H
@@ -0,0 +1,221 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "checkpointManager.h"
+#include "streamManager.h"
+#include "fileManager.h"
+#include "utils.h"
+
+/**
+ * The amount of characters read from the input file at a time.
+ */
+#define CHECKPOINT_BUFFER 500000
+
+/**
+ * The amount of input characters processed between two checkpoints.
+ */
+#define CHECKPOINT_INTERVAL (64 * 1024 * 1024)
+
+/**
+ * Returns the path of the sidecar file holding the checkpoints of the given output file,
+ * which is the output path with the addition of the ".ckpt" extension.
+ *
+ * @param outputPath - the path of the output file
+ * @return the path of the checkpoint file
+ */
+char *getCheckpointPath(const char *outputPath) {
+    char *checkpointPath = stringMalloc(strlen(outputPath) + 6);
+    strcpy(checkpointPath, outputPath);
+    strcat(checkpointPath, ".ckpt");
+    return checkpointPath;
+}
+
+/**
+ * Reads the checkpoint stored in the given sidecar file.
+ *
+ * @param checkpointPath - the path of the checkpoint file
+ * @param checkpoint - the CHECKPOINT to fill
+ * @return 0 if a valid checkpoint was read, -1 otherwise
+ */
+int readCheckpoint(const char *checkpointPath, CHECKPOINT *checkpoint) {
+    FILE *file = fopen(checkpointPath, "r");
+    int pendingLetter = 0, nRead;
+
+    if (file == NULL)
+        return -1;
+    nRead = fscanf(file, "playfair-checkpoint 1\n"
+                         "fingerprint %" SCNx64 "\ninput-size %" SCNu64 "\ninput-mtime %" SCNu64 "\n"
+                         "input-offset %" SCNu64 "\noutput-offset %" SCNu64 "\n"
+                         "letters %" SCNu64 "\ndigraphs %" SCNu64 "\npadding %" SCNu64 "\npending %d",
+                   &checkpoint->fingerprint, &checkpoint->inputSize, &checkpoint->inputModificationTime,
+                   &checkpoint->inputOffset, &checkpoint->outputOffset,
+                   &checkpoint->letters, &checkpoint->digraphs, &checkpoint->padding, &pendingLetter);
+    fclose(file);
+    checkpoint->pendingLetter = (char) pendingLetter;
+    return nRead == 9 ? 0 : -1;
+}
+
+/**
+ * Writes the given checkpoint to the given sidecar file. The checkpoint is written to a
+ * temporary file, synchronized to disk and then renamed, so that the sidecar file always
+ * contains a complete checkpoint even if the program is killed while writing it.
+ *
+ * @param checkpointPath - the path of the checkpoint file
+ * @param checkpoint - the CHECKPOINT to write
+ * @return 0 if the checkpoint was written, -1 otherwise
+ */
+int writeCheckpoint(const char *checkpointPath, const CHECKPOINT *checkpoint) {
+    char *tempPath = stringMalloc(strlen(checkpointPath) + 5);
+    int result = -1;
+
+    sprintf(tempPath, "%s.tmp", checkpointPath);
+    FILE *file = fopen(tempPath, "w");
+    if (file != NULL) {
+        fprintf(file, "playfair-checkpoint 1\n"
+                      "fingerprint %" PRIx64 "\ninput-size %" PRIu64 "\ninput-mtime %" PRIu64 "\n"
+                      "input-offset %" PRIu64 "\noutput-offset %" PRIu64 "\n"
+                      "letters %" PRIu64 "\ndigraphs %" PRIu64 "\npadding %" PRIu64 "\npending %d\n",
+                checkpoint->fingerprint, checkpoint->inputSize, checkpoint->inputModificationTime,
+                checkpoint->inputOffset, checkpoint->outputOffset,
+                checkpoint->letters, checkpoint->digraphs, checkpoint->padding, checkpoint->pendingLetter);
+        int failed = fflush(file) != 0 || fsync(fileno(file)) != 0;
+        failed |= fclose(file) != 0;
+        if (!failed && rename(tempPath, checkpointPath) == 0)
+            result = 0;
+        else unlink(tempPath);
+    }
+    free(tempPath);
+    return result;
+}
+
+/**
+ * Makes the output written so far durable and records a checkpoint describing the current
+ * state of the given stream.
+ */
+static void commitCheckpoint(FILE *out, const char *checkpointPath, CHECKPOINT *checkpoint,
+                             const CIPHER_STREAM *stream) {
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0) {
+        fprintf(stderr, "WARNING: the output cannot be synchronized, checkpoint skipped\n");
+        return;
+    }
+    checkpoint->inputOffset = stream->bytesIn;
+    checkpoint->outputOffset = stream->bytesOut;
+    checkpoint->letters = stream->letters;
+    checkpoint->digraphs = stream->digraphs;
+    checkpoint->padding = stream->padding;
+    checkpoint->pendingLetter = stream->pendingLetter;
+    if (writeCheckpoint(checkpointPath, checkpoint) != 0)
+        fprintf(stderr, "WARNING: the checkpoint '%s' cannot be written\n", checkpointPath);
+}
+
+/**
+ * Works like @processFile(), but every @CHECKPOINT_INTERVAL input characters the output is
+ * synchronized to disk and a checkpoint (input and output offsets, unpaired letter, counters and
+ * the fingerprint of the CIPHER_TABLE) is stored in a sidecar file next to the output.
+ * If a checkpoint written by a previous interrupted run exists for the same input (same size and
+ * modification time) and the same CIPHER_TABLE, the output is truncated to the checkpoint and the
+ * processing continues from there instead of starting over.
+ * The sidecar file is removed when the file has been completely processed.
+ * On error, -1 is returned: the partial output is removed, unless a checkpoint allows to resume it.
+ *
+ * @param filePath - the path of the input file to encode or decode
+ * @param outputPath - the output path of the file where to write the encoded or decoded text
+ * @param cipherTable - the CIPHER_TABLE used to encode/decode
+ * @param command - the desired operation to execute (whether "encode" or "decode")
+ * @param stats - where to store the counters of the processed file (for the whole file, even if resumed)
+ * @return 0 if the file was processed, -1 otherwise
+ */
+int processFileResumable(char *filePath, char *outputPath, const CIPHER_TABLE *cipherTable, char *command,
+                         FILE_STATS *stats) {
+    FILE *file = fopen(filePath, "r"), *out = NULL;
+    CHECKPOINT checkpoint, previous;
+    CIPHER_STREAM stream;
+    struct stat inputStat;
+
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", filePath);
+        return -1;
+    }
+    if (fstat(fileno(file), &inputStat) != 0 || inputStat.st_size == 0) {
+        fprintf(stderr, "\nERROR: the file to %s '%s' is empty!\n\n", command, filePath);
+        fclose(file);
+        return -1;
+    }
+
+    char *checkpointPath = getCheckpointPath(outputPath);
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    checkpoint.fingerprint = getCipherTableFingerprint(cipherTable);
+    checkpoint.inputSize = inputStat.st_size;
+    checkpoint.inputModificationTime = (uint64_t) inputStat.st_mtim.tv_sec * 1000000000u + inputStat.st_mtim.tv_nsec;
+    initStream(&stream, cipherTable);
+
+    if (readCheckpoint(checkpointPath, &previous) == 0 && previous.fingerprint == checkpoint.fingerprint &&
+        previous.inputSize == checkpoint.inputSize &&
+        previous.inputModificationTime == checkpoint.inputModificationTime &&
+        previous.inputOffset <= checkpoint.inputSize && (out = fopen(outputPath, "r+")) != NULL) {
+        if (ftruncate(fileno(out), (off_t) previous.outputOffset) == 0 && fseek(out, 0, SEEK_END) == 0 &&
+            (uint64_t) ftell(out) == previous.outputOffset &&
+            fseek(file, (long) previous.inputOffset, SEEK_SET) == 0) {
+            stream.bytesIn = previous.inputOffset;
+            stream.bytesOut = previous.outputOffset;
+            stream.letters = previous.letters;
+            stream.digraphs = previous.digraphs;
+            stream.padding = previous.padding;
+            stream.pendingLetter = previous.pendingLetter;
+            fprintf(stderr, "resuming from input offset %" PRIu64 "\n", previous.inputOffset);
+        } else {
+            fclose(out);
+            out = NULL;
+        }
+    }
+    if (out == NULL) {
+        remove(outputPath);
+        if ((out = fopen(outputPath, "w")) == NULL) {
+            fprintf(stderr, "\nERROR: the output file '%s' cannot be created!\n\n", outputPath);
+            fclose(file);
+            free(checkpointPath);
+            return -1;
+        }
+        fseek(file, 0, SEEK_SET);
+    }
+
+    char *text = stringMalloc(CHECKPOINT_BUFFER);
+    char *processedText = stringMalloc(STREAM_OUTPUT_SIZE(CHECKPOINT_BUFFER));
+    size_t nCharRead, lastCheckpoint = stream.bytesIn;
+
+    while ((nCharRead = fread(text, sizeof(char), CHECKPOINT_BUFFER, file)) > 0) {
+        fwrite(processedText, sizeof(char), feedStream(&stream, text, nCharRead, processedText), out);
+        if (stream.bytesIn - lastCheckpoint >= CHECKPOINT_INTERVAL) {
+            commitCheckpoint(out, checkpointPath, &checkpoint, &stream);
+            lastCheckpoint = stream.bytesIn;
+        }
+    }
+    fwrite(processedText, sizeof(char), finishStream(&stream, processedText), out);
+    getStreamStats(&stream, stats);
+
+    free(text);
+    free(processedText);
+    int failed = ferror(file) || ferror(out);
+    failed |= fclose(out) != 0;
+    fclose(file);
+
+    if (failed || stream.letters == 0) {
+        if (lastCheckpoint == 0) {
+            remove(outputPath);
+            remove(checkpointPath);
+        }
+        if (failed)
+            fprintf(stderr, "\nERROR: the file '%s' cannot be read or its output cannot be written!\n\n", filePath);
+        else fprintf(stderr, "\nERROR: no valid text can be read from the specified file '%s'\n\n", filePath);
+        free(checkpointPath);
+        return -1;
+    }
+    remove(checkpointPath);
+    free(checkpointPath);
+    return 0;
+}
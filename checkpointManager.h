@@ -0,0 +1,29 @@
+
+#ifndef PLAYFAIR_CHECKPOINTMANAGER_H
+#define PLAYFAIR_CHECKPOINTMANAGER_H
+
+#include <stdint.h>
+#include "cipherManager.h"
+
+typedef struct {
+    uint64_t fingerprint;
+    uint64_t inputSize;
+    uint64_t inputModificationTime;
+    uint64_t inputOffset;
+    uint64_t outputOffset;
+    uint64_t letters;
+    uint64_t digraphs;
+    uint64_t padding;
+    char pendingLetter;
+} CHECKPOINT;
+
+char *getCheckpointPath(const char *outputPath);
+
+int readCheckpoint(const char *checkpointPath, CHECKPOINT *checkpoint);
+
+int writeCheckpoint(const char *checkpointPath, const CHECKPOINT *checkpoint);
+
+int processFileResumable(char *filePath, char *outputPath, const CIPHER_TABLE *cipherTable, char *command,
+                         FILE_STATS *stats);
+
+#endif //PLAYFAIR_CHECKPOINTMANAGER_H
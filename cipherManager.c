@@ -1,95 +1,220 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
 
 #include "fileManager.h"
 #include "utils.h"
 #include "cipherManager.h"
+#include "streamManager.h"
+#include "traceManager.h"
 
 /**
- * Macro for returning the smaller of two numbers.
+ * The names of the stages of the processing of a file, as printed in the reports and in the traces.
  */
-#define MIN(a, b) (((a) <= (b)) ? (a) : (b))
+const char *fileStageNames[FILE_STAGES] = {"read", "normalize", "doubling", "cipher", "write", "close"};
 
 /**
- * The default amount of characters to read from the file at a time (if possible).
+ * Returns the current value of the monotonic clock in nanoseconds.
  */
-#define BUFFER 500000
+static uint64_t getMonotonicTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
 
 /**
- * Opens the input file using the given path, then reads @BUFFER characters at a time (if possible,
- * otherwise the remaining ones) until the end of the file is reached.
- * If the file is empty, an error is printed and the program ends.
- * With the method @getProcessedText() it obtains the processed portion of the file (encoded or decoded,
- * depending on the @command parameter, using the given @KEYFILE and the given @MATRIX).
- * The result of the encoding/decoding is written to the file specified by the given output path.
- * If the first portion of the file is encoded/decoded, it is written to a new file (if a file with the same
+ * Opens the input file using the given path and encodes or decodes it (depending on the given
+ * @CIPHER_TABLE) with the method @processStream().
+ * The result is written to the file specified by the given output path (if a file with the same
  * name already exists, its content is erased and the file is considered as a new empty file).
- * Otherwise, it is appended to an existing file.
- * When there are no more letters to read from the file, the file is closed.
+ * Both files are read and written sequentially, without seeking, so the input can be a pipe or
+ * a FIFO, and both paths can be "-" for the standard input and output (see @openPath()).
+ * If the input file cannot be read or is empty, if no letters at all can be read from it or if the
+ * output cannot be written, an error is printed, the partial output file is removed and -1 is
+ * returned, so that a batch can go on with the next file.
+ * The time of every stage of the processing, closing the files included, is added to the
+ * @stageTimes of the given FILE_STATS (which is marked as @staged), and, if @countEvents is set and
+ * the hardware performance counters are available, the events counted by them to its @stageCounts.
+ * While a trace is recorded, every stage of every portion of the file is recorded as a span of the
+ * calling thread.
  *
  * @param filePath - the path of the input file to encode or decode
  * @param outputPath - the output path of the file where to write the encoded or decoded text
- * @param playfairMatrix - the MATRIX used to encode/decode
- * @param keyFile - the KEYFILE whose attributes are needed for the preparation of the text to process
+ * @param cipherTable - the CIPHER_TABLE used to encode/decode
  * @param command - the desired operation to execute (whether "encode" or "decode")
+ * @param stats - where to store the counters and the stage times of the processed file
+ * @param integrity - the INTEGRITY collecting the checksums of the output, or NULL
+ * @param countEvents - whether to count the hardware events of every stage
+ * @return 0 if the file was processed, -1 otherwise
  */
-void processFile(char *filePath, char *outputPath, MATRIX playfairMatrix, KEYFILE keyFile, char *command) {
-    FILE *file = openFile(filePath, "r+");
-    size_t fileSize = getFileSize(file);
+int processFile(char *filePath, char *outputPath, const CIPHER_TABLE *cipherTable, char *command, FILE_STATS *stats,
+                INTEGRITY *integrity, int countEvents) {
+    FILE *file = openPath(filePath, "r");
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", filePath);
+        return -1;
+    }
 
-    if (fileSize == 0) {
-        fprintf(stderr, "\nERROR: the file to %s is empty!\n\n", command);
-        exit(EXIT_FAILURE);
+    FILE *out = openPath(outputPath, "w");
+    if (out == NULL) {
+        fprintf(stderr, "\nERROR: the output file '%s' cannot be created!\n\n", outputPath);
+        closePath(file);
+        return -1;
     }
 
-    size_t remainingCharacter = fileSize;
-    size_t nCharToRead;
+    CIPHER_STREAM stream;
+    PERF_COUNTERS counters;
+    initStream(&stream, cipherTable);
+    stream.stageStats = stats;
+    stats->staged = 1;
+    if (countEvents && openPerfCounters(&counters) == 0) {
+        stream.counters = &counters;
+        stats->perfEvents = getPerfEventMask(&counters);
+    }
+    processStream(file, out, &stream, integrity);
+    getStreamStats(&stream, stats);
+    int failed = ferror(file) || ferror(out);
+    uint64_t closeTime = getMonotonicTime();
+    if (stream.counters != NULL)
+        markPerfCounters(&counters, NULL);
+    failed |= closePath(out) != 0;
+    closePath(file);
+    uint64_t closedTime = getMonotonicTime();
+    stats->stageTimes[STAGE_CLOSE] += closedTime - closeTime;
+    if (traceEnabled)
+        addTraceSpan(fileStageNames[STAGE_CLOSE], "io", NULL, -1, closeTime, closedTime);
+    if (stream.counters != NULL) {
+        markPerfCounters(&counters, stats->stageCounts[STAGE_CLOSE]);
+        closePerfCounters(&counters);
+    }
+
+    if (failed) {
+        removePath(outputPath);
+        fprintf(stderr, "\nERROR: the file '%s' cannot be read or its output cannot be written!\n\n", filePath);
+        return -1;
+    }
+    if (stream.bytesIn == 0) {
+        removePath(outputPath);
+        fprintf(stderr, "\nERROR: the file to %s '%s' is empty!\n\n", command, filePath);
+        return -1;
+    }
+    if (stream.letters == 0) {
+        removePath(outputPath);
+        fprintf(stderr, "\nERROR: no valid text can be read from the specified file '%s'\n\n", filePath);
+        return -1;
+    }
+    return 0;
+}
 
-    while (remainingCharacter > 0) {
-        nCharToRead = MIN(BUFFER, remainingCharacter);
-        char *processedText = getProcessedText(file, nCharToRead, playfairMatrix, keyFile, command);
+/**
+ * Opens the input file using the given path and encodes or decodes it with every given
+ * @CIPHER_TABLE at once with the method @processStreamFanOut(): the file is read and split into
+ * digraphs once and the result of every table is written to the corresponding output path.
+ * The errors are the same of @processFile(): if any of them occurs, all the partial output files
+ * are removed and -1 is returned.
+ *
+ * @param filePath - the path of the input file to encode or decode
+ * @param outputPaths - the output paths of the files where to write the text of every table
+ * @param cipherTables - the CIPHER_TABLEs used to encode/decode
+ * @param nTables - the amount of tables (and output paths)
+ * @param command - the desired operation to execute (whether "encode" or "decode")
+ * @param stats - where to store the counters of every output file
+ * @return 0 if the file was processed, -1 otherwise
+ */
+int processFileFanOut(char *filePath, char **outputPaths, const CIPHER_TABLE **cipherTables, int nTables,
+                      char *command, FILE_STATS *stats) {
+    FILE *file = openPath(filePath, "r");
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", filePath);
+        return -1;
+    }
+
+    FILE **out = memoryCalloc(nTables, sizeof(FILE *));
+    CIPHER_STREAM *streams = memoryMalloc(nTables * sizeof(CIPHER_STREAM));
+    int failed = 0, nOpened = 0;
+
+    for (; nOpened < nTables; nOpened++) {
+        if ((out[nOpened] = fopen(outputPaths[nOpened], "w")) == NULL) {
+            fprintf(stderr, "\nERROR: the output file '%s' cannot be created!\n\n", outputPaths[nOpened]);
+            failed = 1;
+            break;
+        }
+        initStream(&streams[nOpened], cipherTables[nOpened]);
+    }
 
-        if (remainingCharacter == fileSize)
-            writeToNewFile(outputPath, processedText);
-        else appendToExistingFile(outputPath, processedText);
+    if (!failed) {
+        processStreamFanOut(file, out, streams, nTables);
+        failed = ferror(file);
+        if (failed)
+            fprintf(stderr, "\nERROR: the file '%s' cannot be read!\n\n", filePath);
+    }
+    for (int i = 0; i < nOpened; i++) {
+        int outputFailed = ferror(out[i]);
+        outputFailed |= fclose(out[i]) != 0;
+        if (outputFailed && !failed) {
+            fprintf(stderr, "\nERROR: the output file '%s' cannot be written!\n\n", outputPaths[i]);
+            failed = 1;
+        }
+    }
+    closePath(file);
 
-        free(processedText);
-        remainingCharacter = fileSize - ftell(file);
+    if (!failed && streams[0].bytesIn == 0) {
+        fprintf(stderr, "\nERROR: the file to %s '%s' is empty!\n\n", command, filePath);
+        failed = 1;
     }
-    fclose(file);
+    if (!failed && streams[0].letters == 0) {
+        fprintf(stderr, "\nERROR: no valid text can be read from the specified file '%s'\n\n", filePath);
+        failed = 1;
+    }
+    for (int i = 0; i < nOpened; i++) {
+        if (failed)
+            remove(outputPaths[i]);
+        else getStreamStats(&streams[i], &stats[i]);
+    }
+    free(out);
+    free(streams);
+    return failed ? -1 : 0;
 }
 
 /**
- * Reads @nCharToRead from the given file and then fixes the text to prepare it to the encode/decode operation.
- * It checks and corrects any occurrence of the missing char with the method @substituteMissingCharacter().
- * Then the special char from the keyFile is added between doubles and eventually to the end of the text if it
- * has an odd length.
- * Eventually the encoded or decoded text (depending on the @command parameter) is returned.
+ * Creates the CIPHER_TABLE used to process text with the given MATRIX and KEYFILE.
+ * The table contains the normalized version of every possible input character (the uppercase
+ * letter, the @replacementCharacter for the missing character of the alphabet or 0 for non-letters)
+ * and the encoded or decoded version (depending on the @command parameter) of every digraph that
+ * can be formed with the letters of the alphabet, computed once with the method @encoder().
  *
- * @param file - the input file where to read from
- * @param nCharToRead - the number of chars to read from the given file
  * @param playfairMatrix - the MATRIX used to encode/decode
- * @param keyFile - the KEYFILE whose attributes are needed for the fixing of the text
+ * @param keyFile - the KEYFILE whose alphabet and special characters have to be used
  * @param command - the desired operation to execute (whether "encode" or "decode")
- * @return the encoded or decoded text
+ * @return the new CIPHER_TABLE
  */
-char *getProcessedText(FILE *file, size_t nCharToRead, MATRIX playfairMatrix, KEYFILE keyFile, char *command) {
-    char *finalText;
-    char *text = readTextFromFile(file, nCharToRead);
-    substituteMissingCharacter(text, keyFile.replacementCharacter);
-
-    char *fixedText = addSpecialCharactersBetweenDoubles(text, keyFile.specialCharacter);
-    free(text);
-
-    if (strlen(fixedText) % 2 != 0) {
-        finalText = addLastLetter(fixedText, keyFile, file);
-    } else {
-        finalText = stringMalloc(strlen(fixedText) + 1);
-        strcpy(finalText, fixedText);
-    }
-    free(fixedText);
-    return encoder(playfairMatrix, finalText, command);
+CIPHER_TABLE createCipherTable(MATRIX playfairMatrix, KEYFILE keyFile, char *command) {
+    CIPHER_TABLE table;
+    char digraph[3] = {0};
+
+    memset(&table, 0, sizeof(table));
+    table.specialCharacter = keyFile.specialCharacter;
+
+    for (int c = 0; c < 256; c++) {
+        if (c < 128 && isalpha(c) != 0) {
+            char letter = (char) toupper(c);
+            table.letters[c] = strchr(keyFile.alphabet, letter) != NULL ? letter : keyFile.replacementCharacter;
+        }
+    }
+
+    for (const char *first = keyFile.alphabet; *first != '\0'; first++) {
+        for (const char *second = keyFile.alphabet; *second != '\0'; second++) {
+            digraph[0] = *first;
+            digraph[1] = *second;
+            char *processed = encoder(playfairMatrix, digraph, command);
+            table.digraphs[*first - 'A'][*second - 'A'][0] = processed[0];
+            table.digraphs[*first - 'A'][*second - 'A'][1] = processed[1];
+            free(processed);
+        }
+    }
+    return table;
 }
 
 /**
@@ -207,4 +332,23 @@ CHAR_COORDINATES getCoordinates(char charToFind, MATRIX playfairMatrix) {
         exit(EXIT_FAILURE);
     }
     return coordinates;
-}
\ No newline at end of file
+}
+
+/**
+ * Computes a 64-bit fingerprint (FNV-1a) of the given CIPHER_TABLE. Since the table contains
+ * everything that determines the output (the alphabet, the special characters, the MATRIX and
+ * whether it encodes or decodes), two tables with the same fingerprint produce the same output.
+ *
+ * @param cipherTable - the CIPHER_TABLE whose fingerprint has to be computed
+ * @return the fingerprint of the table
+ */
+uint64_t getCipherTableFingerprint(const CIPHER_TABLE *cipherTable) {
+    const unsigned char *bytes = (const unsigned char *) cipherTable;
+    uint64_t hash = 14695981039346656037u;
+
+    for (size_t i = 0; i < sizeof(CIPHER_TABLE); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
@@ -2,17 +2,56 @@
 #ifndef PLAYFAIR_CIPHERMANAGER_H
 #define PLAYFAIR_CIPHERMANAGER_H
 
+#include <stdint.h>
 #include "keyFileManager.h"
 #include "matrixManager.h"
+#include "integrityManager.h"
+#include "perfManager.h"
 
 typedef struct {
     int row;
     int column;
 } CHAR_COORDINATES;
 
-void processFile(char *filePath, char *outputPath, MATRIX playfairMatrix, KEYFILE keyFile, char *command);
+typedef struct {
+    char letters[256];
+    char digraphs[26][26][2];
+    char specialCharacter;
+} CIPHER_TABLE;
+
+typedef enum {
+    STAGE_READ,
+    STAGE_NORMALIZE,
+    STAGE_DOUBLING,
+    STAGE_CIPHER,
+    STAGE_WRITE,
+    STAGE_CLOSE,
+    FILE_STAGES
+} FILE_STAGE;
+
+extern const char *fileStageNames[FILE_STAGES];
+
+typedef struct {
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t letters;
+    uint64_t digraphs;
+    uint64_t padding;
+    uint64_t stageTimes[FILE_STAGES];
+    uint64_t stageCounts[FILE_STAGES][PERF_EVENTS];
+    unsigned perfEvents;
+    int staged;
+} FILE_STATS;
+
+int processFile(char *filePath, char *outputPath, const CIPHER_TABLE *cipherTable, char *command, FILE_STATS *stats,
+                INTEGRITY *integrity, int countEvents);
+
+int processFileFanOut(char *filePath, char **outputPaths, const CIPHER_TABLE **cipherTables, int nTables,
+                      char *command, FILE_STATS *stats);
+
+CIPHER_TABLE createCipherTable(MATRIX playfairMatrix, KEYFILE keyFile, char *command);
 
-char *getProcessedText(FILE *file, size_t nCharToRead, MATRIX playfairMatrix, KEYFILE keyFile, char *command);
+uint64_t getCipherTableFingerprint(const CIPHER_TABLE *cipherTable);
 
 char *encoder(MATRIX playfairMatrix, char *text, char *command);
 
@@ -22,4 +61,4 @@ char sameColumnRule(CHAR_COORDINATES coordinates, MATRIX playfairMatrix, char *c
 
 CHAR_COORDINATES getCoordinates(char charToFind, MATRIX playfairMatrix);
 
-#endif //PLAYFAIR_CIPHERMANAGER_H
\ No newline at end of file
+#endif //PLAYFAIR_CIPHERMANAGER_H
@@ -0,0 +1,83 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "protocolManager.h"
+
+/**
+ * Reads the whole content of the given file (or of the standard input if the path is "-")
+ * into a new buffer.
+ *
+ * @param path - the path of the file to read
+ * @param size - where to store the amount of bytes read
+ * @return the buffer containing the content of the file
+ */
+static char *readInput(char *path, size_t *size) {
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    size_t capacity = 65536, nRead;
+    char *buffer = malloc(capacity);
+
+    if (file == NULL || buffer == NULL) {
+        fprintf(stderr, "ERROR: cannot read '%s'\n", path);
+        exit(EXIT_FAILURE);
+    }
+    *size = 0;
+    while ((nRead = fread(buffer + *size, 1, capacity - *size, file)) > 0) {
+        *size += nRead;
+        if (*size == capacity) {
+            capacity *= 2;
+            if ((buffer = realloc(buffer, capacity)) == NULL) {
+                fprintf(stderr, "ERROR: The memory allocation has failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    if (file != stdin)
+        fclose(file);
+    return buffer;
+}
+
+/**
+ * A tiny client for the playfair server: it sends the content of the given file (or of the
+ * standard input) to be encoded or decoded with the KEYFILE with the given ID and writes the
+ * result to the standard output.
+ *
+ * Syntax: playfair_client <socket> <encode|decode> <keyid> [<file>|-]
+ */
+int main(int argc, char **argv) {
+    char status, *response;
+    uint32_t responseSize;
+    size_t inputSize;
+
+    if (argc < 4 || argc > 5 || (strcmp(argv[2], "encode") != 0 && strcmp(argv[2], "decode") != 0)) {
+        fprintf(stderr, "Syntax: %s <socket> <encode|decode> <keyid> [<file>|-]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char *input = readInput(argc == 5 ? argv[4] : "-", &inputSize);
+    int fd = connectToServer(argv[1]);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: cannot connect to the server on '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    char operation = strcmp(argv[2], "encode") == 0 ? PROTOCOL_ENCODE : PROTOCOL_DECODE;
+    if (inputSize > PROTOCOL_MAX_PAYLOAD || sendRequest(fd, operation, argv[3], input, (uint32_t) inputSize) != 0 ||
+        receiveResponse(fd, &status, &response, &responseSize) != 0) {
+        fprintf(stderr, "ERROR: the request to the server has failed\n");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    free(input);
+
+    if (status != PROTOCOL_OK) {
+        fprintf(stderr, "ERROR: %s\n", response);
+        free(response);
+        return EXIT_FAILURE;
+    }
+    fwrite(response, 1, responseSize, stdout);
+    free(response);
+    return EXIT_SUCCESS;
+}
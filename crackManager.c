@@ -0,0 +1,749 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "crackManager.h"
+#include "ngramManager.h"
+#include "threadPool.h"
+#include "printer.h"
+#include "optionManager.h"
+#include "utils.h"
+
+/**
+ * The default amount of ciphertext letters decoded to score every candidate key: the cost of a
+ * candidate grows with the sample (the quadgram lookups of the changed digraphs bound it), while
+ * 400 letters are already enough for the annealing to converge to the key.
+ */
+#define CRACK_SAMPLE 400
+
+/**
+ * The default amount of candidate keys tried at every temperature of the annealing, and
+ * the amount the temperature is lowered by after them.
+ */
+#define CRACK_ITERATIONS 10000
+#define CRACK_STEP 0.2
+
+/**
+ * The letters of the alphabet used when the ciphertext does not contain all the 25 letters
+ * of the matrix.
+ */
+#define CRACK_ALPHABET "ABCDEFGHIKLMNOPQRSTUVWXYZ"
+
+/**
+ * The amount of plaintext letters printed when a better key is found.
+ */
+#define CRACK_PREVIEW 80
+
+/**
+ * The amount of 64-bit words of a set of digraph types (one bit for each of the 26 * 26 digraphs).
+ */
+#define CRACK_TYPE_WORDS ((26 * 26 + 63) / 64)
+
+typedef struct {
+    unsigned char grid[25];
+    unsigned char cell[26];
+} CRACK_KEY;
+
+typedef struct {
+    const QUADGRAMS *quadgrams;
+    const unsigned char *cipher;
+    size_t nLetters;
+    size_t nTypes;
+    unsigned char (*typeLetters)[2];
+    size_t *typeOffsets;
+    size_t *typePositions;
+    uint64_t letterTypes[26][CRACK_TYPE_WORDS];
+    uint64_t allTypes[CRACK_TYPE_WORDS];
+    unsigned char alphabet[25];
+    int nRestarts;
+    int iterations;
+    uint64_t seed;
+    OUTPUT_MODE output;
+    pthread_mutex_t lock;
+    int nextRestart;
+    int hasBest;
+    double bestScore;
+    CRACK_KEY best;
+    uint64_t nCandidates;
+    uint64_t startTime;
+} CRACKER;
+
+typedef struct {
+    CRACKER *cracker;
+    int index;
+} CRACK_WORKER;
+
+/**
+ * The cells of the plaintext digraph of every pair of cells of a ciphertext digraph, which only
+ * depend on the positions in the matrix (see @initDecodeCells()).
+ */
+unsigned char decodeCells[25 * 25][2];
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds.
+ */
+static uint64_t getMonotonicTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Returns the next number of the given xorshift64* generator.
+ */
+static uint64_t nextRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717u;
+}
+
+/**
+ * Returns a random number in [0, @bound) from the given generator.
+ */
+static unsigned randomBelow(uint64_t *state, unsigned bound) {
+    return (unsigned) ((nextRandom(state) >> 32) * bound >> 32);
+}
+
+/**
+ * Fills @decodeCells with the decoding rules of @encoder(): the cells on the left for a digraph on
+ * the same row (or a doubled letter), the cells above for a digraph on the same column and the
+ * opposite corners of the rectangle otherwise.
+ */
+void initDecodeCells() {
+    for (unsigned first = 0; first < 25; first++)
+        for (unsigned second = 0; second < 25; second++) {
+            unsigned r1 = first / 5, c1 = first % 5, r2 = second / 5, c2 = second % 5;
+            unsigned char *cells = decodeCells[first * 25 + second];
+            if (r1 == r2) {
+                cells[0] = r1 * 5 + (c1 + 4) % 5;
+                cells[1] = r2 * 5 + (c2 + 4) % 5;
+            } else if (c1 == c2) {
+                cells[0] = (r1 + 4) % 5 * 5 + c1;
+                cells[1] = (r2 + 4) % 5 * 5 + c2;
+            } else {
+                cells[0] = r1 * 5 + c2;
+                cells[1] = r2 * 5 + c1;
+            }
+        }
+}
+
+/**
+ * Updates the cells of the letters of the given key after its grid changed.
+ */
+static void updateCells(CRACK_KEY *key) {
+    for (unsigned char cell = 0; cell < 25; cell++)
+        key->cell[key->grid[cell]] = cell;
+}
+
+/**
+ * Decodes the given ciphertext letters (0-25) with the given key, with the same rules of
+ * @encoder() looked up in @decodeCells, so that no branch depends on the letters and no memory
+ * is allocated.
+ *
+ * @param key - the key to decode with
+ * @param cipher - the letters to decode, two at a time
+ * @param nLetters - the amount of letters (even)
+ * @param plain - where to write the decoded letters
+ */
+static void decodeLetters(const CRACK_KEY *key, const unsigned char *cipher, size_t nLetters, unsigned char *plain) {
+    for (size_t i = 0; i < nLetters; i += 2) {
+        const unsigned char *cells = decodeCells[key->cell[cipher[i]] * 25 + key->cell[cipher[i + 1]]];
+        plain[i] = key->grid[cells[0]];
+        plain[i + 1] = key->grid[cells[1]];
+    }
+}
+
+/**
+ * Groups the digraphs of the ciphertext by their letters (their type): every type lists the
+ * positions of its digraphs, and every letter the set of the types it appears in, so that a move
+ * of the annealing only decodes again the types it can change (see @decodeTypeChanges()).
+ */
+static void indexCipherTypes(CRACKER *cracker) {
+    size_t nDigraphs = cracker->nLetters / 2, typeOf[26 * 26];
+
+    cracker->typeLetters = memoryMalloc(nDigraphs * sizeof(cracker->typeLetters[0]));
+    cracker->typeOffsets = memoryCalloc(nDigraphs + 1, sizeof(size_t));
+    cracker->typePositions = memoryMalloc(nDigraphs * sizeof(size_t));
+    for (size_t digraph = 0; digraph < 26 * 26; digraph++)
+        typeOf[digraph] = SIZE_MAX;
+    for (size_t i = 0; i < cracker->nLetters; i += 2) {
+        size_t digraph = cracker->cipher[i] * 26 + cracker->cipher[i + 1];
+        if (typeOf[digraph] == SIZE_MAX) {
+            size_t type = typeOf[digraph] = cracker->nTypes++;
+            cracker->typeLetters[type][0] = cracker->cipher[i];
+            cracker->typeLetters[type][1] = cracker->cipher[i + 1];
+            for (int k = 0; k < 2; k++)
+                cracker->letterTypes[cracker->cipher[i + k]][type / 64] |= (uint64_t) 1 << type % 64;
+            cracker->allTypes[type / 64] |= (uint64_t) 1 << type % 64;
+        }
+        cracker->typeOffsets[typeOf[digraph] + 1]++;
+    }
+    for (size_t type = 0; type < cracker->nTypes; type++)
+        cracker->typeOffsets[type + 1] += cracker->typeOffsets[type];
+
+    size_t *next = memoryMalloc(cracker->nTypes * sizeof(size_t));
+    memcpy(next, cracker->typeOffsets, cracker->nTypes * sizeof(size_t));
+    for (size_t i = 0; i < cracker->nLetters; i += 2)
+        cracker->typePositions[next[typeOf[cracker->cipher[i] * 26 + cracker->cipher[i + 1]]]++] = i;
+    free(next);
+}
+
+/**
+ * Decodes every digraph type of the ciphertext with the given key, and lists for every plaintext
+ * letter the set of the types whose decoding contains it.
+ */
+static void decodeTypes(const CRACKER *cracker, const CRACK_KEY *key, unsigned char (*typePlain)[2],
+                        uint64_t (*plainTypes)[CRACK_TYPE_WORDS]) {
+    memset(plainTypes, 0, 26 * sizeof(plainTypes[0]));
+    for (size_t type = 0; type < cracker->nTypes; type++) {
+        const unsigned char *letters = cracker->typeLetters[type];
+        const unsigned char *cells = decodeCells[key->cell[letters[0]] * 25 + key->cell[letters[1]]];
+        for (int k = 0; k < 2; k++) {
+            typePlain[type][k] = key->grid[cells[k]];
+            plainTypes[typePlain[type][k]][type / 64] |= (uint64_t) 1 << type % 64;
+        }
+    }
+}
+
+/**
+ * Decodes again, with the given trial key, the digraph types of the given set and lists the ones
+ * whose decoding differs from the current one. When the trial key only swapped two letters, the
+ * set is the types that contain one of them in the ciphertext (their cells moved) or in the current
+ * plaintext (their cells now hold the other letter): no other type can change.
+ *
+ * @param affected - the set of the types to decode again
+ * @param typePlain - the current decoding of every type
+ * @param changedTypes - where to write the types whose decoding changed
+ * @param newPlain - where to write their new decoding
+ * @return the amount of changed types
+ */
+static size_t decodeTypeChanges(const CRACKER *cracker, const CRACK_KEY *trial, const uint64_t *affected,
+                                const unsigned char (*typePlain)[2], size_t *changedTypes,
+                                unsigned char (*newPlain)[2]) {
+    size_t nChanged = 0;
+
+    for (size_t word = 0; word < CRACK_TYPE_WORDS; word++)
+        for (uint64_t bits = affected[word]; bits != 0; bits &= bits - 1) {
+            size_t type = word * 64 + (size_t) __builtin_ctzll(bits);
+            const unsigned char *letters = cracker->typeLetters[type];
+            const unsigned char *cells = decodeCells[trial->cell[letters[0]] * 25 + trial->cell[letters[1]]];
+            unsigned char first = trial->grid[cells[0]], second = trial->grid[cells[1]];
+            changedTypes[nChanged] = type;
+            newPlain[nChanged][0] = first;
+            newPlain[nChanged][1] = second;
+            nChanged += (first != typePlain[type][0]) | (second != typePlain[type][1]);
+        }
+    return nChanged;
+}
+
+/**
+ * Writes the given decoding of a digraph type at all the positions of its digraphs.
+ */
+static void writeType(const CRACKER *cracker, size_t type, const unsigned char *letters, unsigned char *plain) {
+    for (size_t k = cracker->typeOffsets[type]; k < cracker->typeOffsets[type + 1]; k++) {
+        plain[cracker->typePositions[k]] = letters[0];
+        plain[cracker->typePositions[k] + 1] = letters[1];
+    }
+}
+
+/**
+ * Computes the change of the score of a candidate plaintext from the digraph types that changed
+ * (see @decodeTypeChanges()), whose new decoding is already written in @candidate: the quadgram
+ * windows touching one of their digraphs are collected once each and looked up again.
+ *
+ * @param marks - a zeroed array of @nWindows flags, zeroed again before returning
+ * @param windows - where to write the positions of the windows looked up
+ * @param newScores - where to write their new scores
+ * @param delta - where to write the change of the score
+ * @return the amount of windows looked up
+ */
+static size_t scoreChanges(const CRACKER *cracker, const float *restrict scores,
+                           const unsigned char *restrict candidate, const size_t *restrict changedTypes,
+                           size_t nTypes, const float *restrict windowScores, size_t nWindows,
+                           unsigned char *restrict marks, size_t *restrict windows, float *restrict newScores,
+                           float *delta) {
+    size_t nChanged = 0;
+    float sum = 0;
+
+    for (size_t t = 0; t < nTypes; t++)
+        for (size_t k = cracker->typeOffsets[changedTypes[t]]; k < cracker->typeOffsets[changedTypes[t] + 1]; k++) {
+            size_t position = cracker->typePositions[k];
+            size_t last = position + 1 < nWindows ? position + 1 : nWindows - 1;
+            for (size_t w = position >= 3 ? position - 3 : 0; w <= last; w++) {
+                windows[nChanged] = w;
+                nChanged += !marks[w];
+                marks[w] = 1;
+            }
+        }
+    for (size_t k = 0; k < nChanged; k++) {
+        marks[windows[k]] = 0;
+        newScores[k] = scores[getQuadgramIndex(candidate + windows[k])];
+        sum += newScores[k] - windowScores[windows[k]];
+    }
+    *delta = sum;
+    return nChanged;
+}
+
+/**
+ * Changes the given key with a random move: most of the times two letters are swapped, otherwise
+ * two rows or two columns are swapped, the rows or the columns are reversed or the matrix is
+ * transposed.
+ *
+ * @param swapped - where to write the two letters swapped
+ * @return 1 if two letters were swapped, 0 if the whole matrix was rearranged
+ */
+static int mutateKey(CRACK_KEY *key, uint64_t *random, unsigned char *swapped) {
+    unsigned char copy[25];
+    unsigned move = randomBelow(random, 50), a = randomBelow(random, 5), b = randomBelow(random, 5);
+
+    if (move >= 5) {
+        unsigned first = randomBelow(random, 25), second = randomBelow(random, 25);
+        unsigned char letter = key->grid[first];
+        key->grid[first] = key->grid[second];
+        key->grid[second] = letter;
+        swapped[0] = key->grid[first];
+        swapped[1] = key->grid[second];
+        updateCells(key);
+        return 1;
+    }
+    memcpy(copy, key->grid, 25);
+    for (unsigned r = 0; r < 5; r++)
+        for (unsigned c = 0; c < 5; c++) {
+            unsigned source = r * 5 + c;
+            if (move == 0)
+                source = (r == a ? b : r == b ? a : r) * 5 + c;
+            else if (move == 1)
+                source = r * 5 + (c == a ? b : c == b ? a : c);
+            else if (move == 2)
+                source = (4 - r) * 5 + c;
+            else if (move == 3)
+                source = r * 5 + (4 - c);
+            else source = c * 5 + r;
+            key->grid[r * 5 + c] = copy[source];
+        }
+    updateCells(key);
+    return 0;
+}
+
+/**
+ * Prints the given key as the text of its matrix, row by row.
+ */
+static void printKeyText(const CRACK_KEY *key) {
+    for (int cell = 0; cell < 25; cell++)
+        putchar('A' + key->grid[cell]);
+}
+
+/**
+ * Prints the given decoded letters (at most @CRACK_PREVIEW of them).
+ */
+static void printPreview(const unsigned char *plain, size_t nLetters) {
+    for (size_t i = 0; i < nLetters && i < CRACK_PREVIEW; i++)
+        putchar('A' + plain[i]);
+}
+
+/**
+ * Records the given key as the best one if it scores better than the best one found so far by all
+ * the workers, and reports it with its decoded sample.
+ */
+static void reportKey(CRACKER *cracker, const CRACK_KEY *key, double score, int restart, unsigned char *plain) {
+    pthread_mutex_lock(&cracker->lock);
+    if (!cracker->hasBest || score > cracker->bestScore) {
+        cracker->hasBest = 1;
+        cracker->bestScore = score;
+        cracker->best = *key;
+        decodeLetters(key, cracker->cipher, cracker->nLetters, plain);
+        if (cracker->output == OUTPUT_JSON) {
+            printf("{\"restart\":%d,\"score\":%.2f,\"key\":\"", restart + 1, score);
+            printKeyText(key);
+            printf("\",\"plaintext\":\"");
+            printPreview(plain, cracker->nLetters);
+            printf("\",\"elapsed_ns\":%llu}\n", (unsigned long long) (getMonotonicTime() - cracker->startTime));
+        } else if (cracker->output == OUTPUT_NORMAL) {
+            printf("restart %d, score %.2f: ", restart + 1, score);
+            printKeyText(key);
+            printf("\n    ");
+            printPreview(plain, cracker->nLetters);
+            printf("\n");
+        }
+        fflush(stdout);
+    }
+    pthread_mutex_unlock(&cracker->lock);
+}
+
+/**
+ * Runs restarts of the simulated annealing until all the requested ones have been started.
+ * Every restart begins from a random matrix and, at every temperature from
+ * 10 + 0.087 * (letters - 84) down to 0, tries the given amount of random moves (see
+ * @mutateKey()): a move is accepted if it improves the score, or with probability
+ * exp(delta / temperature) if it worsens it.
+ * The score of a candidate is the sum of the quadgram scores of the decoded sample, and it is
+ * computed incrementally: a swap of two letters (9 moves out of 10) only decodes again the digraph
+ * types that contain one of them (see @decodeTypeChanges()), the other moves decode every type
+ * once, and only the quadgrams touching a changed digraph are looked up again, whose difference
+ * from the cached scores of the current plaintext gives the change of the score. The candidate is
+ * written over the current plaintext and undone if it is rejected, so no memory is allocated.
+ * At the end of every temperature, the best key of the restart is reported if it is the best one
+ * found so far.
+ *
+ * @param argument - the CRACK_WORKER running the restarts
+ */
+static void runCrackWorker(void *argument) {
+    CRACK_WORKER *worker = argument;
+    CRACKER *cracker = worker->cracker;
+    const float *scores = cracker->quadgrams->scores;
+    size_t nLetters = cracker->nLetters, nWindows = nLetters - 3, nTypes = cracker->nTypes;
+    unsigned char *plain = memoryMalloc(nLetters), *report = memoryMalloc(nLetters);
+    unsigned char (*typePlain)[2] = memoryMalloc(nTypes * sizeof(typePlain[0]));
+    unsigned char (*newPlain)[2] = memoryMalloc(nTypes * sizeof(newPlain[0]));
+    uint64_t (*plainTypes)[CRACK_TYPE_WORDS] = memoryMalloc(26 * sizeof(plainTypes[0]));
+    float *windowScores = memoryMalloc(nWindows * sizeof(float)), *newScores = memoryMalloc(nWindows * sizeof(float));
+    size_t *changedTypes = memoryMalloc(nTypes * sizeof(size_t));
+    size_t *windows = memoryMalloc((nWindows + 1) * sizeof(size_t));
+    unsigned char *marks = memoryCalloc(nWindows, 1);
+    uint64_t random = cracker->seed + 0x9E3779B97F4A7C15u * (uint64_t) (worker->index + 1), nCandidates = 0;
+    double startTemperature = 10 + 0.087 * ((double) nLetters - 84);
+    CRACK_KEY key, trial, best;
+    int restart;
+
+    if (startTemperature < 1)
+        startTemperature = 1;
+
+    for (;;) {
+        pthread_mutex_lock(&cracker->lock);
+        restart = cracker->nextRestart++;
+        pthread_mutex_unlock(&cracker->lock);
+        if (restart >= cracker->nRestarts)
+            break;
+
+        memcpy(key.grid, cracker->alphabet, 25);
+        for (unsigned i = 24; i > 0; i--) {
+            unsigned j = randomBelow(&random, i + 1);
+            unsigned char letter = key.grid[i];
+            key.grid[i] = key.grid[j];
+            key.grid[j] = letter;
+        }
+        updateCells(&key);
+        decodeLetters(&key, cracker->cipher, nLetters, plain);
+        decodeTypes(cracker, &key, typePlain, plainTypes);
+        double score = 0, bestScore;
+        for (size_t w = 0; w < nWindows; w++)
+            score += windowScores[w] = scores[getQuadgramIndex(plain + w)];
+        best = key;
+        bestScore = score;
+
+        for (double temperature = startTemperature; temperature > 0; temperature -= CRACK_STEP) {
+            for (int iteration = 0; iteration < cracker->iterations; iteration++) {
+                uint64_t affected[CRACK_TYPE_WORDS];
+                unsigned char swapped[2];
+                float delta;
+
+                trial = key;
+                if (mutateKey(&trial, &random, swapped))
+                    for (size_t word = 0; word < CRACK_TYPE_WORDS; word++)
+                        affected[word] = cracker->letterTypes[swapped[0]][word] |
+                                         cracker->letterTypes[swapped[1]][word] | plainTypes[swapped[0]][word] |
+                                         plainTypes[swapped[1]][word];
+                else memcpy(affected, cracker->allTypes, sizeof(affected));
+                size_t nChangedTypes = decodeTypeChanges(cracker, &trial, affected, typePlain, changedTypes,
+                                                         newPlain);
+                for (size_t t = 0; t < nChangedTypes; t++)
+                    writeType(cracker, changedTypes[t], newPlain[t], plain);
+
+                size_t nChanged = scoreChanges(cracker, scores, plain, changedTypes, nChangedTypes, windowScores,
+                                               nWindows, marks, windows, newScores, &delta);
+                nCandidates++;
+
+                if (delta >= 0 || exp(delta / temperature) > (double) (nextRandom(&random) >> 11) * 0x1.0p-53) {
+                    for (size_t k = 0; k < nChanged; k++)
+                        windowScores[windows[k]] = newScores[k];
+                    for (size_t t = 0; t < nChangedTypes; t++) {
+                        size_t type = changedTypes[t];
+                        uint64_t bit = (uint64_t) 1 << type % 64;
+                        plainTypes[typePlain[type][0]][type / 64] &= ~bit;
+                        plainTypes[typePlain[type][1]][type / 64] &= ~bit;
+                        typePlain[type][0] = newPlain[t][0];
+                        typePlain[type][1] = newPlain[t][1];
+                        plainTypes[typePlain[type][0]][type / 64] |= bit;
+                        plainTypes[typePlain[type][1]][type / 64] |= bit;
+                    }
+                    key = trial;
+                    score += delta;
+                    if (score > bestScore) {
+                        best = key;
+                        bestScore = score;
+                    }
+                } else {
+                    for (size_t t = 0; t < nChangedTypes; t++)
+                        writeType(cracker, changedTypes[t], typePlain[changedTypes[t]], plain);
+                }
+            }
+            reportKey(cracker, &best, bestScore, restart, report);
+        }
+    }
+
+    pthread_mutex_lock(&cracker->lock);
+    cracker->nCandidates += nCandidates;
+    pthread_mutex_unlock(&cracker->lock);
+    free(plain);
+    free(report);
+    free(typePlain);
+    free(newPlain);
+    free(plainTypes);
+    free(windowScores);
+    free(newScores);
+    free(changedTypes);
+    free(windows);
+    free(marks);
+}
+
+/**
+ * Reads the letters of the given ciphertext (up to @maxLetters, an even amount) as numbers 0-25,
+ * and collects the letters it uses.
+ *
+ * @return the amount of letters read, or 0 if the file cannot be read
+ */
+size_t readCipherLetters(const char *path, unsigned char *letters, size_t maxLetters, int *used) {
+    FILE *file = fopen(path, "r");
+    size_t nLetters = 0;
+    int c;
+
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", path);
+        return 0;
+    }
+    while (nLetters < maxLetters && (c = getc(file)) != EOF) {
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        if (c >= 'A' && c <= 'Z') {
+            letters[nLetters++] = (unsigned char) (c - 'A');
+            used[c - 'A'] = 1;
+        }
+    }
+    fclose(file);
+    return nLetters - nLetters % 2;
+}
+
+/**
+ * Chooses the 25 letters of the matrix: the ones of the given alphabet, or the ones used by the
+ * ciphertext completed with the letters of @CRACK_ALPHABET.
+ *
+ * @return 0 if the letters are 25, -1 otherwise
+ */
+int chooseAlphabet(const char *alphabetText, const int *used, unsigned char *alphabet) {
+    int chosen[26] = {0}, nChosen = 0;
+
+    if (alphabetText != NULL) {
+        for (const char *c = alphabetText; *c != '\0'; c++) {
+            int letter = (*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c) - 'A';
+            if (letter >= 0 && letter < 26 && !chosen[letter] && nChosen < 26) {
+                chosen[letter] = 1;
+                nChosen++;
+            }
+        }
+        for (int letter = 0; letter < 26; letter++)
+            if (used[letter] && !chosen[letter])
+                return -1;
+    } else {
+        for (int letter = 0; letter < 26; letter++)
+            if (used[letter]) {
+                chosen[letter] = 1;
+                nChosen++;
+            }
+        for (const char *c = CRACK_ALPHABET; *c != '\0' && nChosen < 25; c++)
+            if (!chosen[*c - 'A']) {
+                chosen[*c - 'A'] = 1;
+                nChosen++;
+            }
+    }
+    if (nChosen != 25)
+        return -1;
+    for (int letter = 0, k = 0; letter < 26; letter++)
+        if (chosen[letter])
+            alphabet[k++] = (unsigned char) letter;
+    return 0;
+}
+
+/**
+ * Returns the replacement character (0-25) of a KEYFILE with the given alphabet: the letter before
+ * the missing one (e.g. 'I' for 'J'), or 'B' if the missing one is 'A'.
+ */
+int getReplacementLetter(const unsigned char *alphabet) {
+    int missing = 0;
+
+    for (int k = 0; k < 25 && alphabet[k] == missing; k++)
+        missing++;
+    return missing > 0 ? missing - 1 : 1;
+}
+
+/**
+ * Returns the special character (0-25) of a KEYFILE with the given alphabet: 'X' if it is in the
+ * alphabet, its last letter otherwise.
+ */
+int getSpecialLetter(const unsigned char *alphabet) {
+    for (int k = 0; k < 25; k++)
+        if (alphabet[k] == 'X' - 'A')
+            return 'X' - 'A';
+    return alphabet[24];
+}
+
+/**
+ * Writes the given matrix as a KEYFILE: the alphabet, the replacement character (see
+ * @getReplacementLetter()), the given special character and the text of the matrix as key, which
+ * rebuilds exactly the same matrix.
+ *
+ * @param path - the path of the KEYFILE
+ * @param alphabet - the 25 letters (0-25) of the matrix
+ * @param grid - the letters (0-25) of the matrix, row by row
+ * @param specialLetter - the special character (0-25)
+ * @return 0 if the KEYFILE was written, -1 otherwise
+ */
+int writeMatrixKeyFile(const char *path, const unsigned char *alphabet, const unsigned char *grid, int specialLetter) {
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL)
+        return -1;
+    for (int k = 0; k < 25; k++)
+        fputc('A' + alphabet[k], file);
+    fprintf(file, "\n%c\n%c\n", 'A' + getReplacementLetter(alphabet), 'A' + specialLetter);
+    for (int cell = 0; cell < 25; cell++)
+        fputc('A' + grid[cell], file);
+    fputc('\n', file);
+    int failed = ferror(file);
+    failed |= fclose(file) != 0;
+    return failed ? -1 : 0;
+}
+
+/**
+ * Prints the correct syntax of the crack command and ends the program.
+ */
+static void printCrackUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE KEY RECOVERY:\n");
+    fprintf(stderr, "'<playfair> crack --ngrams <file> [--threads <n>] [--restarts <n>] [--iterations <n>] "
+                    "[--sample <letters>] [--seed <n>] [--alphabet <letters>] [--output <keyfile>] "
+                    "[--quiet|--json] <cipherfile>'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Recovers the key of a ciphertext without knowing any of its plaintext, with parallel restarts
+ * of a simulated annealing over the 5x5 matrices (see @runCrackWorker()) scored with the quadgram
+ * statistics of the language of the plaintext (see @loadQuadgrams()).
+ * Only a sample of the first letters of the ciphertext is decoded for every candidate key.
+ * Every time a better key is found it is printed with the beginning of its plaintext, and at the
+ * end the best key can be written as a KEYFILE usable by the other commands.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if a key was found (and written), EXIT_FAILURE otherwise
+ */
+int startCracker(int argc, char **argv) {
+    CRACKER cracker;
+    QUADGRAMS quadgrams;
+    char *ngramsPath = NULL, *alphabetText = NULL, *outputPath = NULL;
+    size_t nThreads = getDefaultThreadCount(), sampleSize = CRACK_SAMPLE;
+    int i = 2, used[26] = {0};
+
+    memset(&cracker, 0, sizeof(cracker));
+    cracker.iterations = CRACK_ITERATIONS;
+    cracker.seed = (uint64_t) time(NULL);
+    cracker.output = OUTPUT_NORMAL;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (i + 1 >= argc && strcmp(argv[i], "--quiet") != 0 && strcmp(argv[i], "--json") != 0)
+            printCrackUsage();
+        if (strcmp(argv[i], "--ngrams") == 0)
+            ngramsPath = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && atoi(argv[i + 1]) > 0)
+            nThreads = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--restarts") == 0 && atoi(argv[i + 1]) > 0)
+            cracker.nRestarts = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--iterations") == 0 && atoi(argv[i + 1]) > 0)
+            cracker.iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sample") == 0 && atoi(argv[i + 1]) >= 8)
+            sampleSize = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            cracker.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--alphabet") == 0)
+            alphabetText = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0)
+            outputPath = argv[++i];
+        else if (strcmp(argv[i], "--quiet") == 0)
+            cracker.output = OUTPUT_QUIET;
+        else if (strcmp(argv[i], "--json") == 0)
+            cracker.output = OUTPUT_JSON;
+        else printCrackUsage();
+    }
+    if (argc - i != 1 || ngramsPath == NULL)
+        printCrackUsage();
+    if (cracker.nRestarts == 0)
+        cracker.nRestarts = 2 * (int) nThreads;
+    cracker.seed |= 1;
+
+    unsigned char *cipher = memoryMalloc(sampleSize);
+    cracker.nLetters = readCipherLetters(argv[i], cipher, sampleSize, used);
+    if (cracker.nLetters < 8) {
+        fprintf(stderr, "\nERROR: the ciphertext '%s' is too short to recover its key!\n\n", argv[i]);
+        free(cipher);
+        return EXIT_FAILURE;
+    }
+    if (chooseAlphabet(alphabetText, used, cracker.alphabet) != 0) {
+        fprintf(stderr, "\nERROR: the alphabet of the matrix must contain 25 letters, including all the ones "
+                        "of the ciphertext!\n\n");
+        free(cipher);
+        return EXIT_FAILURE;
+    }
+    if (loadQuadgrams(ngramsPath, &quadgrams) != 0) {
+        free(cipher);
+        return EXIT_FAILURE;
+    }
+    cracker.cipher = cipher;
+    cracker.quadgrams = &quadgrams;
+    indexCipherTypes(&cracker);
+    initDecodeCells();
+    cracker.startTime = getMonotonicTime();
+    pthread_mutex_init(&cracker.lock, NULL);
+
+    CRACK_WORKER *workers = memoryCalloc(nThreads, sizeof(CRACK_WORKER));
+    THREAD_POOL *pool = nThreads > 1 ? createThreadPool(nThreads) : NULL;
+    for (size_t w = 0; w < nThreads; w++) {
+        workers[w].cracker = &cracker;
+        workers[w].index = (int) w;
+        if (pool != NULL)
+            submitTask(pool, runCrackWorker, &workers[w]);
+        else runCrackWorker(&workers[w]);
+    }
+    if (pool != NULL) {
+        waitThreadPool(pool);
+        destroyThreadPool(pool);
+    }
+
+    uint64_t elapsedTime = getMonotonicTime() - cracker.startTime;
+    double rate = (double) cracker.nCandidates / ((double) elapsedTime / 1e9);
+    if (cracker.output == OUTPUT_JSON)
+        printf("{\"best_score\":%.2f,\"candidates\":%llu,\"candidates_per_second\":%.0f,\"elapsed_ns\":%llu}\n",
+               cracker.bestScore, (unsigned long long) cracker.nCandidates, rate, (unsigned long long) elapsedTime);
+    else if (cracker.output == OUTPUT_NORMAL) {
+        printf("\nbest key (score %.2f): ", cracker.bestScore);
+        printKeyText(&cracker.best);
+        printf("\ncandidates: %llu (%.0f per second)\n\n", (unsigned long long) cracker.nCandidates, rate);
+    }
+    int result = EXIT_SUCCESS;
+    if (outputPath != NULL && writeMatrixKeyFile(outputPath, cracker.alphabet, cracker.best.grid, getSpecialLetter(cracker.alphabet)) != 0) {
+        fprintf(stderr, "\nERROR: the KEYFILE '%s' cannot be written!\n\n", outputPath);
+        result = EXIT_FAILURE;
+    }
+
+    pthread_mutex_destroy(&cracker.lock);
+    free(workers);
+    free(cracker.typeLetters);
+    free(cracker.typeOffsets);
+    free(cracker.typePositions);
+    free(cipher);
+    freeQuadgrams(&quadgrams);
+    return result;
+}
@@ -0,0 +1,23 @@
+
+#ifndef PLAYFAIR_CRACKMANAGER_H
+#define PLAYFAIR_CRACKMANAGER_H
+
+#include <stddef.h>
+
+extern unsigned char decodeCells[25 * 25][2];
+
+void initDecodeCells();
+
+size_t readCipherLetters(const char *path, unsigned char *letters, size_t maxLetters, int *used);
+
+int chooseAlphabet(const char *alphabetText, const int *used, unsigned char *alphabet);
+
+int getReplacementLetter(const unsigned char *alphabet);
+
+int getSpecialLetter(const unsigned char *alphabet);
+
+int writeMatrixKeyFile(const char *path, const unsigned char *alphabet, const unsigned char *grid, int specialLetter);
+
+int startCracker(int argc, char **argv);
+
+#endif //PLAYFAIR_CRACKMANAGER_H
@@ -0,0 +1,511 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cribManager.h"
+#include "utils.h"
+#include "crackManager.h"
+#include "fileManager.h"
+#include "threadPool.h"
+#include "optionManager.h"
+
+/**
+ * The default amount of candidate matrices printed.
+ */
+#define CRIB_LIMIT 10
+
+/**
+ * The minimum amount of ciphertext digraphs tried by a single job.
+ */
+#define CRIB_JOB_DIGRAPHS 4096
+
+/**
+ * The marker of a letter not placed in the matrix yet and of an empty cell.
+ */
+#define CRIB_EMPTY 0xFF
+
+typedef struct {
+    unsigned char plain[2];
+    unsigned char cipher[2];
+} CRIB_PAIR;
+
+typedef struct {
+    uint64_t letter;
+    int fixed;
+    unsigned char grid[25];
+} CRIB_CANDIDATE;
+
+typedef struct {
+    const unsigned char *cipher;
+    size_t nDigraphs;
+    unsigned char *splits[2];
+    size_t nPairs[2];
+    unsigned char alphabet[25];
+    size_t limit;
+} CRIBBER;
+
+typedef struct {
+    unsigned char cellOf[26];
+    unsigned char letterAt[25];
+    unsigned char trail[25];
+    int nTrail;
+    CRIB_PAIR *pairs;
+    size_t nPairs;
+} CRIB_SOLVER;
+
+typedef struct {
+    const CRIBBER *cribber;
+    int parity;
+    size_t first;
+    size_t last;
+    CRIB_CANDIDATE *candidates;
+    size_t nCandidates;
+    size_t capacity;
+} CRIB_JOB;
+
+/**
+ * The cells of the ciphertext digraph of every pair of cells of a plaintext digraph, which only
+ * depend on the positions in the matrix (see @initEncodeCells()), like @decodeCells for the
+ * decoding.
+ */
+static unsigned char encodeCells[25 * 25][2];
+
+/**
+ * Fills @encodeCells with the rules of @encoder(): the cells on the right for a digraph on the same
+ * row or a doubled letter, the cells below for a digraph on the same column and the opposite
+ * corners of the rectangle otherwise.
+ */
+static void initEncodeCells() {
+    for (unsigned first = 0; first < 25; first++)
+        for (unsigned second = 0; second < 25; second++) {
+            unsigned r1 = first / 5, c1 = first % 5, r2 = second / 5, c2 = second % 5, pair = first * 25 + second;
+            if (r1 == r2) {
+                encodeCells[pair][0] = r1 * 5 + (c1 + 1) % 5;
+                encodeCells[pair][1] = r2 * 5 + (c2 + 1) % 5;
+            } else if (c1 == c2) {
+                encodeCells[pair][0] = (r1 + 1) % 5 * 5 + c1;
+                encodeCells[pair][1] = (r2 + 1) % 5 * 5 + c2;
+            } else {
+                encodeCells[pair][0] = r1 * 5 + c2;
+                encodeCells[pair][1] = r2 * 5 + c1;
+            }
+        }
+}
+
+/**
+ * Places the given letter in the given cell of the matrix of the solver, recording it so that it
+ * can be undone.
+ *
+ * @return 1 if the letter is (or already was) in that cell, 0 if it is elsewhere or the cell is taken
+ */
+static int placeLetter(CRIB_SOLVER *solver, unsigned char letter, unsigned char cell) {
+    if (solver->cellOf[letter] != CRIB_EMPTY)
+        return solver->cellOf[letter] == cell;
+    if (solver->letterAt[cell] != CRIB_EMPTY)
+        return 0;
+    solver->cellOf[letter] = cell;
+    solver->letterAt[cell] = letter;
+    solver->trail[solver->nTrail++] = letter;
+    return 1;
+}
+
+/**
+ * Removes from the matrix of the solver the letters placed after the given point of its trail.
+ */
+static void undoLetters(CRIB_SOLVER *solver, int nTrail) {
+    while (solver->nTrail > nTrail) {
+        unsigned char letter = solver->trail[--solver->nTrail];
+        solver->letterAt[solver->cellOf[letter]] = CRIB_EMPTY;
+        solver->cellOf[letter] = CRIB_EMPTY;
+    }
+}
+
+/**
+ * Applies the constraints of the solver until nothing changes: when both the letters of a plaintext
+ * digraph are placed, the cells of its ciphertext digraph are forced by the rules of the cipher,
+ * and the other way round.
+ *
+ * @return 1 if the placed letters satisfy all the constraints, 0 otherwise
+ */
+static int propagateConstraints(CRIB_SOLVER *solver) {
+    int nTrail;
+
+    do {
+        nTrail = solver->nTrail;
+        for (size_t k = 0; k < solver->nPairs; k++) {
+            const CRIB_PAIR *pair = &solver->pairs[k];
+            unsigned char p1 = solver->cellOf[pair->plain[0]], p2 = solver->cellOf[pair->plain[1]];
+            unsigned char c1 = solver->cellOf[pair->cipher[0]], c2 = solver->cellOf[pair->cipher[1]];
+            if (p1 != CRIB_EMPTY && p2 != CRIB_EMPTY) {
+                const unsigned char *cells = encodeCells[p1 * 25 + p2];
+                if (!placeLetter(solver, pair->cipher[0], cells[0]) || !placeLetter(solver, pair->cipher[1], cells[1]))
+                    return 0;
+            } else if (c1 != CRIB_EMPTY && c2 != CRIB_EMPTY) {
+                const unsigned char *cells = decodeCells[c1 * 25 + c2];
+                if (!placeLetter(solver, pair->plain[0], cells[0]) || !placeLetter(solver, pair->plain[1], cells[1]))
+                    return 0;
+            }
+        }
+    } while (solver->nTrail != nTrail);
+    return 1;
+}
+
+/**
+ * Chooses the next letter to place: one whose partner in a digraph is already placed (so that
+ * placing it fires a constraint), otherwise any letter of the constraints not placed yet.
+ *
+ * @return the letter, or CRIB_EMPTY if all the letters of the constraints are placed
+ */
+static unsigned char chooseLetter(const CRIB_SOLVER *solver) {
+    unsigned char fallback = CRIB_EMPTY;
+
+    for (size_t k = 0; k < solver->nPairs; k++) {
+        const unsigned char *letters[2] = {solver->pairs[k].plain, solver->pairs[k].cipher};
+        for (int side = 0; side < 2; side++)
+            for (int i = 0; i < 2; i++) {
+                if (solver->cellOf[letters[side][i]] != CRIB_EMPTY)
+                    continue;
+                if (solver->cellOf[letters[side][1 - i]] != CRIB_EMPTY)
+                    return letters[side][i];
+                if (fallback == CRIB_EMPTY)
+                    fallback = letters[side][i];
+            }
+    }
+    return fallback;
+}
+
+/**
+ * Records the matrix of the solver as a candidate of the job, filling its empty cells with the
+ * letters of the alphabet not placed, in order.
+ */
+static void addCandidate(CRIB_JOB *job, const CRIB_SOLVER *solver, uint64_t letter) {
+    CRIB_CANDIDATE *candidate;
+    size_t next = 0;
+
+    if (job->nCandidates == job->capacity) {
+        job->capacity = job->capacity == 0 ? 16 : job->capacity * 2;
+        job->candidates = memoryRealloc(job->candidates, job->capacity * sizeof(CRIB_CANDIDATE));
+    }
+    candidate = &job->candidates[job->nCandidates++];
+    candidate->letter = letter;
+    candidate->fixed = solver->nTrail;
+    for (int cell = 0; cell < 25; cell++) {
+        if (solver->letterAt[cell] != CRIB_EMPTY) {
+            candidate->grid[cell] = solver->letterAt[cell];
+            continue;
+        }
+        while (solver->cellOf[job->cribber->alphabet[next]] != CRIB_EMPTY)
+            next++;
+        candidate->grid[cell] = job->cribber->alphabet[next++];
+    }
+}
+
+/**
+ * Searches with backtracking the matrices satisfying the constraints of the solver, adding them
+ * to the job until its limit is reached.
+ * Since shifting the rows or the columns of a matrix cyclically does not change the cipher, the
+ * first letter placed in an empty matrix is only tried in the first cell.
+ *
+ * @return 1 if the limit of candidates has been reached, 0 otherwise
+ */
+static int solveConstraints(CRIB_SOLVER *solver, CRIB_JOB *job, uint64_t letter) {
+    int nTrail = solver->nTrail;
+
+    if (!propagateConstraints(solver)) {
+        undoLetters(solver, nTrail);
+        return 0;
+    }
+    unsigned char next = chooseLetter(solver);
+    if (next == CRIB_EMPTY) {
+        addCandidate(job, solver, letter);
+        undoLetters(solver, nTrail);
+        return job->nCandidates >= job->cribber->limit;
+    }
+    int nCells = solver->nTrail == 0 ? 1 : 25, stop = 0;
+    for (unsigned char cell = 0; cell < nCells && !stop; cell++) {
+        if (solver->letterAt[cell] != CRIB_EMPTY)
+            continue;
+        int placed = solver->nTrail;
+        placeLetter(solver, next, cell);
+        stop = solveConstraints(solver, job, letter);
+        undoLetters(solver, placed);
+    }
+    undoLetters(solver, nTrail);
+    return stop;
+}
+
+/**
+ * Tries the crib at the ciphertext digraphs of the job: at every position, the digraphs of the
+ * crib and the ones of the ciphertext become the constraints of a solver (see
+ * @solveConstraints()). Positions where a letter would be encoded to itself, which the cipher never
+ * does, are skipped without solving.
+ *
+ * @param argument - the CRIB_JOB to run
+ */
+static void runCribJob(void *argument) {
+    CRIB_JOB *job = argument;
+    const CRIBBER *cribber = job->cribber;
+    const unsigned char *split = cribber->splits[job->parity];
+    size_t nPairs = cribber->nPairs[job->parity];
+    CRIB_SOLVER solver;
+
+    solver.pairs = memoryMalloc(nPairs * sizeof(CRIB_PAIR));
+    memset(solver.cellOf, CRIB_EMPTY, sizeof(solver.cellOf));
+    memset(solver.letterAt, CRIB_EMPTY, sizeof(solver.letterAt));
+    solver.nTrail = 0;
+
+    for (size_t digraph = job->first; digraph < job->last; digraph++) {
+        const unsigned char *cipher = cribber->cipher + 2 * digraph;
+        size_t k = 0;
+        for (; k < 2 * nPairs && split[k] != cipher[k]; k++);
+        if (k < 2 * nPairs)
+            continue;
+
+        solver.nPairs = 0;
+        for (k = 0; k < nPairs; k++) {
+            size_t same = 0;
+            for (; same < solver.nPairs; same++)
+                if (memcmp(solver.pairs[same].plain, split + 2 * k, 2) == 0 &&
+                    memcmp(solver.pairs[same].cipher, cipher + 2 * k, 2) == 0)
+                    break;
+            if (same < solver.nPairs)
+                continue;
+            memcpy(solver.pairs[solver.nPairs].plain, split + 2 * k, 2);
+            memcpy(solver.pairs[solver.nPairs].cipher, cipher + 2 * k, 2);
+            solver.nPairs++;
+        }
+        if (solveConstraints(&solver, job, 2 * digraph - (uint64_t) job->parity))
+            break;
+    }
+    free(solver.pairs);
+}
+
+/**
+ * Splits the given crib letters (0-25) into plaintext digraphs like @splitStream() does, starting
+ * from the given letter: a doubled letter is paired with the special character, and a last
+ * letter without its pair is dropped.
+ *
+ * @param pairs - where to write the letters of the digraphs (at least twice the crib letters)
+ * @return the amount of digraphs
+ */
+static size_t splitCrib(const unsigned char *crib, size_t nLetters, size_t start, int specialLetter,
+                        unsigned char *pairs) {
+    size_t nPairs = 0;
+    int pending = -1;
+
+    for (size_t i = start; i < nLetters; i++) {
+        if (pending < 0)
+            pending = crib[i];
+        else if (pending == crib[i]) {
+            pairs[2 * nPairs] = (unsigned char) pending;
+            pairs[2 * nPairs++ + 1] = (unsigned char) specialLetter;
+        } else {
+            pairs[2 * nPairs] = (unsigned char) pending;
+            pairs[2 * nPairs++ + 1] = crib[i];
+            pending = -1;
+        }
+    }
+    return nPairs;
+}
+
+/**
+ * Orders the candidates by their position in the ciphertext.
+ */
+static int compareCandidates(const void *first, const void *second) {
+    const CRIB_CANDIDATE *a = first, *b = second;
+    return (a->letter > b->letter) - (a->letter < b->letter);
+}
+
+/**
+ * Prints the correct syntax of the crib command and ends the program.
+ */
+static void printCribUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE KNOWN PLAINTEXT ATTACK:\n");
+    fprintf(stderr, "'<playfair> crib [--threads <n>] [--limit <n>] [--alphabet <letters>] [--special <letter>] "
+                    "[--output <dir>] [--quiet|--json] <cipherfile> <crib>'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Reconstructs the matrices that encode a known fragment of the plaintext (the crib) into a part of
+ * the given ciphertext.
+ * The crib is split into digraphs at both the positions its first letter can have in a digraph and
+ * slid over every digraph of the ciphertext, in parallel jobs; at every position the digraphs
+ * become constraints on the cells of their letters, solved with a backtracking search (see
+ * @runCribJob()). The letters not involved in the constraints are placed in alphabetical order.
+ * The candidates are printed in the order of their position in the ciphertext as KEYFILEs, and
+ * with --output they are also written as KEYFILEs in the given directory.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if at least a matrix was found, EXIT_FAILURE otherwise
+ */
+int startCribber(int argc, char **argv) {
+    CRIBBER cribber;
+    OUTPUT_MODE output = OUTPUT_NORMAL;
+    char *alphabetText = NULL, *outputDir = NULL, *special = NULL;
+    size_t nThreads = getDefaultThreadCount();
+    int i = 2, used[26] = {0};
+
+    memset(&cribber, 0, sizeof(cribber));
+    cribber.limit = CRIB_LIMIT;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (i + 1 >= argc && strcmp(argv[i], "--quiet") != 0 && strcmp(argv[i], "--json") != 0)
+            printCribUsage();
+        if (strcmp(argv[i], "--threads") == 0 && atoi(argv[i + 1]) > 0)
+            nThreads = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--limit") == 0 && atoi(argv[i + 1]) > 0)
+            cribber.limit = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--alphabet") == 0)
+            alphabetText = argv[++i];
+        else if (strcmp(argv[i], "--special") == 0)
+            special = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0)
+            outputDir = argv[++i];
+        else if (strcmp(argv[i], "--quiet") == 0)
+            output = OUTPUT_QUIET;
+        else if (strcmp(argv[i], "--json") == 0)
+            output = OUTPUT_JSON;
+        else printCribUsage();
+    }
+    if (argc - i != 2)
+        printCribUsage();
+    char *cipherPath = argv[i], *cribText = argv[i + 1];
+
+    FILE *file = fopen(cipherPath, "r");
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", cipherPath);
+        return EXIT_FAILURE;
+    }
+    size_t fileSize = getFileSize(file);
+    fclose(file);
+    unsigned char *cipher = memoryMalloc(fileSize + 1), *crib = memoryMalloc(strlen(cribText) + 1);
+    unsigned char *pairs = memoryMalloc(4 * strlen(cribText) + 4);
+    size_t nLetters = readCipherLetters(cipherPath, cipher, fileSize, used);
+
+    size_t nCrib = 0;
+    for (const char *c = cribText; *c != '\0'; c++) {
+        int letter = (*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c) - 'A';
+        if (letter >= 0 && letter < 26)
+            crib[nCrib++] = (unsigned char) letter;
+    }
+    int inAlphabet[26] = {0}, specialLetter;
+    if (chooseAlphabet(alphabetText, used, cribber.alphabet) != 0) {
+        fprintf(stderr, "\nERROR: the alphabet of the matrix must contain 25 letters, including all the ones "
+                        "of the ciphertext!\n\n");
+        free(cipher);
+        free(crib);
+        free(pairs);
+        return EXIT_FAILURE;
+    }
+    for (int k = 0; k < 25; k++)
+        inAlphabet[cribber.alphabet[k]] = 1;
+    for (size_t k = 0; k < nCrib; k++)
+        if (!inAlphabet[crib[k]])
+            crib[k] = (unsigned char) getReplacementLetter(cribber.alphabet);
+    specialLetter = getSpecialLetter(cribber.alphabet);
+    if (special != NULL) {
+        specialLetter = (special[0] >= 'a' && special[0] <= 'z' ? special[0] - 'a' + 'A' : special[0]) - 'A';
+        if (specialLetter < 0 || specialLetter >= 26 || !inAlphabet[specialLetter] || special[1] != '\0') {
+            fprintf(stderr, "\nERROR: the special character must be a letter of the alphabet!\n\n");
+            free(cipher);
+            free(crib);
+            free(pairs);
+            return EXIT_FAILURE;
+        }
+    }
+    cribber.cipher = cipher;
+    cribber.nDigraphs = nLetters / 2;
+    cribber.splits[0] = pairs;
+    cribber.splits[1] = pairs + 2 * nCrib + 2;
+    cribber.nPairs[0] = splitCrib(crib, nCrib, 0, specialLetter, cribber.splits[0]);
+    cribber.nPairs[1] = splitCrib(crib, nCrib, 1, specialLetter, cribber.splits[1]);
+    if (cribber.nPairs[1] < 2) {
+        fprintf(stderr, "\nERROR: the crib must contain at least 5 letters!\n\n");
+        free(cipher);
+        free(crib);
+        free(pairs);
+        return EXIT_FAILURE;
+    }
+    initEncodeCells();
+    initDecodeCells();
+
+    size_t nJobs = 0, chunk = cribber.nDigraphs / (4 * nThreads) + 1;
+    if (chunk < CRIB_JOB_DIGRAPHS)
+        chunk = CRIB_JOB_DIGRAPHS;
+    CRIB_JOB *jobs = memoryCalloc(2 * (cribber.nDigraphs / chunk + 1), sizeof(CRIB_JOB));
+    for (int parity = 0; parity < 2; parity++) {
+        size_t first = (size_t) parity, end = cribber.nDigraphs + 1;
+        end = end > cribber.nPairs[parity] ? end - cribber.nPairs[parity] : 0;
+        for (; first < end; first += chunk) {
+            jobs[nJobs].cribber = &cribber;
+            jobs[nJobs].parity = parity;
+            jobs[nJobs].first = first;
+            jobs[nJobs].last = first + chunk < end ? first + chunk : end;
+            nJobs++;
+        }
+    }
+    THREAD_POOL *pool = nThreads > 1 && nJobs > 1 ? createThreadPool(nThreads) : NULL;
+    for (size_t j = 0; j < nJobs; j++) {
+        if (pool != NULL)
+            submitTask(pool, runCribJob, &jobs[j]);
+        else runCribJob(&jobs[j]);
+    }
+    if (pool != NULL) {
+        waitThreadPool(pool);
+        destroyThreadPool(pool);
+    }
+
+    size_t nCandidates = 0;
+    for (size_t j = 0; j < nJobs; j++)
+        nCandidates += jobs[j].nCandidates;
+    CRIB_CANDIDATE *candidates = memoryMalloc((nCandidates + 1) * sizeof(CRIB_CANDIDATE));
+    nCandidates = 0;
+    for (size_t j = 0; j < nJobs; j++) {
+        memcpy(candidates + nCandidates, jobs[j].candidates, jobs[j].nCandidates * sizeof(CRIB_CANDIDATE));
+        nCandidates += jobs[j].nCandidates;
+        free(jobs[j].candidates);
+    }
+    qsort(candidates, nCandidates, sizeof(CRIB_CANDIDATE), compareCandidates);
+    if (nCandidates > cribber.limit)
+        nCandidates = cribber.limit;
+
+    int result = nCandidates > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    for (size_t c = 0; c < nCandidates; c++) {
+        const CRIB_CANDIDATE *candidate = &candidates[c];
+        if (output == OUTPUT_JSON) {
+            printf("{\"letter\":%llu,\"fixed\":%d,\"key\":\"", (unsigned long long) candidate->letter, candidate->fixed);
+            for (int cell = 0; cell < 25; cell++)
+                putchar('A' + candidate->grid[cell]);
+            printf("\"}\n");
+        } else if (output == OUTPUT_NORMAL) {
+            printf("letter %llu, %d letters fixed:\n", (unsigned long long) candidate->letter, candidate->fixed);
+            for (int k = 0; k < 25; k++)
+                putchar('A' + cribber.alphabet[k]);
+            printf("\n%c\n%c\n", 'A' + getReplacementLetter(cribber.alphabet), 'A' + specialLetter);
+            for (int cell = 0; cell < 25; cell++)
+                putchar('A' + candidate->grid[cell]);
+            printf("\n\n");
+        }
+        if (outputDir != NULL) {
+            char *path = memoryMalloc(strlen(outputDir) + 32);
+            sprintf(path, "%s/candidate%zu", outputDir, c + 1);
+            if (writeMatrixKeyFile(path, cribber.alphabet, candidate->grid, specialLetter) != 0) {
+                fprintf(stderr, "\nERROR: the KEYFILE '%s' cannot be written!\n\n", path);
+                result = EXIT_FAILURE;
+            }
+            free(path);
+        }
+    }
+    if (output == OUTPUT_NORMAL && nCandidates == 0)
+        printf("no matrix encodes the crib into the ciphertext\n");
+
+    free(candidates);
+    free(jobs);
+    free(cipher);
+    free(crib);
+    free(pairs);
+    return result;
+}
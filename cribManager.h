@@ -0,0 +1,7 @@
+
+#ifndef PLAYFAIR_CRIBMANAGER_H
+#define PLAYFAIR_CRIBMANAGER_H
+
+int startCribber(int argc, char **argv);
+
+#endif //PLAYFAIR_CRIBMANAGER_H
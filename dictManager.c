@@ -0,0 +1,414 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dictManager.h"
+#include "utils.h"
+#include "crackManager.h"
+#include "ngramManager.h"
+#include "threadPool.h"
+#include "optionManager.h"
+
+/**
+ * The default amount of ciphertext letters decoded to score every key.
+ */
+#define DICT_SAMPLE 100
+
+/**
+ * The default amount of best keys kept.
+ */
+#define DICT_TOP 10
+
+/**
+ * The minimum size of the part of the wordlist read by a single job.
+ */
+#define DICT_JOB_SIZE (1 << 20)
+
+/**
+ * The amount of plaintext letters printed for every key.
+ */
+#define DICT_PREVIEW 60
+
+/**
+ * The marker of a character that is not a letter.
+ */
+#define DICT_SKIP 0xFF
+
+typedef struct {
+    float score;
+    uint64_t offset;
+    uint32_t length;
+    unsigned char grid[25];
+} DICT_RESULT;
+
+typedef struct {
+    const char *words;
+    size_t size;
+    const float *scores;
+    const unsigned char *cipher;
+    size_t nLetters;
+    unsigned char alphabet[25];
+    uint32_t alphabetMask;
+    unsigned char letterMap[256];
+    size_t top;
+} DICTIONARY;
+
+typedef struct {
+    const DICTIONARY *dictionary;
+    size_t start;
+    size_t end;
+    DICT_RESULT *heap;
+    size_t nHeap;
+    uint64_t nKeys;
+} DICT_JOB;
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds.
+ */
+static uint64_t getMonotonicTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Restores the order of the min-heap of the given results (the worst one on top) from the given
+ * position down.
+ */
+static void siftDown(DICT_RESULT *heap, size_t nHeap, size_t position) {
+    for (;;) {
+        size_t smallest = position, left = 2 * position + 1, right = left + 1;
+        if (left < nHeap && heap[left].score < heap[smallest].score)
+            smallest = left;
+        if (right < nHeap && heap[right].score < heap[smallest].score)
+            smallest = right;
+        if (smallest == position)
+            return;
+        DICT_RESULT swap = heap[position];
+        heap[position] = heap[smallest];
+        heap[smallest] = swap;
+        position = smallest;
+    }
+}
+
+/**
+ * Adds the given result to the top-K heap of the job, replacing its worst result when the heap is
+ * full. A key whose matrix is already in the heap (e.g. "KEY" and "KEYS" with an alphabet ending
+ * with 'S') is not added twice.
+ */
+static void addResult(DICT_JOB *job, const DICT_RESULT *result) {
+    for (size_t k = 0; k < job->nHeap; k++)
+        if (memcmp(job->heap[k].grid, result->grid, 25) == 0)
+            return;
+    if (job->nHeap < job->dictionary->top) {
+        size_t position = job->nHeap++;
+        job->heap[position] = *result;
+        while (position > 0 && job->heap[(position - 1) / 2].score > job->heap[position].score) {
+            DICT_RESULT swap = job->heap[position];
+            job->heap[position] = job->heap[(position - 1) / 2];
+            job->heap[(position - 1) / 2] = swap;
+            position = (position - 1) / 2;
+        }
+    } else {
+        job->heap[0] = *result;
+        siftDown(job->heap, job->nHeap, 0);
+    }
+}
+
+/**
+ * Derives the matrix of every word of the part of the wordlist of the job and scores it, keeping
+ * the best ones in the heap of the job.
+ * The matrix is built like @getMatrixText() does, but on letters 0-25 with a bitmask of the
+ * letters already inserted, whose complement gives the remaining letters of the alphabet in order
+ * (the alphabet is sorted). The sample of the ciphertext is decoded one digraph at a time through
+ * @decodeCells and its quadgrams are scored as soon as they are complete: since every quadgram
+ * score is negative, the key is abandoned as soon as its partial score falls below the worst one
+ * of the full heap.
+ *
+ * @param argument - the DICT_JOB to run
+ */
+static void runDictJob(void *argument) {
+    DICT_JOB *job = argument;
+    const DICTIONARY *dictionary = job->dictionary;
+    const char *words = dictionary->words;
+    const unsigned char *map = dictionary->letterMap, *cipher = dictionary->cipher;
+    const float *scores = dictionary->scores;
+    size_t nLetters = dictionary->nLetters, position = job->start;
+    unsigned char *restrict plain = memoryMalloc(nLetters), cell[26];
+    DICT_RESULT result;
+
+    if (position > 0)
+        while (position < dictionary->size && words[position - 1] != '\n')
+            position++;
+
+    while (position < job->end) {
+        uint32_t inserted = 0;
+        size_t start = position, n = 0;
+
+        for (; position < dictionary->size && words[position] != '\n'; position++) {
+            unsigned char letter = map[(unsigned char) words[position]];
+            if (letter != DICT_SKIP && (inserted & 1u << letter) == 0) {
+                inserted |= 1u << letter;
+                result.grid[n++] = letter;
+            }
+        }
+        position++;
+        if (n == 0)
+            continue;
+        for (uint32_t missing = dictionary->alphabetMask & ~inserted; missing != 0; missing &= missing - 1)
+            result.grid[n++] = (unsigned char) __builtin_ctz(missing);
+        for (unsigned char c = 0; c < 25; c++)
+            cell[result.grid[c]] = c;
+        job->nKeys++;
+
+        float score = 0, threshold = job->nHeap == dictionary->top ? job->heap[0].score : -1e30f;
+        size_t i = 0;
+        for (; i < nLetters; i += 2) {
+            const unsigned char *cells = decodeCells[cell[cipher[i]] * 25 + cell[cipher[i + 1]]];
+            plain[i] = result.grid[cells[0]];
+            plain[i + 1] = result.grid[cells[1]];
+            if (i >= 2) {
+                if (i >= 3)
+                    score += scores[getQuadgramIndex(plain + i - 3)];
+                score += scores[getQuadgramIndex(plain + i - 2)];
+                if (score < threshold)
+                    break;
+            }
+        }
+        if (i < nLetters)
+            continue;
+
+        size_t length = position - 1 - start;
+        if (length > 0 && words[start + length - 1] == '\r')
+            length--;
+        result.score = score;
+        result.offset = start;
+        result.length = (uint32_t) length;
+        addResult(job, &result);
+    }
+    free(plain);
+}
+
+/**
+ * Orders the results from the best score, and the same scores by their position in the wordlist.
+ */
+static int compareResults(const void *first, const void *second) {
+    const DICT_RESULT *a = first, *b = second;
+    if (a->score != b->score)
+        return a->score < b->score ? 1 : -1;
+    return (a->offset > b->offset) - (a->offset < b->offset);
+}
+
+/**
+ * Prints the given word of the wordlist as a JSON string.
+ */
+static void printJsonWord(const char *word, size_t length) {
+    putchar('"');
+    for (size_t k = 0; k < length; k++) {
+        unsigned char c = (unsigned char) word[k];
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c < 0x20 || c >= 0x7F)
+            printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+/**
+ * Prints the correct syntax of the dict command and ends the program.
+ */
+static void printDictUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE DICTIONARY ATTACK:\n");
+    fprintf(stderr, "'<playfair> dict --ngrams <file> [--threads <n>] [--top <n>] [--sample <letters>] "
+                    "[--alphabet <letters>] [--output <keyfile>] [--quiet|--json] <cipherfile> <wordlist>'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Tries every word of a wordlist as the key of the given ciphertext.
+ * The wordlist is memory-mapped and split into parts, searched in parallel by jobs with their own
+ * top-K heap (see @runDictJob()), which are merged at the end. The best keys are printed with
+ * their score and the beginning of their plaintext, and the best one can be written as a KEYFILE.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if a key was found (and written), EXIT_FAILURE otherwise
+ */
+int startDictionary(int argc, char **argv) {
+    DICTIONARY dictionary;
+    QUADGRAMS quadgrams;
+    OUTPUT_MODE output = OUTPUT_NORMAL;
+    char *ngramsPath = NULL, *alphabetText = NULL, *outputPath = NULL;
+    size_t nThreads = getDefaultThreadCount(), sampleSize = DICT_SAMPLE;
+    int i = 2, used[26] = {0};
+
+    memset(&dictionary, 0, sizeof(dictionary));
+    dictionary.top = DICT_TOP;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (i + 1 >= argc && strcmp(argv[i], "--quiet") != 0 && strcmp(argv[i], "--json") != 0)
+            printDictUsage();
+        if (strcmp(argv[i], "--ngrams") == 0)
+            ngramsPath = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && atoi(argv[i + 1]) > 0)
+            nThreads = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--top") == 0 && atoi(argv[i + 1]) > 0)
+            dictionary.top = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sample") == 0 && atoi(argv[i + 1]) >= 8)
+            sampleSize = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--alphabet") == 0)
+            alphabetText = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0)
+            outputPath = argv[++i];
+        else if (strcmp(argv[i], "--quiet") == 0)
+            output = OUTPUT_QUIET;
+        else if (strcmp(argv[i], "--json") == 0)
+            output = OUTPUT_JSON;
+        else printDictUsage();
+    }
+    if (argc - i != 2 || ngramsPath == NULL)
+        printDictUsage();
+
+    unsigned char *cipher = memoryMalloc(sampleSize);
+    dictionary.nLetters = readCipherLetters(argv[i], cipher, sampleSize, used);
+    if (dictionary.nLetters < 8) {
+        fprintf(stderr, "\nERROR: the ciphertext '%s' is too short to score its keys!\n\n", argv[i]);
+        free(cipher);
+        return EXIT_FAILURE;
+    }
+    if (chooseAlphabet(alphabetText, used, dictionary.alphabet) != 0) {
+        fprintf(stderr, "\nERROR: the alphabet of the matrix must contain 25 letters, including all the ones "
+                        "of the ciphertext!\n\n");
+        free(cipher);
+        return EXIT_FAILURE;
+    }
+
+    int fd = open(argv[i + 1], O_RDONLY);
+    struct stat wordsStat;
+    if (fd < 0 || fstat(fd, &wordsStat) != 0) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", argv[i + 1]);
+        if (fd >= 0)
+            close(fd);
+        free(cipher);
+        return EXIT_FAILURE;
+    }
+    dictionary.size = (size_t) wordsStat.st_size;
+    void *words = dictionary.size > 0 ? mmap(NULL, dictionary.size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (words == MAP_FAILED) {
+        fprintf(stderr, "\nERROR: the wordlist '%s' cannot be read!\n\n", argv[i + 1]);
+        free(cipher);
+        return EXIT_FAILURE;
+    }
+    if (loadQuadgrams(ngramsPath, &quadgrams) != 0) {
+        if (words != NULL)
+            munmap(words, dictionary.size);
+        free(cipher);
+        return EXIT_FAILURE;
+    }
+    if (words != NULL)
+        madvise(words, dictionary.size, MADV_SEQUENTIAL);
+    dictionary.words = words;
+    dictionary.cipher = cipher;
+    dictionary.scores = quadgrams.scores;
+
+    int inAlphabet[26] = {0}, replacement = getReplacementLetter(dictionary.alphabet);
+    for (int k = 0; k < 25; k++) {
+        inAlphabet[dictionary.alphabet[k]] = 1;
+        dictionary.alphabetMask |= 1u << dictionary.alphabet[k];
+    }
+    memset(dictionary.letterMap, DICT_SKIP, sizeof(dictionary.letterMap));
+    for (int letter = 0; letter < 26; letter++) {
+        unsigned char mapped = (unsigned char) (inAlphabet[letter] ? letter : replacement);
+        dictionary.letterMap['A' + letter] = mapped;
+        dictionary.letterMap['a' + letter] = mapped;
+    }
+    initDecodeCells();
+
+    size_t chunk = dictionary.size / (8 * nThreads) + 1, nJobs;
+    if (chunk < DICT_JOB_SIZE)
+        chunk = DICT_JOB_SIZE;
+    nJobs = (dictionary.size + chunk - 1) / chunk;
+    DICT_JOB *jobs = memoryCalloc(nJobs + 1, sizeof(DICT_JOB));
+    DICT_RESULT *heaps = memoryMalloc((nJobs + 1) * dictionary.top * sizeof(DICT_RESULT));
+    uint64_t startTime = getMonotonicTime(), nKeys = 0;
+    THREAD_POOL *pool = nThreads > 1 && nJobs > 1 ? createThreadPool(nThreads) : NULL;
+    for (size_t j = 0; j < nJobs; j++) {
+        jobs[j].dictionary = &dictionary;
+        jobs[j].start = j * chunk;
+        jobs[j].end = j + 1 < nJobs ? (j + 1) * chunk : dictionary.size;
+        jobs[j].heap = heaps + j * dictionary.top;
+        if (pool != NULL)
+            submitTask(pool, runDictJob, &jobs[j]);
+        else runDictJob(&jobs[j]);
+    }
+    if (pool != NULL) {
+        waitThreadPool(pool);
+        destroyThreadPool(pool);
+    }
+    uint64_t elapsedTime = getMonotonicTime() - startTime;
+
+    DICT_JOB merged = {&dictionary, 0, 0, heaps + nJobs * dictionary.top, 0, 0};
+    for (size_t j = 0; j < nJobs; j++) {
+        qsort(jobs[j].heap, jobs[j].nHeap, sizeof(DICT_RESULT), compareResults);
+        for (size_t k = 0; k < jobs[j].nHeap; k++)
+            if (merged.nHeap < dictionary.top || jobs[j].heap[k].score > merged.heap[0].score)
+                addResult(&merged, &jobs[j].heap[k]);
+        nKeys += jobs[j].nKeys;
+    }
+    qsort(merged.heap, merged.nHeap, sizeof(DICT_RESULT), compareResults);
+
+    unsigned char *plain = memoryMalloc(dictionary.nLetters), cell[26];
+    double rate = (double) nKeys / ((double) elapsedTime / 1e9);
+    for (size_t k = 0; k < merged.nHeap && output != OUTPUT_QUIET; k++) {
+        const DICT_RESULT *result = &merged.heap[k];
+        for (unsigned char c = 0; c < 25; c++)
+            cell[result->grid[c]] = c;
+        for (size_t l = 0; l < dictionary.nLetters; l += 2) {
+            const unsigned char *cells = decodeCells[cell[cipher[l]] * 25 + cell[cipher[l + 1]]];
+            plain[l] = result->grid[cells[0]];
+            plain[l + 1] = result->grid[cells[1]];
+        }
+        if (output == OUTPUT_JSON) {
+            printf("{\"rank\":%zu,\"score\":%.2f,\"word\":", k + 1, result->score);
+            printJsonWord(dictionary.words + result->offset, result->length);
+            printf(",\"key\":\"");
+            for (int c = 0; c < 25; c++)
+                putchar('A' + result->grid[c]);
+            printf("\",\"plaintext\":\"");
+        } else printf("%zu. score %.2f: %.*s\n    ", k + 1, result->score, (int) result->length,
+                      dictionary.words + result->offset);
+        for (size_t l = 0; l < dictionary.nLetters && l < DICT_PREVIEW; l++)
+            putchar('A' + plain[l]);
+        printf(output == OUTPUT_JSON ? "\"}\n" : "\n");
+    }
+    if (output == OUTPUT_JSON)
+        printf("{\"keys\":%llu,\"keys_per_second\":%.0f,\"elapsed_ns\":%llu}\n", (unsigned long long) nKeys, rate,
+               (unsigned long long) elapsedTime);
+    else if (output == OUTPUT_NORMAL)
+        printf("\nkeys: %llu (%.0f per second)\n\n", (unsigned long long) nKeys, rate);
+
+    int result = merged.nHeap > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (outputPath != NULL && merged.nHeap > 0 &&
+        writeMatrixKeyFile(outputPath, dictionary.alphabet, merged.heap[0].grid,
+                           getSpecialLetter(dictionary.alphabet)) != 0) {
+        fprintf(stderr, "\nERROR: the KEYFILE '%s' cannot be written!\n\n", outputPath);
+        result = EXIT_FAILURE;
+    }
+
+    free(plain);
+    free(jobs);
+    free(heaps);
+    free(cipher);
+    freeQuadgrams(&quadgrams);
+    if (words != NULL)
+        munmap(words, dictionary.size);
+    return result;
+}
@@ -0,0 +1,7 @@
+
+#ifndef PLAYFAIR_DICTMANAGER_H
+#define PLAYFAIR_DICTMANAGER_H
+
+int startDictionary(int argc, char **argv);
+
+#endif //PLAYFAIR_DICTMANAGER_H
@@ -2,7 +2,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
+#include <sys/stat.h>
 
 #include "fileManager.h"
 #include "utils.h"
@@ -26,100 +26,48 @@ FILE *openFile(char *path, char *mode) {
 }
 
 /**
- * Reads text from the specified file one character at a time (for a total of @nchar characters)
- * excluding non-letters. Then the text is changed to uppercase.
- * If no valid text was read, an error is printed and the program ends.
- *
- * @param file - the file to read from
- * @param nChar - the amount of characters
- * @return a pointer to the start of the text
- */
-char *readTextFromFile(FILE *file, size_t nChar) {
-    char *temp = stringMalloc(nChar + 1);
-    int counter = 0;
-
-    for (int i = 0; i < nChar; i++) {
-        char c = (char) fgetc(file);
-        if (isalpha(c) != 0) temp[counter++] = c;
-    }
-
-    if (counter == 0) {
-        fprintf(stderr, "\nERROR: no valid text can be read from the specified file");
-        exit(EXIT_FAILURE);
-    }
-
-    if (counter < nChar)
-        temp = stringRealloc(temp, counter + 1);
-    temp[counter] = '\0';
-    toUpperString(temp);
-    return temp;
-}
-
-/**
- * Reads forward in the specified file one character at a time until a letter is found
- * or EOF is reached and the the last character that was read is returned (in uppercase).
- * If the last character that was read is the MISSING_CHAR from the KEYFILE alphabet,
- * the substitute character from the KEYFILE is returned instead.
- *
- * @param file - the file to read from
- * @param missingChar - the letter to return in case of bad read
- * @return the last character that was read (in uppercase)
+ * Checks whether the given path is "-", which stands for the standard input (when reading)
+ * or the standard output (when writing).
  */
-char readNextLetterFromFile(FILE *file, char missingChar) {
-    char nextChar;
-    extern char MISSING_CHAR;
-    do {
-        nextChar = (char) fgetc(file);
-    } while ((isalpha(nextChar) == 0) && nextChar != EOF);
-    if ((char) toupper(nextChar) == MISSING_CHAR)
-        return missingChar;
-    else return (char) toupper(nextChar);
+int isStandardPath(const char *path) {
+    return strcmp(path, "-") == 0;
 }
 
 /**
- * Opens a new file in write mode using the specified path and then proceeds to
- * write the whole specified text two letter at a time (separated by a space).
- * If a file with the same name already exists, its content is erased and the file
- * is considered as a new empty file.
+ * Opens the file with the given path in the given mode ("r" or "w"), or returns the standard
+ * input or output if the path is "-", so that the files can also be pipes and FIFOs.
  *
- * @param filePath - the file to write to
- * @param text - the text to write to the file
+ * @param path - the path of the file to open, or "-"
+ * @param mode - the mode in which the file has to be opened
+ * @return the opened file, or NULL if it cannot be opened
  */
-void writeToNewFile(char *filePath, char *text) {
-    FILE *file = openFile(filePath, "w");
-    writeText(file, text);
-    fclose(file);
+FILE *openPath(const char *path, const char *mode) {
+    if (isStandardPath(path))
+        return mode[0] == 'r' ? stdin : stdout;
+    return fopen(path, mode);
 }
 
 /**
- * Opens a new file in append+ mode using the specified path and then proceeds to
- * append the whole specified text two letter at a time (separated by a space).
+ * Closes a file opened with @openPath(): the standard streams are only flushed, so that they
+ * can still be used (e.g. to print errors).
  *
- * @param filePath - the file to write to
- * @param text - the text to write to the file
+ * @param file - the file to close
+ * @return 0 if the file was closed (or flushed), EOF otherwise
  */
-void appendToExistingFile(char *filePath, char *text) {
-    FILE *file = openFile(filePath, "a+");
-    writeText(file, text);
-    fclose(file);
+int closePath(FILE *file) {
+    if (file == stdin)
+        return 0;
+    if (file == stdout)
+        return fflush(stdout);
+    return fclose(file);
 }
 
 /**
- * Writes the given text into the given file two letter at a time
- * (separated by a space).
- *
- * @param out - the file to write into
- * @param text - the text to write into the file
+ * Removes the file with the given path (e.g. a partial output), unless the path is "-".
  */
-void writeText(FILE *out, char *text) {
-    while (*text != '\0') {
-        fputc(*text, out);
-        text++;
-        fputc(*text, out);
-        text++;
-        if (*text != '\0')
-            fputc(' ', out);
-    }
+void removePath(const char *path) {
+    if (!isStandardPath(path))
+        remove(path);
 }
 
 /**
@@ -128,13 +76,13 @@ void writeText(FILE *out, char *text) {
  * Then, if the path ends with ".pf", ".pf" is removed with the apposite method.
  *
  * @param filePath - the path from which the filename is extracted
- * @return the name of the file
+ * @return the name of the file (a part of @filePath or a new string, if ".pf" was removed)
  */
 char *getFileNameFromPath(char *filePath) {
     char *temp = strrchr(filePath, getSeparator());
 
     if (temp != NULL)
-        return check_if_string_ends_with(temp, ".pf");
+        return check_if_string_ends_with(temp + 1, ".pf");
     else return check_if_string_ends_with(filePath, ".pf");
 }
 
@@ -152,7 +100,7 @@ char *check_if_string_ends_with(char *str, char *suffix) {
     size_t suffix_len = strlen(suffix);
 
     if ((str_len >= suffix_len) && (0 == strcmp(str + (str_len - suffix_len), suffix))) {
-        char *temp = calloc((str_len - suffix_len), sizeof(char));
+        char *temp = stringCalloc(str_len - suffix_len + 1);
         strncpy(temp, str, str_len - suffix_len);
         return temp;
     } else return str;
@@ -160,8 +108,10 @@ char *check_if_string_ends_with(char *str, char *suffix) {
 
 /**
  * Returns the path of the output file of the encode/decode process, which is obtained
- * by combining the output directory path, the name of the input file (obtained through
- * the previous method) and the extension (".pf" for encode, ".dec" for decode).
+ * by joining the output directory path and the name of the input file (obtained through
+ * the previous method) followed by the extension (".pf" for encode, ".dec" for decode).
+ * The standard input ("-") is named "stdin", and if the output directory is "-" the output
+ * path is "-" too (the standard output).
  *
  * @param outputDir - the path of the output directory
  * @param inputFilePath - the path of the input file
@@ -169,28 +119,78 @@ char *check_if_string_ends_with(char *str, char *suffix) {
  * @return the path of the output file
  */
 char *getOutputFilePath(char *outputDir, char *inputFilePath, char *extension) {
-    char *fileName = getFileNameFromPath(inputFilePath);
-    size_t size = strlen(outputDir) + strlen(fileName) + strlen(extension);
-
-    char *outputFilePath = stringMalloc(size);
+    if (isStandardPath(outputDir)) {
+        char *standardOutput = stringMalloc(2);
+        strcpy(standardOutput, "-");
+        return standardOutput;
+    }
+    char *namePath = isStandardPath(inputFilePath) ? "stdin" : inputFilePath;
+    char *fileName = getFileNameFromPath(namePath);
+    char *outputFileName = stringMalloc(strlen(fileName) + strlen(extension) + 1);
 
-    strcpy(outputFilePath, outputDir);
-    strcat(outputFilePath, fileName);
-    strcat(outputFilePath, extension);
-    //outputFilePath[size] = '\0';
+    strcpy(outputFileName, fileName);
+    strcat(outputFileName, extension);
+    char *outputFilePath = joinPath(outputDir, outputFileName);
 
+    if (fileName < namePath || fileName > namePath + strlen(namePath))
+        free(fileName);
+    free(outputFileName);
     return outputFilePath;
 }
 
+/**
+ * Joins the given directory path and file name with the separator used by the current OS
+ * (the separator is not repeated if the directory path already ends with it).
+ *
+ * @param directory - the path of the directory
+ * @param fileName - the name of the file
+ * @return the path of the file inside the directory
+ */
+char *joinPath(const char *directory, const char *fileName) {
+    size_t directoryLength = strlen(directory);
+    char *path = stringMalloc(directoryLength + strlen(fileName) + 2);
+
+    strcpy(path, directory);
+    if (directoryLength > 0 && directory[directoryLength - 1] != getSeparator())
+        path[directoryLength++] = getSeparator();
+    strcpy(path + directoryLength, fileName);
+    return path;
+}
+
+/**
+ * Creates the directory with the given path together with all its missing parent
+ * directories (like "mkdir -p"). Existing directories are not an error.
+ *
+ * @param path - the path of the directory to create
+ * @return 0 if the directory exists at the end, -1 otherwise
+ */
+int makeDirectories(const char *path) {
+    char *partialPath = stringMalloc(strlen(path) + 1);
+    struct stat pathStat;
+
+    strcpy(partialPath, path);
+    for (char *position = partialPath + 1; *position != '\0'; position++) {
+        if (*position == getSeparator()) {
+            *position = '\0';
+            mkdir(partialPath, 0777);
+            *position = getSeparator();
+        }
+    }
+    mkdir(partialPath, 0777);
+    int result = stat(partialPath, &pathStat) == 0 && S_ISDIR(pathStat.st_mode) ? 0 : -1;
+    free(partialPath);
+    return result;
+}
+
 /**
  * Returns the opportune extension depending on the given command:
- * ".pf" for "encode", ".dec" for "decode".
+ * ".pf" for "encode" and "rekey", ".dec" for "decode".
  *
  * @param command - the command defining the type of the operation (encode/decode)
  * @return the opportune extension
  */
 char *getExtension(char *command) {
-    if (strcmp(command, "encode") == 0)
+    if (strcmp(command, "encode") == 0 || strcmp(command, "rekey") == 0)
         return ".pf";
     else
         return ".dec";
@@ -6,15 +6,13 @@
 
 FILE *openFile(char *path, char *mode);
 
-char *readTextFromFile(FILE *file, size_t nChar);
+int isStandardPath(const char *path);
 
-char readNextLetterFromFile(FILE *file, char missingChar);
+FILE *openPath(const char *path, const char *mode);
 
-void writeToNewFile(char *filePath, char *text);
+int closePath(FILE *file);
 
-void appendToExistingFile(char *filePath, char *text);
-
-void writeText(FILE *out, char *text);
+void removePath(const char *path);
 
 char *getFileNameFromPath(char *filePath);
 
@@ -22,6 +20,10 @@ char *check_if_string_ends_with(char *str, char *suffix);
 
 char *getOutputFilePath(char *outputDir, char *inputFilePath, char *extension);
 
+char *joinPath(const char *directory, const char *fileName);
+
+int makeDirectories(const char *path);
+
 char *getExtension(char *command);
 
 char getSeparator();
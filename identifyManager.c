@@ -0,0 +1,135 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "identifyManager.h"
+
+/**
+ * The amount of digraphs at the beginning of a file decoded under every key.
+ */
+#define IDENTIFY_DIGRAPHS 256
+
+/**
+ * The amount of bytes read from the beginning of a file to find its first digraphs (the encoded
+ * files have 3 bytes per digraph, but other layouts are accepted too).
+ */
+#define IDENTIFY_BYTES 4096
+
+/**
+ * The minimum score of the plaintext of the identified key, without an expected header: English
+ * texts score about -2.9, while letters with uniform frequencies (as decoded by a wrong key) score
+ * about -3.9.
+ */
+#define IDENTIFY_MIN_SCORE (-3.4)
+
+/**
+ * The frequencies (in percent) of the letters of English texts.
+ */
+static const double englishFrequencies[26] = {
+        8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966, 0.153, 0.772, 4.025, 2.406,
+        6.749, 7.507, 1.929, 0.095, 5.987, 6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074
+};
+
+/**
+ * Checks whether the given decoded letters begin with the given expected header, normalized with
+ * the given CIPHER_TABLE. The special characters inserted by the encoding between doubled letters
+ * (and not expected) are skipped.
+ */
+static int matchesHeader(const char *decoded, size_t nLetters, const char *expected, const CIPHER_TABLE *table) {
+    size_t d = 0;
+
+    for (; *expected != '\0'; expected++) {
+        char letter = table->letters[(unsigned char) *expected];
+        if (letter == 0)
+            continue;
+        while (d < nLetters && decoded[d] != letter && decoded[d] == table->specialCharacter)
+            d++;
+        if (d == nLetters || decoded[d] != letter)
+            return 0;
+        d++;
+    }
+    return 1;
+}
+
+/**
+ * Identifies which key of the given keyring a file was encoded with, without decoding it all.
+ * The first @IDENTIFY_DIGRAPHS digraphs of the file are decoded under every key through the
+ * digraphs of its CIPHER_TABLE: the file is read once and its digraphs are turned into indexes of
+ * the tables once for all the keys with the same normalization (usually all of them). Every key
+ * is scored with the log-likelihood of the frequencies of the decoded letters in English texts,
+ * so that the key of the file is the one whose plaintext looks like natural language.
+ * With an expected header, only the keys whose plaintext begins with it are considered; without
+ * it, the best plaintext must score at least @IDENTIFY_MIN_SCORE.
+ *
+ * @param filePath - the path of the encoded file
+ * @param keyRing - the keys to try
+ * @param expected - the text the plaintext is expected to begin with, or NULL
+ * @param identification - where to store the best key and its score
+ * @return 0 if a key was identified, -1 if the file cannot be read, contains no digraphs or no
+ * plaintext is recognized
+ */
+int identifyKey(const char *filePath, const KEYRING *keyRing, const char *expected, KEY_IDENTIFICATION *identification) {
+    FILE *file = fopen(filePath, "rb");
+    char buffer[IDENTIFY_BYTES], decoded[2 * IDENTIFY_DIGRAPHS];
+    unsigned short pairs[IDENTIFY_DIGRAPHS];
+    double letterScores[26];
+    const char *normalization = NULL;
+    size_t size, nDigraphs = 0;
+    int found = 0;
+
+    if (file == NULL)
+        return -1;
+    size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+    for (int letter = 0; letter < 26; letter++)
+        letterScores[letter] = log(englishFrequencies[letter] / 100);
+
+    identification->index = 0;
+    identification->score = -INFINITY;
+    for (size_t k = 0; k < keyRing->size; k++) {
+        const CIPHER_TABLE *table = &keyRing->entries[k].decodeTable;
+        const char *digraphs = &table->digraphs[0][0][0];
+
+        if (normalization == NULL || memcmp(normalization, table->letters, sizeof(table->letters)) != 0) {
+            char pending = 0;
+            normalization = table->letters;
+            nDigraphs = 0;
+            for (size_t i = 0; i < size && nDigraphs < IDENTIFY_DIGRAPHS; i++) {
+                char letter = table->letters[(unsigned char) buffer[i]];
+                if (letter == 0)
+                    continue;
+                if (pending == 0)
+                    pending = letter;
+                else {
+                    pairs[nDigraphs++] = (unsigned short) (((pending - 'A') * 26 + letter - 'A') * 2);
+                    pending = 0;
+                }
+            }
+        }
+        if (nDigraphs == 0)
+            return -1;
+
+        unsigned counts[2][26] = {{0}};
+        for (size_t d = 0; d < nDigraphs; d++) {
+            decoded[2 * d] = digraphs[pairs[d]];
+            decoded[2 * d + 1] = digraphs[pairs[d] + 1];
+            counts[0][decoded[2 * d] - 'A']++;
+            counts[1][decoded[2 * d + 1] - 'A']++;
+        }
+        double score = 0;
+        for (int letter = 0; letter < 26; letter++)
+            score += (counts[0][letter] + counts[1][letter]) * letterScores[letter];
+        score /= (double) (2 * nDigraphs);
+
+        if (expected != NULL && !matchesHeader(decoded, 2 * nDigraphs, expected, table))
+            continue;
+        if (score > identification->score) {
+            identification->score = score;
+            identification->index = k;
+        }
+        found = 1;
+    }
+    return found && (expected != NULL || identification->score >= IDENTIFY_MIN_SCORE) ? 0 : -1;
+}
@@ -0,0 +1,15 @@
+
+#ifndef PLAYFAIR_IDENTIFYMANAGER_H
+#define PLAYFAIR_IDENTIFYMANAGER_H
+
+#include <stddef.h>
+#include "keyRingManager.h"
+
+typedef struct {
+    size_t index;
+    double score;
+} KEY_IDENTIFICATION;
+
+int identifyKey(const char *filePath, const KEYRING *keyRing, const char *expected, KEY_IDENTIFICATION *identification);
+
+#endif //PLAYFAIR_IDENTIFYMANAGER_H
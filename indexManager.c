@@ -0,0 +1,765 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "indexManager.h"
+#include "keyFileManager.h"
+#include "matrixManager.h"
+#include "cipherManager.h"
+#include "searchManager.h"
+#include "threadPool.h"
+#include "printer.h"
+#include "optionManager.h"
+#include "utils.h"
+
+/**
+ * The magic header of the index files.
+ */
+#define INDEX_MAGIC "PFINDEX1"
+
+/**
+ * The amount of possible digraphs and of possible shingles of 2 consecutive digraphs,
+ * which are the keys of the index.
+ */
+#define INDEX_DIGRAPHS (26 * 26)
+#define INDEX_BUCKETS (INDEX_DIGRAPHS * INDEX_DIGRAPHS)
+
+/**
+ * The maximum amount of digraphs indexed by a single task, so that large files are indexed
+ * in parallel and with a bounded amount of memory.
+ */
+#define INDEX_SEGMENT_DIGRAPHS (4 * 1024 * 1024)
+
+typedef struct {
+    char magic[8];
+    uint64_t nFiles;
+    uint64_t nBuckets;
+    uint64_t filesOffset;
+    uint64_t namesOffset;
+    uint64_t bucketsOffset;
+    uint64_t postingsOffset;
+    uint64_t size;
+} INDEX_HEADER;
+
+typedef struct {
+    uint64_t size;
+    uint64_t modificationTime;
+    uint64_t nDigraphs;
+    uint64_t nameOffset;
+} INDEX_FILE_ENTRY;
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    const INDEX_HEADER *header;
+    const INDEX_FILE_ENTRY *files;
+    const char *names;
+    const uint64_t *buckets;
+    const unsigned char *postings;
+} INDEX;
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} BYTE_BUFFER;
+
+typedef struct {
+    uint32_t bucket;
+    uint32_t offset;
+} SEGMENT_BUCKET;
+
+typedef struct {
+    char *path;
+    uint64_t fileId;
+    uint64_t firstDigraph;
+    uint64_t nDigraphs;
+    BYTE_BUFFER records;
+    SEGMENT_BUCKET *buckets;
+    size_t nBuckets;
+    int failed;
+} INDEX_SEGMENT;
+
+/**
+ * Appends the given bytes to the given BYTE_BUFFER, growing it if needed.
+ */
+static void appendBytes(BYTE_BUFFER *buffer, const void *bytes, size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        while (buffer->size + size > buffer->capacity)
+            buffer->capacity = buffer->capacity == 0 ? 4096 : 2 * buffer->capacity;
+        buffer->data = memoryRealloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->size, bytes, size);
+    buffer->size += size;
+}
+
+/**
+ * Appends the given number to the given BYTE_BUFFER as a variable-length integer
+ * (7 bits per byte, the highest bit set on all the bytes but the last one).
+ */
+static void appendVarint(BYTE_BUFFER *buffer, uint64_t value) {
+    unsigned char bytes[10];
+    size_t size = 0;
+
+    while (value >= 0x80) {
+        bytes[size++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    bytes[size++] = (unsigned char) value;
+    appendBytes(buffer, bytes, size);
+}
+
+/**
+ * Reads a variable-length integer (see @appendVarint()) and moves the given cursor after it.
+ *
+ * @return 0 if the integer was read, -1 if the data ends before it
+ */
+static int readVarint(const unsigned char **cursor, const unsigned char *end, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; *cursor < end && shift < 64; shift += 7) {
+        unsigned char byte = *(*cursor)++;
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return 0;
+    }
+    return -1;
+}
+
+/**
+ * Returns the value (0-675) of the digraph written with the given two characters, or -1 if they
+ * are not upper case letters.
+ */
+static int getDigraphValue(const char *text) {
+    if (text[0] < 'A' || text[0] > 'Z' || text[1] < 'A' || text[1] > 'Z')
+        return -1;
+    return (text[0] - 'A') * 26 + (text[1] - 'A');
+}
+
+/**
+ * Returns the size of the postings of the given bucket of the index.
+ */
+static uint64_t getBucketSize(const INDEX *index, uint64_t bucket) {
+    return index->buckets[bucket + 1] - index->buckets[bucket];
+}
+
+/**
+ * Maps the index stored in the given file into memory and checks that its structure is valid.
+ *
+ * @param indexPath - the path of the index file
+ * @param index - the INDEX to fill
+ * @return 0 if a valid index was mapped, -1 otherwise
+ */
+static int openIndex(const char *indexPath, INDEX *index) {
+    int fd = open(indexPath, O_RDONLY);
+    struct stat indexStat;
+
+    memset(index, 0, sizeof(INDEX));
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &indexStat) != 0 || (size_t) indexStat.st_size < sizeof(INDEX_HEADER)) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, (size_t) indexStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return -1;
+
+    const INDEX_HEADER *header = data;
+    uint64_t size = (uint64_t) indexStat.st_size;
+    index->data = data;
+    index->size = (size_t) size;
+    if (memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 || header->size != size ||
+        header->nBuckets != INDEX_BUCKETS || header->filesOffset != sizeof(INDEX_HEADER) ||
+        header->nFiles > (size - header->filesOffset) / sizeof(INDEX_FILE_ENTRY) ||
+        header->namesOffset != header->filesOffset + header->nFiles * sizeof(INDEX_FILE_ENTRY) ||
+        header->bucketsOffset < header->namesOffset || header->bucketsOffset % sizeof(uint64_t) != 0 ||
+        header->postingsOffset != header->bucketsOffset + (INDEX_BUCKETS + 1) * sizeof(uint64_t) ||
+        header->postingsOffset > size) {
+        munmap(data, index->size);
+        return -1;
+    }
+    index->header = header;
+    index->files = (const INDEX_FILE_ENTRY *) (index->data + header->filesOffset);
+    index->names = (const char *) (index->data + header->namesOffset);
+    index->buckets = (const uint64_t *) (index->data + header->bucketsOffset);
+    index->postings = index->data + header->postingsOffset;
+    for (uint64_t i = 0; i < header->nFiles; i++)
+        if (index->files[i].nameOffset >= header->bucketsOffset - header->namesOffset ||
+            memchr(index->names + index->files[i].nameOffset, '\0',
+                   header->bucketsOffset - header->namesOffset - index->files[i].nameOffset) == NULL) {
+            munmap(data, index->size);
+            return -1;
+        }
+    for (uint64_t b = 0; b < INDEX_BUCKETS; b++)
+        if (index->buckets[b] > index->buckets[b + 1] || index->buckets[b + 1] > size - header->postingsOffset) {
+            munmap(data, index->size);
+            return -1;
+        }
+    return 0;
+}
+
+/**
+ * Unmaps the given index.
+ */
+static void closeIndex(INDEX *index) {
+    if (index->data != NULL)
+        munmap((void *) index->data, index->size);
+}
+
+/**
+ * Returns the path of the given file of the index.
+ */
+static const char *getIndexedPath(const INDEX *index, uint64_t fileId) {
+    return index->names + index->files[fileId].nameOffset;
+}
+
+/**
+ * Indexes a segment of an encoded file: the file is assumed to be in the layout written by the
+ * encoding, where the digraph @j is stored at offset 3 * @j, so the segment is read directly from
+ * its position. Every shingle of 2 consecutive digraphs starting in the segment is recorded with
+ * the index of its first digraph, and the positions are grouped by shingle with a counting sort.
+ * Every non-empty group becomes a record "<file> <count> <first position> <deltas...>" of
+ * variable-length integers, and the records are stored in the order of their shingles.
+ *
+ * @param argument - the INDEX_SEGMENT to fill
+ */
+static void runIndexSegment(void *argument) {
+    INDEX_SEGMENT *segment = argument;
+    size_t size = 3 * (size_t) segment->nDigraphs + 2;
+    char *text = stringMalloc(size);
+    uint32_t *counts = memoryCalloc(INDEX_BUCKETS + 1, sizeof(uint32_t));
+    uint32_t *shingles = memoryMalloc(segment->nDigraphs * sizeof(uint32_t));
+    uint32_t *positions = memoryMalloc(segment->nDigraphs * sizeof(uint32_t));
+    int fd = open(segment->path, O_RDONLY);
+    ssize_t nRead = 0;
+    size_t total = 0;
+
+    segment->buckets = memoryMalloc((segment->nDigraphs < INDEX_BUCKETS ? segment->nDigraphs : INDEX_BUCKETS) *
+                                    sizeof(SEGMENT_BUCKET) + 1);
+    segment->failed = fd < 0;
+    while (!segment->failed && total < size &&
+           (nRead = pread(fd, text + total, size - total, (off_t) (3 * segment->firstDigraph + total))) > 0)
+        total += (size_t) nRead;
+    if (nRead < 0)
+        segment->failed = 1;
+    if (fd >= 0)
+        close(fd);
+
+    for (size_t j = 0; j < segment->nDigraphs; j++) {
+        int first = 3 * j + 1 < total ? getDigraphValue(text + 3 * j) : -1;
+        int second = 3 * j + 4 < total ? getDigraphValue(text + 3 * j + 3) : -1;
+        shingles[j] = first >= 0 && second >= 0 ? (uint32_t) (first * INDEX_DIGRAPHS + second) : INDEX_BUCKETS;
+        counts[shingles[j]]++;
+    }
+    for (uint32_t b = 0, sum = 0; b <= INDEX_BUCKETS; b++) {
+        uint32_t count = counts[b];
+        counts[b] = sum;
+        sum += count;
+    }
+    for (size_t j = 0; j < segment->nDigraphs; j++)
+        positions[counts[shingles[j]]++] = (uint32_t) j;
+
+    for (size_t j = 0, start = 0; j < segment->nDigraphs; start = j) {
+        uint32_t bucket = shingles[positions[start]];
+        if (bucket == INDEX_BUCKETS)
+            break;
+        for (j = start; j < segment->nDigraphs && shingles[positions[j]] == bucket; j++);
+
+        segment->buckets[segment->nBuckets].bucket = bucket;
+        segment->buckets[segment->nBuckets++].offset = (uint32_t) segment->records.size;
+        appendVarint(&segment->records, segment->fileId);
+        appendVarint(&segment->records, j - start);
+        appendVarint(&segment->records, segment->firstDigraph + positions[start]);
+        for (size_t k = start + 1; k < j; k++)
+            appendVarint(&segment->records, positions[k] - positions[k - 1]);
+    }
+    free(text);
+    free(counts);
+    free(shingles);
+    free(positions);
+}
+
+typedef struct {
+    const char *name;
+    uint64_t fileId;
+} INDEX_NAME;
+
+typedef struct {
+    uint64_t fileId;
+    uint64_t offset;
+    uint64_t position;
+    int alignment;
+} INDEX_CANDIDATE;
+
+/**
+ * Compares two INDEX_NAME by name, for qsort and bsearch.
+ */
+static int compareNames(const void *first, const void *second) {
+    return strcmp(((const INDEX_NAME *) first)->name, ((const INDEX_NAME *) second)->name);
+}
+
+/**
+ * Compares two INDEX_CANDIDATE by file and offset of the word, for qsort.
+ */
+static int compareCandidates(const void *first, const void *second) {
+    const INDEX_CANDIDATE *a = first, *b = second;
+    if (a->fileId != b->fileId)
+        return a->fileId < b->fileId ? -1 : 1;
+    return a->offset < b->offset ? -1 : a->offset > b->offset;
+}
+
+/**
+ * Returns the modification time of the given file status in nanoseconds.
+ */
+static uint64_t getModificationTime(const struct stat *fileStat) {
+    return (uint64_t) fileStat->st_mtim.tv_sec * 1000000000u + (uint64_t) fileStat->st_mtim.tv_nsec;
+}
+
+/**
+ * Copies the records of the given bucket of the old index that belong to the reused files to the
+ * given BYTE_BUFFER, with the new IDs of their files.
+ */
+static void copyOldRecords(const INDEX *oldIndex, uint64_t bucket, const uint64_t *newIds, BYTE_BUFFER *out) {
+    const unsigned char *cursor = oldIndex->postings + oldIndex->buckets[bucket];
+    const unsigned char *end = oldIndex->postings + oldIndex->buckets[bucket + 1];
+    uint64_t fileId, count, value;
+
+    while (cursor < end) {
+        if (readVarint(&cursor, end, &fileId) != 0)
+            return;
+        const unsigned char *record = cursor;
+        if (readVarint(&cursor, end, &count) != 0)
+            return;
+        for (uint64_t k = 0; k < count; k++)
+            if (readVarint(&cursor, end, &value) != 0)
+                return;
+        if (fileId < oldIndex->header->nFiles && newIds[fileId] != UINT64_MAX) {
+            appendVarint(out, newIds[fileId]);
+            appendBytes(out, record, (size_t) (cursor - record));
+        }
+    }
+}
+
+/**
+ * Writes the index of the given files: the header, the table of the files with their size,
+ * modification time and amount of digraphs, their NUL-terminated paths, the table of the offsets
+ * of the postings of every bucket (shingle) and the postings. The postings of every bucket contain
+ * the records of the reused files first (copied from the old index) and then the ones of the
+ * segments, in the order of the segments. The index is written to a temporary file which then
+ * replaces the old one.
+ *
+ * @return the size of the index, or 0 if it cannot be written
+ */
+static uint64_t writeIndex(const char *indexPath, INDEX_FILE_ENTRY *files, char **paths, uint64_t nFiles,
+                           const INDEX *oldIndex, const uint64_t *newIds, INDEX_SEGMENT *segments, size_t nSegments) {
+    char *tempPath = stringMalloc(strlen(indexPath) + 5);
+    uint64_t *bucketOffsets = memoryCalloc(INDEX_BUCKETS + 1, sizeof(uint64_t));
+    size_t *firstReference = memoryCalloc(INDEX_BUCKETS + 1, sizeof(size_t)), nReferences = 0;
+    INDEX_HEADER header;
+    BYTE_BUFFER postings = {NULL, 0, 0};
+
+    for (size_t s = 0; s < nSegments; s++) {
+        nReferences += segments[s].nBuckets;
+        for (size_t k = 0; k < segments[s].nBuckets; k++)
+            firstReference[segments[s].buckets[k].bucket + 1]++;
+    }
+    for (uint64_t b = 0; b < INDEX_BUCKETS; b++)
+        firstReference[b + 1] += firstReference[b];
+
+    /* the references to the records of the segments, grouped by bucket in the order of the segments */
+    size_t (*references)[2] = memoryMalloc((nReferences + 1) * sizeof(*references));
+    size_t *nextReference = memoryMalloc((INDEX_BUCKETS + 1) * sizeof(size_t));
+    memcpy(nextReference, firstReference, (INDEX_BUCKETS + 1) * sizeof(size_t));
+    for (size_t s = 0; s < nSegments; s++)
+        for (size_t k = 0; k < segments[s].nBuckets; k++) {
+            size_t r = nextReference[segments[s].buckets[k].bucket]++;
+            references[r][0] = s;
+            references[r][1] = k;
+        }
+    free(nextReference);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.nFiles = nFiles;
+    header.nBuckets = INDEX_BUCKETS;
+    header.filesOffset = sizeof(INDEX_HEADER);
+    header.namesOffset = header.filesOffset + nFiles * sizeof(INDEX_FILE_ENTRY);
+    uint64_t namesSize = 0;
+    for (uint64_t f = 0; f < nFiles; f++) {
+        files[f].nameOffset = namesSize;
+        namesSize += strlen(paths[f]) + 1;
+    }
+    header.bucketsOffset = header.namesOffset + (namesSize + 7) / 8 * 8;
+    header.postingsOffset = header.bucketsOffset + (INDEX_BUCKETS + 1) * sizeof(uint64_t);
+
+    sprintf(tempPath, "%s.tmp", indexPath);
+    FILE *index = fopen(tempPath, "wb");
+    if (index == NULL) {
+        free(tempPath);
+        free(bucketOffsets);
+        free(firstReference);
+        free(references);
+        return 0;
+    }
+    fwrite(&header, sizeof(header), 1, index);
+    fwrite(files, sizeof(INDEX_FILE_ENTRY), nFiles, index);
+    for (uint64_t f = 0; f < nFiles; f++)
+        fwrite(paths[f], 1, strlen(paths[f]) + 1, index);
+    fwrite("\0\0\0\0\0\0\0", 1, header.bucketsOffset - header.namesOffset - namesSize, index);
+    fwrite(bucketOffsets, sizeof(uint64_t), INDEX_BUCKETS + 1, index);
+
+    uint64_t postingsSize = 0;
+    for (uint64_t b = 0; b < INDEX_BUCKETS; b++) {
+        bucketOffsets[b] = postingsSize;
+        postings.size = 0;
+        if (oldIndex->data != NULL)
+            copyOldRecords(oldIndex, b, newIds, &postings);
+        for (size_t r = firstReference[b]; r < firstReference[b + 1]; r++) {
+            INDEX_SEGMENT *segment = &segments[references[r][0]];
+            size_t k = references[r][1];
+            size_t end = k + 1 < segment->nBuckets ? segment->buckets[k + 1].offset : segment->records.size;
+            appendBytes(&postings, segment->records.data + segment->buckets[k].offset,
+                        end - segment->buckets[k].offset);
+        }
+        fwrite(postings.data, 1, postings.size, index);
+        postingsSize += postings.size;
+    }
+    bucketOffsets[INDEX_BUCKETS] = postingsSize;
+    header.size = header.postingsOffset + postingsSize;
+
+    fseeko(index, (off_t) header.bucketsOffset, SEEK_SET);
+    fwrite(bucketOffsets, sizeof(uint64_t), INDEX_BUCKETS + 1, index);
+    fseeko(index, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, index);
+
+    int failed = ferror(index);
+    failed |= fclose(index) != 0;
+    if (failed || rename(tempPath, indexPath) != 0) {
+        unlink(tempPath);
+        header.size = 0;
+    }
+    free(postings.data);
+    free(tempPath);
+    free(bucketOffsets);
+    free(firstReference);
+    free(references);
+    return header.size;
+}
+
+/**
+ * Prints the correct syntax of the index command and ends the program.
+ */
+static void printIndexUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE INDEX:\n");
+    fprintf(stderr, "'<playfair> index build [--jobs <n>] [--quiet|--json] <indexfile> <file1> ... <filen>'\n");
+    fprintf(stderr, "'<playfair> index query [--quiet|--json] <keyfile> <indexfile> <word>'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Parses the options of the index commands ("--jobs" only for the build) and returns the
+ * position of the first parameter after them.
+ */
+static int parseIndexOptions(int argc, char **argv, int allowJobs, size_t *nJobs, OUTPUT_MODE *output) {
+    int i = 3;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (allowJobs && strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            *nJobs = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--quiet") == 0)
+            *output = OUTPUT_QUIET;
+        else if (strcmp(argv[i], "--json") == 0)
+            *output = OUTPUT_JSON;
+        else printIndexUsage();
+    }
+    return i;
+}
+
+/**
+ * Builds (or updates) the inverted index of the given encoded files, which maps every shingle of
+ * 2 consecutive ciphertext digraphs to the files and the positions where it occurs, without the
+ * key. The files are split into segments of @INDEX_SEGMENT_DIGRAPHS digraphs which are indexed in
+ * parallel with the option "--jobs" (see @runIndexSegment()).
+ * If the index already exists, the postings of the files that are unchanged since they were indexed
+ * (same path, size and modification time) are copied from it instead of reading the files again.
+ * The files that are not given any more are removed from the index.
+ *
+ * @return EXIT_SUCCESS if the index was written, EXIT_FAILURE otherwise
+ */
+static int buildIndex(int argc, char **argv) {
+    OUTPUT_MODE output = OUTPUT_NORMAL;
+    size_t nJobs = 1, nSegments = 0;
+    int i = parseIndexOptions(argc, argv, 1, &nJobs, &output);
+    INDEX oldIndex;
+    INDEX_NAME *oldNames = NULL;
+
+    if (argc - i < 2)
+        printIndexUsage();
+    char *indexPath = argv[i];
+    char **paths = argv + i + 1;
+    uint64_t nFiles = (uint64_t) (argc - i - 1), nReused = 0, nDigraphs = 0;
+
+    if (openIndex(indexPath, &oldIndex) == 0) {
+        oldNames = memoryMalloc((oldIndex.header->nFiles + 1) * sizeof(INDEX_NAME));
+        for (uint64_t f = 0; f < oldIndex.header->nFiles; f++) {
+            oldNames[f].name = getIndexedPath(&oldIndex, f);
+            oldNames[f].fileId = f;
+        }
+        qsort(oldNames, oldIndex.header->nFiles, sizeof(INDEX_NAME), compareNames);
+    }
+
+    INDEX_FILE_ENTRY *files = memoryCalloc(nFiles, sizeof(INDEX_FILE_ENTRY));
+    uint64_t *newIds = memoryMalloc((oldIndex.data != NULL ? oldIndex.header->nFiles : 0) * sizeof(uint64_t) + 1);
+    INDEX_SEGMENT *segments = NULL;
+    if (oldIndex.data != NULL)
+        memset(newIds, 0xff, oldIndex.header->nFiles * sizeof(uint64_t));
+
+    for (uint64_t f = 0; f < nFiles; f++) {
+        struct stat fileStat;
+        if (stat(paths[f], &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+            fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", paths[f]);
+            exit(EXIT_FAILURE);
+        }
+        files[f].size = (uint64_t) fileStat.st_size;
+        files[f].modificationTime = getModificationTime(&fileStat);
+        files[f].nDigraphs = (files[f].size + 1) / 3;
+        nDigraphs += files[f].nDigraphs;
+
+        INDEX_NAME key = {paths[f], 0}, *old = NULL;
+        if (oldNames != NULL)
+            old = bsearch(&key, oldNames, oldIndex.header->nFiles, sizeof(INDEX_NAME), compareNames);
+        if (old != NULL && newIds[old->fileId] == UINT64_MAX && oldIndex.files[old->fileId].size == files[f].size &&
+            oldIndex.files[old->fileId].modificationTime == files[f].modificationTime) {
+            newIds[old->fileId] = f;
+            nReused++;
+            continue;
+        }
+        for (uint64_t first = 0; first < files[f].nDigraphs; first += INDEX_SEGMENT_DIGRAPHS) {
+            segments = memoryRealloc(segments, (nSegments + 1) * sizeof(INDEX_SEGMENT));
+            memset(&segments[nSegments], 0, sizeof(INDEX_SEGMENT));
+            segments[nSegments].path = paths[f];
+            segments[nSegments].fileId = f;
+            segments[nSegments].firstDigraph = first;
+            segments[nSegments++].nDigraphs = files[f].nDigraphs - first < INDEX_SEGMENT_DIGRAPHS ?
+                                              files[f].nDigraphs - first : INDEX_SEGMENT_DIGRAPHS;
+        }
+    }
+
+    THREAD_POOL *pool = nJobs > 1 ? createThreadPool(nJobs) : NULL;
+    for (size_t s = 0; s < nSegments; s++) {
+        if (pool != NULL)
+            submitTask(pool, runIndexSegment, &segments[s]);
+        else runIndexSegment(&segments[s]);
+    }
+    if (pool != NULL) {
+        waitThreadPool(pool);
+        destroyThreadPool(pool);
+    }
+
+    int failed = 0;
+    for (size_t s = 0; s < nSegments; s++)
+        if (segments[s].failed) {
+            fprintf(stderr, "\nERROR: the file '%s' cannot be read!\n\n", segments[s].path);
+            failed = 1;
+        }
+    uint64_t indexSize = failed ? 0 : writeIndex(indexPath, files, paths, nFiles, &oldIndex, newIds, segments,
+                                                 nSegments);
+    if (!failed && indexSize == 0)
+        fprintf(stderr, "\nERROR: the index '%s' cannot be written!\n\n", indexPath);
+    else if (!failed && output == OUTPUT_JSON) {
+        printf("{\"index\":");
+        printJsonString(stdout, indexPath);
+        printf(",\"files\":%llu,\"reused\":%llu,\"digraphs\":%llu,\"size\":%llu}\n", (unsigned long long) nFiles,
+               (unsigned long long) nReused, (unsigned long long) nDigraphs, (unsigned long long) indexSize);
+    } else if (!failed && output == OUTPUT_NORMAL)
+        printf("\nindexed: %llu files (%llu unchanged), %llu digraphs, index size: %llu bytes\n\n",
+               (unsigned long long) nFiles, (unsigned long long) nReused, (unsigned long long) nDigraphs,
+               (unsigned long long) indexSize);
+
+    for (size_t s = 0; s < nSegments; s++) {
+        free(segments[s].records.data);
+        free(segments[s].buckets);
+    }
+    free(segments);
+    free(files);
+    free(newIds);
+    free(oldNames);
+    closeIndex(&oldIndex);
+    return indexSize > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Collects the candidates of the given pattern from the index: the rarest shingle of the pattern
+ * (the one with the smallest postings) is looked up, and every position where it occurs gives the
+ * position where the pattern would start. Only the files marked as fresh are considered.
+ */
+static void collectCandidates(const INDEX *index, const SEARCH_PATTERN *pattern, const char *fresh,
+                              INDEX_CANDIDATE **candidates, size_t *nCandidates, size_t *capacity) {
+    uint64_t best = 0, bestBucket = 0;
+
+    for (uint64_t k = 0; k + 1 < pattern->nDigraphs; k++) {
+        uint64_t bucket = (uint64_t) getDigraphValue(pattern->text + 3 * k) * INDEX_DIGRAPHS +
+                          (uint64_t) getDigraphValue(pattern->text + 3 * k + 3);
+        if (k == 0 || getBucketSize(index, bucket) < getBucketSize(index, bestBucket)) {
+            best = k;
+            bestBucket = bucket;
+        }
+    }
+
+    const unsigned char *cursor = index->postings + index->buckets[bestBucket];
+    const unsigned char *end = index->postings + index->buckets[bestBucket + 1];
+    uint64_t fileId, count, delta;
+    while (cursor < end) {
+        if (readVarint(&cursor, end, &fileId) != 0 || readVarint(&cursor, end, &count) != 0)
+            return;
+        for (uint64_t k = 0, position = 0; k < count; k++) {
+            if (readVarint(&cursor, end, &delta) != 0)
+                return;
+            position = k == 0 ? delta : position + delta;
+            if (fileId >= index->header->nFiles || !fresh[fileId] || position < best)
+                continue;
+            if (*nCandidates == *capacity) {
+                *capacity = *capacity == 0 ? 64 : 2 * *capacity;
+                *candidates = memoryRealloc(*candidates, *capacity * sizeof(INDEX_CANDIDATE));
+            }
+            INDEX_CANDIDATE *candidate = &(*candidates)[(*nCandidates)++];
+            candidate->fileId = fileId;
+            candidate->position = 3 * (position - best);
+            candidate->offset = candidate->position - (pattern->alignment == 1 ? 2 : 0);
+            candidate->alignment = pattern->alignment;
+        }
+    }
+}
+
+/**
+ * Checks the given candidates of a file by reading only the digraphs around them, and records
+ * the hits in the given SEARCH_JOB.
+ */
+static void checkCandidates(const SEARCHER *searcher, SEARCH_JOB *job, const INDEX_CANDIDATE *candidates,
+                            size_t nCandidates) {
+    int fd = open(job->path, O_RDONLY);
+    char *window = stringMalloc(searcher->margin + 3);
+
+    job->status = fd < 0 ? SEARCH_FAILED : SEARCH_NOT_FOUND;
+    for (size_t c = 0; c < nCandidates && fd >= 0; c++) {
+        const SEARCH_PATTERN *pattern = &searcher->patterns[candidates[c].alignment];
+        uint64_t start = candidates[c].position >= 3 ? candidates[c].position - 3 : 0;
+        ssize_t nRead = pread(fd, window, candidates[c].position - start + 3 * pattern->nDigraphs + 2, (off_t) start);
+        if (nRead < 0) {
+            job->status = SEARCH_FAILED;
+            break;
+        }
+        if (isSearchHit(searcher, pattern, window, (size_t) nRead, candidates[c].position - start, start))
+            addSearchHit(job, candidates[c].offset);
+    }
+    if (job->status != SEARCH_FAILED && job->nOffsets > 0)
+        job->status = SEARCH_FOUND;
+    if (fd >= 0)
+        close(fd);
+    else fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", job->path);
+    free(window);
+}
+
+/**
+ * Searches a word in the files of the given index with the given KEYFILE: the word is compiled
+ * into its ciphertext at both its alignments like for the "grep" command, and the index gives the
+ * positions where the ciphertext can start (see @collectCandidates()), which are then checked by
+ * reading just a few bytes of the files. The files changed since they were indexed, and all the
+ * files if the word is too short to contain 2 complete digraphs at both alignments (less than 6
+ * letters, in general), are scanned in full instead.
+ *
+ * @return EXIT_SUCCESS if the word was found in any file and no file failed, EXIT_FAILURE otherwise
+ */
+static int queryIndex(int argc, char **argv) {
+    SEARCHER searcher;
+    size_t nJobs = 1, nCandidates = 0, capacity = 0;
+    INDEX index;
+    INDEX_CANDIDATE *candidates = NULL;
+    int nFound = 0, nFailed = 0;
+
+    searcher.output = OUTPUT_NORMAL;
+    int i = parseIndexOptions(argc, argv, 0, &nJobs, &searcher.output);
+
+    if (argc - i != 3)
+        printIndexUsage();
+    if (openIndex(argv[i + 1], &index) != 0) {
+        fprintf(stderr, "\nERROR: the index '%s' does not exist or is not valid!\n\n", argv[i + 1]);
+        return EXIT_FAILURE;
+    }
+
+    KEYFILE keyFile = createKeyFileFromFile(argv[i]);
+    MATRIX playfairMatrix = createMatrix(keyFile);
+    CIPHER_TABLE encodeTable = createCipherTable(playfairMatrix, keyFile, "encode");
+    CIPHER_TABLE decodeTable = createCipherTable(playfairMatrix, keyFile, "decode");
+    initSearcher(&searcher, &encodeTable, &decodeTable, argv[i + 2]);
+
+    uint64_t nFiles = index.header->nFiles;
+    SEARCH_JOB *jobs = memoryCalloc(nFiles + 1, sizeof(SEARCH_JOB));
+    char *fresh = memoryCalloc(nFiles + 1, sizeof(char));
+    int useIndex = searcher.patterns[0].nDigraphs >= 2 && searcher.patterns[1].nDigraphs >= 2;
+    for (uint64_t f = 0; f < nFiles; f++) {
+        struct stat fileStat;
+        jobs[f].searcher = &searcher;
+        jobs[f].index = (int) f;
+        jobs[f].path = (char *) getIndexedPath(&index, f);
+        jobs[f].status = SEARCH_NOT_FOUND;
+        fresh[f] = useIndex && stat(jobs[f].path, &fileStat) == 0 &&
+                   (uint64_t) fileStat.st_size == index.files[f].size &&
+                   getModificationTime(&fileStat) == index.files[f].modificationTime;
+        if (useIndex && !fresh[f])
+            fprintf(stderr, "WARNING: the file '%s' has changed since it was indexed and is searched in full\n",
+                    jobs[f].path);
+        if (!fresh[f])
+            searchFile(&jobs[f]);
+    }
+
+    if (useIndex) {
+        for (int a = 0; a < 2; a++)
+            collectCandidates(&index, &searcher.patterns[a], fresh, &candidates, &nCandidates, &capacity);
+        qsort(candidates, nCandidates, sizeof(INDEX_CANDIDATE), compareCandidates);
+        for (size_t c = 0, next; c < nCandidates; c = next) {
+            for (next = c; next < nCandidates && candidates[next].fileId == candidates[c].fileId; next++);
+            checkCandidates(&searcher, &jobs[candidates[c].fileId], candidates + c, next - c);
+        }
+    }
+
+    for (uint64_t f = 0; f < nFiles; f++) {
+        if (jobs[f].status != SEARCH_NOT_FOUND)
+            printSearchJob(&jobs[f]);
+        nFound += jobs[f].status == SEARCH_FOUND;
+        nFailed += jobs[f].status == SEARCH_FAILED;
+        free(jobs[f].offsets);
+    }
+    free(jobs);
+    free(fresh);
+    free(candidates);
+    freeSearcher(&searcher);
+    freeMatrix(playfairMatrix);
+    freeKeyFile(keyFile);
+    closeIndex(&index);
+    return nFound > 0 && nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Builds an inverted index of encoded files ("index build", see @buildIndex()) or searches a word
+ * with it ("index query", see @queryIndex()).
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if the command succeeded, EXIT_FAILURE otherwise
+ */
+int startIndexer(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[2], "build") == 0)
+        return buildIndex(argc, argv);
+    if (argc >= 3 && strcmp(argv[2], "query") == 0)
+        return queryIndex(argc, argv);
+    printIndexUsage();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,7 @@
+
+#ifndef PLAYFAIR_INDEXMANAGER_H
+#define PLAYFAIR_INDEXMANAGER_H
+
+int startIndexer(int argc, char **argv);
+
+#endif //PLAYFAIR_INDEXMANAGER_H
@@ -0,0 +1,470 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "integrityManager.h"
+#include "threadPool.h"
+#include "printer.h"
+#include "optionManager.h"
+#include "utils.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE
+#endif
+
+/**
+ * The amount of blocks checked by a single task of the checker, so that the blocks of a large
+ * file are checked in parallel too.
+ */
+#define CHECK_SEGMENT_BLOCKS 64
+
+/**
+ * The reversed Castagnoli polynomial used by CRC32C.
+ */
+#define CRC32C_POLYNOMIAL 0x82F63B78u
+
+typedef enum {
+    CHECK_OK,
+    CHECK_CORRUPTED,
+    CHECK_FAILED
+} CHECK_STATUS;
+
+typedef struct {
+    int index;
+    char *path;
+    int fd;
+    uint64_t size;
+    uint64_t expectedSize;
+    uint64_t digraphs;
+    uint64_t fingerprint;
+    uint32_t *checksums;
+    size_t nBlocks;
+    char *badBlocks;
+    CHECK_STATUS status;
+} CHECK_JOB;
+
+typedef struct {
+    CHECK_JOB *job;
+    size_t firstBlock;
+    size_t nBlocks;
+} CHECK_SEGMENT;
+
+static uint32_t crcTable[8][256];
+static int hardwareCrc = 0;
+static pthread_once_t crcInitialization = PTHREAD_ONCE_INIT;
+
+/**
+ * Builds the tables used to compute CRC32C eight bytes at a time in software and checks whether
+ * the processor can compute it in hardware (SSE4.2).
+ */
+static void initCrc() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        crcTable[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++)
+        for (int i = 0; i < 256; i++)
+            crcTable[k][i] = (crcTable[k - 1][i] >> 8) ^ crcTable[0][crcTable[k - 1][i] & 0xff];
+#ifdef CRC32C_HARDWARE
+    __builtin_cpu_init();
+    hardwareCrc = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#ifdef CRC32C_HARDWARE
+/**
+ * Updates the given (already inverted) CRC32C with the SSE4.2 instructions, eight bytes at a time.
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(uint32_t crc, const unsigned char *data, size_t size) {
+    uint64_t crc64 = crc;
+
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t) crc64;
+    for (; size > 0; size--)
+        crc = _mm_crc32_u8(crc, *data++);
+    return crc;
+}
+#endif
+
+/**
+ * Updates the given (already inverted) CRC32C in software, eight bytes at a time ("slicing-by-8").
+ */
+static uint32_t crc32cSoftware(uint32_t crc, const unsigned char *data, size_t size) {
+    for (; size >= 8; data += 8, size -= 8) {
+        uint32_t low = crc ^ ((uint32_t) data[0] | (uint32_t) data[1] << 8 | (uint32_t) data[2] << 16 |
+                              (uint32_t) data[3] << 24);
+        crc = crcTable[7][low & 0xff] ^ crcTable[6][(low >> 8) & 0xff] ^ crcTable[5][(low >> 16) & 0xff] ^
+              crcTable[4][low >> 24] ^ crcTable[3][data[4]] ^ crcTable[2][data[5]] ^ crcTable[1][data[6]] ^
+              crcTable[0][data[7]];
+    }
+    for (; size > 0; size--)
+        crc = crcTable[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+/**
+ * Computes the CRC32C (Castagnoli) checksum of the given data, continuing the given checksum
+ * (0 for new data). The checksum is computed with the SSE4.2 instructions when the processor
+ * supports them, and in software otherwise.
+ *
+ * @param crc - the checksum of the previous data
+ * @param data - the data to add to the checksum
+ * @param size - the amount of bytes of data
+ * @return the updated checksum
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t size) {
+    pthread_once(&crcInitialization, initCrc);
+#ifdef CRC32C_HARDWARE
+    if (hardwareCrc)
+        return ~crc32cHardware(~crc, data, size);
+#endif
+    return ~crc32cSoftware(~crc, data, size);
+}
+
+/**
+ * Initializes the given INTEGRITY, which collects the checksums of an output while it is written.
+ *
+ * @param integrity - the INTEGRITY to initialize
+ */
+void initIntegrity(INTEGRITY *integrity) {
+    memset(integrity, 0, sizeof(INTEGRITY));
+}
+
+/**
+ * Appends the given block checksum to the given INTEGRITY.
+ */
+static void appendChecksum(INTEGRITY *integrity, uint32_t checksum) {
+    if (integrity->nBlocks == integrity->capacity) {
+        integrity->capacity = integrity->capacity == 0 ? 64 : integrity->capacity * 2;
+        integrity->checksums = memoryRealloc(integrity->checksums, integrity->capacity * sizeof(uint32_t));
+    }
+    integrity->checksums[integrity->nBlocks++] = checksum;
+}
+
+/**
+ * Adds the given output characters to the checksums of the given INTEGRITY: every
+ * @INTEGRITY_BLOCK_SIZE characters a block is complete and its checksum is stored.
+ *
+ * @param integrity - the INTEGRITY to update
+ * @param data - the characters written to the output
+ * @param size - the amount of characters
+ */
+void updateIntegrity(INTEGRITY *integrity, const char *data, size_t size) {
+    while (size > 0) {
+        size_t offset = integrity->size % INTEGRITY_BLOCK_SIZE;
+        size_t n = size < INTEGRITY_BLOCK_SIZE - offset ? size : INTEGRITY_BLOCK_SIZE - offset;
+
+        integrity->blockChecksum = crc32c(offset == 0 ? 0 : integrity->blockChecksum, data, n);
+        integrity->size += n;
+        data += n;
+        size -= n;
+        if (integrity->size % INTEGRITY_BLOCK_SIZE == 0)
+            appendChecksum(integrity, integrity->blockChecksum);
+    }
+}
+
+/**
+ * Frees the checksums of the given INTEGRITY.
+ *
+ * @param integrity - the INTEGRITY to free
+ */
+void freeIntegrity(INTEGRITY *integrity) {
+    free(integrity->checksums);
+    integrity->checksums = NULL;
+}
+
+/**
+ * Returns the path of the integrity sidecar of the given output file, which is the output path
+ * with the addition of the ".pfsum" extension.
+ *
+ * @param outputPath - the path of the output file
+ * @return the path of the sidecar file
+ */
+char *getIntegrityPath(const char *outputPath) {
+    char *integrityPath = stringMalloc(strlen(outputPath) + 7);
+    strcpy(integrityPath, outputPath);
+    strcat(integrityPath, ".pfsum");
+    return integrityPath;
+}
+
+/**
+ * Completes the given INTEGRITY (the checksum of the last, partial block is stored) and writes it
+ * to the sidecar file of the given output, together with the size of the output, its amount of
+ * digraphs and the fingerprint of the key. The sidecar is written to a temporary file that is
+ * then renamed, so that it is never found incomplete. Its format is:
+ * "playfair-integrity 1", the header lines "fingerprint", "size", "digraphs", "block-size" and
+ * "blocks", followed by the hexadecimal CRC32C of every block, one per line.
+ *
+ * @param outputPath - the path of the output file described by the INTEGRITY
+ * @param integrity - the INTEGRITY collected while the output was written
+ * @param digraphs - the amount of digraphs of the output
+ * @param fingerprint - the fingerprint of the key used to write the output
+ * @return 0 if the sidecar was written, -1 otherwise
+ */
+int writeIntegrity(const char *outputPath, INTEGRITY *integrity, uint64_t digraphs, uint64_t fingerprint) {
+    char *integrityPath = getIntegrityPath(outputPath);
+    char *tempPath = stringMalloc(strlen(integrityPath) + 5);
+    int result = -1;
+
+    if (integrity->size % INTEGRITY_BLOCK_SIZE != 0)
+        appendChecksum(integrity, integrity->blockChecksum);
+
+    sprintf(tempPath, "%s.tmp", integrityPath);
+    FILE *file = fopen(tempPath, "w");
+    if (file != NULL) {
+        fprintf(file, "playfair-integrity 1\nfingerprint %016" PRIx64 "\nsize %" PRIu64 "\ndigraphs %" PRIu64
+                      "\nblock-size %d\nblocks %zu\n", fingerprint, integrity->size, digraphs,
+                INTEGRITY_BLOCK_SIZE, integrity->nBlocks);
+        for (size_t i = 0; i < integrity->nBlocks; i++)
+            fprintf(file, "%08" PRIx32 "\n", integrity->checksums[i]);
+        int failed = ferror(file);
+        failed |= fclose(file) != 0;
+        if (!failed && rename(tempPath, integrityPath) == 0)
+            result = 0;
+        else unlink(tempPath);
+    }
+    if (result != 0)
+        fprintf(stderr, "\nERROR: the integrity sidecar '%s' cannot be written!\n\n", integrityPath);
+    free(tempPath);
+    free(integrityPath);
+    return result;
+}
+
+/**
+ * Writes the integrity sidecar of an output file that has already been written, reading it
+ * again (used when the output was not written in a single stream, e.g. when it was resumed).
+ * The amount of digraphs is obtained from the size of the output, where every digraph but the
+ * first one is preceded by a blank space.
+ *
+ * @param outputPath - the path of the output file
+ * @param fingerprint - the fingerprint of the key used to write the output
+ * @return 0 if the sidecar was written, -1 otherwise
+ */
+int writeIntegrityFromFile(const char *outputPath, uint64_t fingerprint) {
+    FILE *file = fopen(outputPath, "r");
+    char *buffer = stringMalloc(INTEGRITY_BLOCK_SIZE);
+    INTEGRITY integrity;
+    size_t nRead;
+    int result = -1, readFailed = file == NULL;
+
+    initIntegrity(&integrity);
+    if (file != NULL) {
+        while ((nRead = fread(buffer, sizeof(char), INTEGRITY_BLOCK_SIZE, file)) > 0)
+            updateIntegrity(&integrity, buffer, nRead);
+        readFailed = ferror(file);
+        fclose(file);
+    }
+    if (readFailed)
+        fprintf(stderr, "\nERROR: the output file '%s' cannot be read!\n\n", outputPath);
+    else result = writeIntegrity(outputPath, &integrity, (integrity.size + 1) / 3, fingerprint);
+    freeIntegrity(&integrity);
+    free(buffer);
+    return result;
+}
+
+/**
+ * Reads the integrity sidecar of the file of the given CHECK_JOB.
+ *
+ * @return 0 if a valid sidecar was read, -1 otherwise
+ */
+static int readIntegrity(CHECK_JOB *job) {
+    char *integrityPath = getIntegrityPath(job->path);
+    FILE *file = fopen(integrityPath, "r");
+    int blockSize = 0, result = -1;
+
+    free(integrityPath);
+    if (file == NULL)
+        return -1;
+    if (fscanf(file, "playfair-integrity 1\nfingerprint %" SCNx64 "\nsize %" SCNu64 "\ndigraphs %" SCNu64
+                     "\nblock-size %d\nblocks %zu", &job->fingerprint, &job->expectedSize, &job->digraphs,
+               &blockSize, &job->nBlocks) == 5 && blockSize == INTEGRITY_BLOCK_SIZE &&
+        job->nBlocks == (job->expectedSize + INTEGRITY_BLOCK_SIZE - 1) / INTEGRITY_BLOCK_SIZE) {
+        job->checksums = memoryMalloc((job->nBlocks + 1) * sizeof(uint32_t));
+        job->badBlocks = memoryCalloc(job->nBlocks + 1, sizeof(char));
+        result = 0;
+        for (size_t i = 0; i < job->nBlocks && result == 0; i++)
+            if (fscanf(file, "%" SCNx32, &job->checksums[i]) != 1)
+                result = -1;
+    }
+    fclose(file);
+    return result;
+}
+
+/**
+ * Checks a segment of consecutive blocks of a file against the checksums of its sidecar, reading
+ * them with "pread()" so that many segments of the same file can be checked in parallel.
+ * A block that cannot be read, is shorter than expected or whose checksum differs is marked as bad.
+ *
+ * @param argument - the CHECK_SEGMENT to check
+ */
+static void checkSegment(void *argument) {
+    CHECK_SEGMENT *segment = argument;
+    CHECK_JOB *job = segment->job;
+    char *buffer = stringMalloc(INTEGRITY_BLOCK_SIZE);
+
+    for (size_t block = segment->firstBlock; block < segment->firstBlock + segment->nBlocks; block++) {
+        uint64_t offset = (uint64_t) block * INTEGRITY_BLOCK_SIZE;
+        size_t expected = job->expectedSize - offset < INTEGRITY_BLOCK_SIZE ? job->expectedSize - offset
+                                                                            : INTEGRITY_BLOCK_SIZE;
+        size_t nRead = 0;
+        ssize_t n;
+
+        while (nRead < expected && (n = pread(job->fd, buffer + nRead, expected - nRead, (off_t) (offset + nRead))) > 0)
+            nRead += (size_t) n;
+        if (nRead != expected || crc32c(0, buffer, expected) != job->checksums[block])
+            job->badBlocks[block] = 1;
+    }
+    free(buffer);
+    free(segment);
+}
+
+/**
+ * Prints the result of the check of a file, depending on the output mode.
+ */
+static void printCheckJob(CHECK_JOB *job, OUTPUT_MODE outputMode) {
+    static const char *statusNames[] = {"ok", "corrupted", "failed"};
+    int first = 1;
+
+    if (outputMode == OUTPUT_QUIET)
+        return;
+    if (outputMode == OUTPUT_JSON) {
+        printf("{\"index\":%d,\"file\":", job->index + 1);
+        printJsonString(stdout, job->path);
+        printf(",\"status\":\"%s\"", statusNames[job->status]);
+        if (job->status != CHECK_FAILED) {
+            printf(",\"size\":%" PRIu64 ",\"expected_size\":%" PRIu64 ",\"digraphs\":%" PRIu64
+                   ",\"fingerprint\":\"%016" PRIx64 "\",\"bad_blocks\":[", job->size, job->expectedSize,
+                   job->digraphs, job->fingerprint);
+            for (size_t i = 0; i < job->nBlocks; i++)
+                if (job->badBlocks[i]) {
+                    printf("%s%zu", first ? "" : ",", i);
+                    first = 0;
+                }
+            printf("]");
+        }
+        printf("}\n");
+        return;
+    }
+
+    printf("\nfile %d: %s\n", job->index + 1, job->path);
+    if (job->status == CHECK_FAILED)
+        printf("FAILED (missing or invalid integrity sidecar)\n");
+    else if (job->status == CHECK_OK)
+        printf("OK (%zu blocks, %" PRIu64 " digraphs, key fingerprint %016" PRIx64 ")\n", job->nBlocks, job->digraphs,
+               job->fingerprint);
+    else {
+        printf("CORRUPTED");
+        if (job->size != job->expectedSize)
+            printf(": size %" PRIu64 " instead of %" PRIu64, job->size, job->expectedSize);
+        printf("\n");
+        for (size_t i = 0; i < job->nBlocks; i++)
+            if (job->badBlocks[i])
+                printf("  block %zu (bytes %" PRIu64 "-%" PRIu64 ")\n", i, (uint64_t) i * INTEGRITY_BLOCK_SIZE,
+                       (uint64_t) (i + 1) * INTEGRITY_BLOCK_SIZE - 1 < job->expectedSize
+                       ? (uint64_t) (i + 1) * INTEGRITY_BLOCK_SIZE - 1 : job->expectedSize - 1);
+    }
+}
+
+/**
+ * Prints the correct syntax of the check command and ends the program.
+ */
+static void printCheckUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE INTEGRITY CHECK:\n");
+    fprintf(stderr, "'<playfair> check [--jobs <n>] [--quiet|--json] <file1> ... <filen>'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Checks the given files against their integrity sidecars (written with the option "--integrity"),
+ * without the key: the size of every file and the CRC32C of every block are compared with the ones
+ * stored in the sidecar, and the corrupted blocks are reported by index and byte range. The blocks
+ * are checked in segments of @CHECK_SEGMENT_BLOCKS blocks, which (with the option "--jobs") are
+ * checked in parallel, both across files and within a large file.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if every file is intact, EXIT_FAILURE otherwise
+ */
+int startChecker(int argc, char **argv) {
+    size_t nJobs = 1;
+    OUTPUT_MODE outputMode = OUTPUT_NORMAL;
+    int i = 2, nFailed = 0;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            nJobs = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--quiet") == 0)
+            outputMode = OUTPUT_QUIET;
+        else if (strcmp(argv[i], "--json") == 0)
+            outputMode = OUTPUT_JSON;
+        else printCheckUsage();
+    }
+    if (i >= argc)
+        printCheckUsage();
+
+    int nFiles = argc - i;
+    CHECK_JOB *jobs = memoryCalloc(nFiles, sizeof(CHECK_JOB));
+    THREAD_POOL *pool = nJobs > 1 ? createThreadPool(nJobs) : NULL;
+
+    for (int f = 0; f < nFiles; f++) {
+        CHECK_JOB *job = &jobs[f];
+        struct stat fileStat;
+
+        job->index = f;
+        job->path = argv[i + f];
+        job->fd = open(job->path, O_RDONLY);
+        if (job->fd < 0 || fstat(job->fd, &fileStat) != 0 || readIntegrity(job) != 0) {
+            job->status = CHECK_FAILED;
+            continue;
+        }
+        job->size = (uint64_t) fileStat.st_size;
+        for (size_t block = 0; block < job->nBlocks; block += CHECK_SEGMENT_BLOCKS) {
+            CHECK_SEGMENT *segment = memoryMalloc(sizeof(CHECK_SEGMENT));
+            segment->job = job;
+            segment->firstBlock = block;
+            segment->nBlocks = job->nBlocks - block < CHECK_SEGMENT_BLOCKS ? job->nBlocks - block : CHECK_SEGMENT_BLOCKS;
+            if (pool != NULL)
+                submitTask(pool, checkSegment, segment);
+            else checkSegment(segment);
+        }
+    }
+    if (pool != NULL) {
+        waitThreadPool(pool);
+        destroyThreadPool(pool);
+    }
+
+    for (int f = 0; f < nFiles; f++) {
+        CHECK_JOB *job = &jobs[f];
+        if (job->status != CHECK_FAILED) {
+            job->status = job->size == job->expectedSize &&
+                          job->expectedSize == (job->digraphs > 0 ? 3 * job->digraphs - 1 : 0) ? CHECK_OK : CHECK_CORRUPTED;
+            for (size_t block = 0; block < job->nBlocks; block++)
+                if (job->badBlocks[block])
+                    job->status = CHECK_CORRUPTED;
+        }
+        printCheckJob(job, outputMode);
+        nFailed += job->status != CHECK_OK;
+        if (job->fd >= 0)
+            close(job->fd);
+        free(job->checksums);
+        free(job->badBlocks);
+    }
+    if (outputMode == OUTPUT_NORMAL)
+        printf("\nintact: %d, corrupted or unchecked: %d\n\n", nFiles - nFailed, nFailed);
+    free(jobs);
+    return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
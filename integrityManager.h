@@ -0,0 +1,37 @@
+
+#ifndef PLAYFAIR_INTEGRITYMANAGER_H
+#define PLAYFAIR_INTEGRITYMANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The amount of output characters covered by every checksum of the integrity sidecar.
+ */
+#define INTEGRITY_BLOCK_SIZE (1024 * 1024)
+
+typedef struct {
+    uint64_t size;
+    uint32_t blockChecksum;
+    uint32_t *checksums;
+    size_t nBlocks;
+    size_t capacity;
+} INTEGRITY;
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t size);
+
+void initIntegrity(INTEGRITY *integrity);
+
+void updateIntegrity(INTEGRITY *integrity, const char *data, size_t size);
+
+void freeIntegrity(INTEGRITY *integrity);
+
+char *getIntegrityPath(const char *outputPath);
+
+int writeIntegrity(const char *outputPath, INTEGRITY *integrity, uint64_t digraphs, uint64_t fingerprint);
+
+int writeIntegrityFromFile(const char *outputPath, uint64_t fingerprint);
+
+int startChecker(int argc, char **argv);
+
+#endif //PLAYFAIR_INTEGRITYMANAGER_H
@@ -12,48 +12,83 @@ char MISSING_CHAR = '?';
 /**
  * Creates a new KEYFILE reading the necessary data from a specific file
  * opened with the given path.
- * Eventually it sets the missing char from the KEYFILE's alphabet.
- * If the KEYFILE is empty, an error is printed and the program ends.
- * If the key contains the missing character from the alphabet, it is
- * substituted with the replacement character.
+ * If the KEYFILE cannot be loaded with the method @loadKeyFile(), the program ends.
  *
  * @param keyFilePath - the path of the file from which the data has to be read
  * @return the new KEYFILE
  */
 KEYFILE createKeyFileFromFile(char *keyFilePath) {
-    FILE *file = openFile(keyFilePath, "r+");
+    KEYFILE keyFile;
+    if (loadKeyFile(keyFilePath, &keyFile) != 0)
+        exit(EXIT_FAILURE);
+    return keyFile;
+}
+
+/**
+ * Loads a KEYFILE reading the necessary data from a specific file opened with the given path.
+ * Eventually it sets the missing char from the KEYFILE's alphabet.
+ * If the file cannot be opened, the KEYFILE is empty or one of its attributes is not valid,
+ * an error is printed and -1 is returned, without terminating the program (so that long-running
+ * modes can skip a broken KEYFILE).
+ * If the key contains the missing character from the alphabet, it is substituted with the
+ * replacement character.
+ *
+ * @param keyFilePath - the path of the file from which the data has to be read
+ * @param keyFile - the pointer to the struct KEYFILE to fill
+ * @return 0 if the KEYFILE was loaded, -1 otherwise
+ */
+int loadKeyFile(char *keyFilePath, KEYFILE *keyFile) {
+    FILE *file = fopen(keyFilePath, "r");
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", keyFilePath);
+        return -1;
+    }
     size_t fileSize = getFileSize(file);
 
     if (fileSize == 0) {
         fprintf(stderr, "ERROR: the KEYFILE is empty!\n\n");
-        exit(EXIT_FAILURE);
+        fclose(file);
+        return -1;
     }
 
-    KEYFILE keyFile;
-    readKeyFileAlphabet(file, &keyFile);
-    readKeyFileMissingChar(file, &keyFile);
-    readKeyFileSpecialChar(file, &keyFile);
-    readKeyFileKey(file, fileSize, &keyFile);
+    keyFile->key = NULL;
+    if (readKeyFileAlphabet(file, keyFile) != 0 || readKeyFileMissingChar(file, keyFile) != 0 ||
+        readKeyFileSpecialChar(file, keyFile) != 0) {
+        fclose(file);
+        return -1;
+    }
+    readKeyFileKey(file, fileSize, keyFile);
 
     fclose(file);
 
-    setMissingChar(keyFile);
-    substituteMissingCharacter(keyFile.key, keyFile.replacementCharacter);
-    return keyFile;
+    setMissingChar(*keyFile);
+    substituteMissingCharacter(keyFile->key, keyFile->replacementCharacter);
+    return 0;
+}
+
+/**
+ * Frees the attributes of the given KEYFILE.
+ *
+ * @param keyFile - the KEYFILE to free
+ */
+void freeKeyFile(KEYFILE keyFile) {
+    free(keyFile.alphabet);
+    free(keyFile.key);
 }
 
 /**
  * Reads all the characters until the first '\n' from the given file and stores
  * them in the "alphabet" attribute of the given pointer to the struct KEYFILE.
  * If less than 25 letters are read and/or multiple occurrences of the same letter
- * are read within the 25 letters, an error is printed and the program ends.
+ * are read within the 25 letters, an error is printed and -1 is returned.
  * The alphabet is stored in uppercase.
  *
  * @param file - the file from which the alphabet has to be read
  * @param keyFile - the pointer to the struct KEYFILE
+ * @return 0 if the alphabet is valid, -1 otherwise
  */
-void readKeyFileAlphabet(FILE *file, KEYFILE *keyFile) {
-    keyFile->alphabet = calloc(26, sizeof(char));
+int readKeyFileAlphabet(FILE *file, KEYFILE *keyFile) {
+    keyFile->alphabet = stringCalloc(26);
     char c = 0;
     int pos = 0;
 
@@ -69,21 +104,23 @@ void readKeyFileAlphabet(FILE *file, KEYFILE *keyFile) {
     if (pos != 25) {
         free(keyFile->alphabet);
         fprintf(stderr, "ERROR: alphabet has the wrong length (expected 25, has %d)!\n\n", pos);
-        exit(EXIT_FAILURE);
+        return -1;
     }
     toUpperString(keyFile->alphabet);
+    return 0;
 }
 
 /**
  * Stores the next letter from the file in the "replacementChar" attribute of the
  * given pointer to the struct KEYFILE. The replacement character is stored in uppercase.
  * If the replacement char is not contained in the KEYFILE alphabet or if there's not any
- * replacement char, an error is printed and the program ends.
+ * replacement char, an error is printed and -1 is returned.
  *
  * @param file - the file from which the missing character has to be read
  * @param keyFile - the pointer to the struct KEYFILE
+ * @return 0 if the replacement char is valid, -1 otherwise
  */
-void readKeyFileMissingChar(FILE *file, KEYFILE *keyFile) {
+int readKeyFileMissingChar(FILE *file, KEYFILE *keyFile) {
     char replChar;
     do {
         replChar = (char) fgetc(file);
@@ -91,13 +128,16 @@ void readKeyFileMissingChar(FILE *file, KEYFILE *keyFile) {
 
     if (replChar == EOF) {
         fprintf(stderr, "ERROR: there is no replacement char in the given file!\n\n");
-        exit(EXIT_FAILURE);
+        free(keyFile->alphabet);
+        return -1;
     }
     if (strchr(keyFile->alphabet, toupper(replChar)) == NULL) {
         fprintf(stderr, "ERROR: the given replacement char is not contained in the given alphabet!\n\n");
-        exit(EXIT_FAILURE);
+        free(keyFile->alphabet);
+        return -1;
     }
     keyFile->replacementCharacter = (char) toupper(replChar);
+    return 0;
 }
 
 /**
@@ -105,11 +145,14 @@ void readKeyFileMissingChar(FILE *file, KEYFILE *keyFile) {
  * given pointer to the struct KEYFILE. The special character is stored in uppercase.
  * Then an "fgetc()" is called to move the file pointer one position forward to skip
  * the next '\n'.
+ * If there is no special char or if it is not contained in the KEYFILE alphabet, an error
+ * is printed and -1 is returned.
  *
  * @param file - the file from which the special character has to be read
  * @param keyFile - the pointer to the struct KEYFILE
+ * @return 0 if the special char is valid, -1 otherwise
  */
-void readKeyFileSpecialChar(FILE *file, KEYFILE *keyFile) {
+int readKeyFileSpecialChar(FILE *file, KEYFILE *keyFile) {
     char specialChar;
     do {
         specialChar = (char) fgetc(file);
@@ -117,14 +160,17 @@ void readKeyFileSpecialChar(FILE *file, KEYFILE *keyFile) {
 
     if (specialChar == EOF) {
         fprintf(stderr, "ERROR: there is no special char in the given file!\n\n");
-        exit(EXIT_FAILURE);
+        free(keyFile->alphabet);
+        return -1;
     }
     if (strchr(keyFile->alphabet, toupper(specialChar)) == NULL) {
         fprintf(stderr, "ERROR: the given special char is not contained in the given alphabet!\n\n");
-        exit(EXIT_FAILURE);
+        free(keyFile->alphabet);
+        return -1;
     }
     keyFile->specialCharacter = (char) toupper(specialChar);
     fgetc(file);
+    return 0;
 }
 
 /**
@@ -13,11 +13,15 @@ typedef struct {
 
 KEYFILE createKeyFileFromFile(char *keyFilePath);
 
-void readKeyFileAlphabet(FILE *file, KEYFILE *keyFile);
+int loadKeyFile(char *keyFilePath, KEYFILE *keyFile);
 
-void readKeyFileMissingChar(FILE *file, KEYFILE *keyFile);
+void freeKeyFile(KEYFILE keyFile);
 
-void readKeyFileSpecialChar(FILE *file, KEYFILE *keyFile);
+int readKeyFileAlphabet(FILE *file, KEYFILE *keyFile);
+
+int readKeyFileMissingChar(FILE *file, KEYFILE *keyFile);
+
+int readKeyFileSpecialChar(FILE *file, KEYFILE *keyFile);
 
 void readKeyFileKey(FILE *file, size_t fileSize, KEYFILE *keyFile);
 
@@ -0,0 +1,206 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "keyRingManager.h"
+#include "fileManager.h"
+#include "utils.h"
+
+/**
+ * Compares two KEYRING_ENTRY by their @id (used to sort and search the keyring).
+ */
+static int compareEntries(const void *a, const void *b) {
+    return strcmp(((const KEYRING_ENTRY *) a)->id, ((const KEYRING_ENTRY *) b)->id);
+}
+
+/**
+ * Adds a new entry with the given ID and KEYFILE to the given KEYRING (which takes ownership
+ * of the KEYFILE), building its MATRIX and its encode and decode CIPHER_TABLE.
+ * The entries are not kept sorted: they have to be sorted once all of them are added.
+ *
+ * @param keyRing - the KEYRING to add the entry to
+ * @param capacity - the pointer to the amount of entries that the KEYRING can contain
+ * @param id - the ID of the new entry
+ * @param keyFile - the KEYFILE of the new entry
+ */
+static void addKeyRingEntry(KEYRING *keyRing, size_t *capacity, const char *id, KEYFILE keyFile) {
+    KEYRING_ENTRY entry;
+
+    entry.id = stringMalloc(strlen(id) + 1);
+    strcpy(entry.id, id);
+    entry.keyFile = keyFile;
+    entry.matrix = createMatrix(entry.keyFile);
+    entry.encodeTable = createCipherTable(entry.matrix, entry.keyFile, "encode");
+    entry.decodeTable = createCipherTable(entry.matrix, entry.keyFile, "decode");
+
+    if (keyRing->size == *capacity) {
+        *capacity = *capacity == 0 ? 16 : *capacity * 2;
+        keyRing->entries = memoryRealloc(keyRing->entries, *capacity * sizeof(KEYRING_ENTRY));
+    }
+    keyRing->entries[keyRing->size++] = entry;
+}
+
+/**
+ * Loads a KEYRING from the given directory: every regular file of the directory (hidden files
+ * excluded) is read as a KEYFILE whose ID is the name of the file. For every KEYFILE the MATRIX
+ * and the encode and decode CIPHER_TABLE are built once, so that they can be reused by every request.
+ * Files that are not valid KEYFILEs are skipped with a warning.
+ * If the directory cannot be opened, an error is printed and -1 is returned.
+ *
+ * @param keyRingPath - the path of the directory containing the KEYFILEs
+ * @param keyRing - the pointer to the KEYRING to fill
+ * @return 0 if the directory was read, -1 otherwise
+ */
+int loadKeyRing(char *keyRingPath, KEYRING *keyRing) {
+    DIR *directory = opendir(keyRingPath);
+    struct dirent *dirEntry;
+    size_t capacity = 0;
+
+    if (directory == NULL) {
+        fprintf(stderr, "\nERROR: the keyring directory '%s' cannot be opened!\n\n", keyRingPath);
+        return -1;
+    }
+
+    keyRing->size = 0;
+    keyRing->entries = NULL;
+
+    while ((dirEntry = readdir(directory)) != NULL) {
+        struct stat fileStat;
+        KEYRING_ENTRY entry;
+
+        if (dirEntry->d_name[0] == '.')
+            continue;
+
+        char *keyFilePath = joinPath(keyRingPath, dirEntry->d_name);
+
+        if (stat(keyFilePath, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) ||
+            loadKeyFile(keyFilePath, &entry.keyFile) != 0) {
+            fprintf(stderr, "WARNING: '%s' is not a valid KEYFILE, skipped\n", keyFilePath);
+            free(keyFilePath);
+            continue;
+        }
+        free(keyFilePath);
+        addKeyRingEntry(keyRing, &capacity, dirEntry->d_name, entry.keyFile);
+    }
+    closedir(directory);
+
+    qsort(keyRing->entries, keyRing->size, sizeof(KEYRING_ENTRY), compareEntries);
+    return 0;
+}
+
+/**
+ * Returns a copy of the given KEYFILE, which has to be freed on its own.
+ */
+static KEYFILE copyKeyFile(KEYFILE keyFile) {
+    KEYFILE copy = keyFile;
+
+    copy.alphabet = stringMalloc(strlen(keyFile.alphabet) + 1);
+    strcpy(copy.alphabet, keyFile.alphabet);
+    copy.key = stringMalloc(strlen(keyFile.key) + 1);
+    strcpy(copy.key, keyFile.key);
+    return copy;
+}
+
+/**
+ * Loads the KEYRING of the keys selected with the options "--keys" and "--keyring".
+ * If a keyring directory is given, it is loaded with @loadKeyRing() and, if a list of keys is
+ * given too, only the keys with the listed IDs are kept. Otherwise every element of the list is
+ * the path of a KEYFILE, whose ID is the name of the file.
+ * If a KEYFILE cannot be loaded, an ID is not in the keyring, two keys have the same ID or no
+ * key at all is selected, an error is printed and -1 is returned.
+ *
+ * @param keyRingPath - the path of the keyring directory, or NULL
+ * @param keyList - the comma separated list of KEYFILE paths (or IDs), or NULL
+ * @param keyRing - the pointer to the KEYRING to fill
+ * @return 0 if the keys were loaded, -1 otherwise
+ */
+int loadKeySelection(char *keyRingPath, char *keyList, KEYRING *keyRing) {
+    KEYRING selection = {NULL, 0};
+    size_t capacity = 0;
+    char *list = NULL, *item, *context;
+    int failed = 0;
+
+    if (keyRingPath != NULL && loadKeyRing(keyRingPath, &selection) != 0)
+        return -1;
+    if (keyList != NULL) {
+        list = stringMalloc(strlen(keyList) + 1);
+        strcpy(list, keyList);
+    }
+
+    if (keyRingPath != NULL && list != NULL) {
+        keyRing->size = 0;
+        keyRing->entries = NULL;
+        for (item = strtok_r(list, ",", &context); item != NULL && !failed; item = strtok_r(NULL, ",", &context)) {
+            KEYRING_ENTRY *entry = findKeyRingEntry(&selection, item);
+            if (entry == NULL) {
+                fprintf(stderr, "\nERROR: the key '%s' is not in the keyring '%s'!\n\n", item, keyRingPath);
+                failed = 1;
+            } else addKeyRingEntry(keyRing, &capacity, entry->id, copyKeyFile(entry->keyFile));
+        }
+        freeKeyRing(&selection);
+    } else if (keyRingPath != NULL) {
+        *keyRing = selection;
+    } else {
+        keyRing->size = 0;
+        keyRing->entries = NULL;
+        for (item = strtok_r(list, ",", &context); item != NULL && !failed; item = strtok_r(NULL, ",", &context)) {
+            KEYFILE keyFile;
+            char *name = strrchr(item, getSeparator()) != NULL ? strrchr(item, getSeparator()) + 1 : item;
+            if (loadKeyFile(item, &keyFile) != 0)
+                failed = 1;
+            else addKeyRingEntry(keyRing, &capacity, name, keyFile);
+        }
+    }
+    free(list);
+
+    qsort(keyRing->entries, keyRing->size, sizeof(KEYRING_ENTRY), compareEntries);
+    for (size_t i = 1; i < keyRing->size && !failed; i++) {
+        if (strcmp(keyRing->entries[i - 1].id, keyRing->entries[i].id) == 0) {
+            fprintf(stderr, "\nERROR: the key '%s' is selected more than once!\n\n", keyRing->entries[i].id);
+            failed = 1;
+        }
+    }
+    if (!failed && keyRing->size == 0) {
+        fprintf(stderr, "\nERROR: no valid KEYFILE has been selected!\n\n");
+        failed = 1;
+    }
+    if (failed) {
+        freeKeyRing(keyRing);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Searches the KEYRING_ENTRY with the given ID in the given KEYRING.
+ *
+ * @param keyRing - the KEYRING where to search
+ * @param id - the ID of the KEYFILE to find
+ * @return a pointer to the KEYRING_ENTRY found, or NULL if there is no KEYFILE with such ID
+ */
+KEYRING_ENTRY *findKeyRingEntry(KEYRING *keyRing, const char *id) {
+    KEYRING_ENTRY key;
+    if (keyRing->size == 0)
+        return NULL;
+    key.id = (char *) id;
+    return bsearch(&key, keyRing->entries, keyRing->size, sizeof(KEYRING_ENTRY), compareEntries);
+}
+
+/**
+ * Frees all the entries of the given KEYRING.
+ *
+ * @param keyRing - the KEYRING to free
+ */
+void freeKeyRing(KEYRING *keyRing) {
+    for (size_t i = 0; i < keyRing->size; i++) {
+        free(keyRing->entries[i].id);
+        freeKeyFile(keyRing->entries[i].keyFile);
+        freeMatrix(keyRing->entries[i].matrix);
+    }
+    free(keyRing->entries);
+    keyRing->entries = NULL;
+    keyRing->size = 0;
+}
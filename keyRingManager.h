@@ -0,0 +1,31 @@
+
+#ifndef PLAYFAIR_KEYRINGMANAGER_H
+#define PLAYFAIR_KEYRINGMANAGER_H
+
+#include <stddef.h>
+#include "keyFileManager.h"
+#include "matrixManager.h"
+#include "cipherManager.h"
+
+typedef struct {
+    char *id;
+    KEYFILE keyFile;
+    MATRIX matrix;
+    CIPHER_TABLE encodeTable;
+    CIPHER_TABLE decodeTable;
+} KEYRING_ENTRY;
+
+typedef struct {
+    KEYRING_ENTRY *entries;
+    size_t size;
+} KEYRING;
+
+int loadKeyRing(char *keyRingPath, KEYRING *keyRing);
+
+int loadKeySelection(char *keyRingPath, char *keyList, KEYRING *keyRing);
+
+KEYRING_ENTRY *findKeyRingEntry(KEYRING *keyRing, const char *id);
+
+void freeKeyRing(KEYRING *keyRing);
+
+#endif //PLAYFAIR_KEYRINGMANAGER_H
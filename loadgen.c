@@ -0,0 +1,135 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "protocolManager.h"
+
+typedef struct {
+    const char *socketPath;
+    const char *keyId;
+    const char *payload;
+    uint32_t payloadSize;
+    size_t nRequests;
+    uint64_t *latencies;
+    size_t nFailures;
+} CONNECTION_LOAD;
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds.
+ */
+static uint64_t nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Sends all the requests of a single connection one after the other, recording the latency
+ * (from the request being sent to the response being fully received) of every one of them.
+ *
+ * @param argument - the CONNECTION_LOAD describing the connection
+ * @return NULL
+ */
+static void *runConnection(void *argument) {
+    CONNECTION_LOAD *load = argument;
+    int fd = connectToServer(load->socketPath);
+
+    for (size_t i = 0; i < load->nRequests; i++) {
+        char status, *response;
+        uint32_t responseSize;
+        uint64_t start = nowNanoseconds();
+
+        if (fd < 0 || sendRequest(fd, PROTOCOL_ENCODE, load->keyId, load->payload, load->payloadSize) != 0 ||
+            receiveResponse(fd, &status, &response, &responseSize) != 0) {
+            load->nFailures += load->nRequests - i;
+            break;
+        }
+        load->latencies[i] = nowNanoseconds() - start;
+        if (status != PROTOCOL_OK)
+            load->nFailures++;
+        free(response);
+    }
+    if (fd >= 0)
+        close(fd);
+    return NULL;
+}
+
+static int compareLatencies(const void *a, const void *b) {
+    uint64_t first = *(const uint64_t *) a, second = *(const uint64_t *) b;
+    return (first > second) - (first < second);
+}
+
+/**
+ * Returns the given percentile of the given sorted latencies (in microseconds).
+ */
+static double percentile(const uint64_t *latencies, size_t size, double percent) {
+    size_t index = (size_t) (percent / 100.0 * (double) (size - 1) + 0.5);
+    return (double) latencies[index] / 1000.0;
+}
+
+/**
+ * A load generator for the playfair server: it opens the given amount of concurrent connections,
+ * each of them sending the given amount of encode requests with a random payload of the given size,
+ * and reports the throughput and the latency percentiles of the requests.
+ *
+ * Syntax: playfair_loadgen <socket> <keyid> [<connections> [<requests> [<payloadsize>]]]
+ */
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 6) {
+        fprintf(stderr, "Syntax: %s <socket> <keyid> [<connections> [<requests> [<payloadsize>]]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    size_t nConnections = argc > 3 ? strtoul(argv[3], NULL, 10) : 4;
+    size_t nRequests = argc > 4 ? strtoul(argv[4], NULL, 10) : 10000;
+    uint32_t payloadSize = argc > 5 ? (uint32_t) strtoul(argv[5], NULL, 10) : 256;
+    if (nConnections == 0 || nRequests == 0 || payloadSize > PROTOCOL_MAX_PAYLOAD) {
+        fprintf(stderr, "ERROR: invalid load parameters\n");
+        return EXIT_FAILURE;
+    }
+
+    char *payload = malloc(payloadSize + 1);
+    uint64_t *latencies = calloc(nConnections * nRequests, sizeof(uint64_t));
+    CONNECTION_LOAD *loads = calloc(nConnections, sizeof(CONNECTION_LOAD));
+    pthread_t *threads = calloc(nConnections, sizeof(pthread_t));
+    if (payload == NULL || latencies == NULL || loads == NULL || threads == NULL) {
+        fprintf(stderr, "ERROR: The memory allocation has failed\n");
+        return EXIT_FAILURE;
+    }
+    srand(42);
+    for (uint32_t i = 0; i < payloadSize; i++)
+        payload[i] = (char) ('a' + rand() % 26);
+
+    uint64_t start = nowNanoseconds();
+    for (size_t i = 0; i < nConnections; i++) {
+        loads[i] = (CONNECTION_LOAD) {argv[1], argv[2], payload, payloadSize, nRequests,
+                                      latencies + i * nRequests, 0};
+        pthread_create(&threads[i], NULL, runConnection, &loads[i]);
+    }
+    size_t nFailures = 0;
+    for (size_t i = 0; i < nConnections; i++) {
+        pthread_join(threads[i], NULL);
+        nFailures += loads[i].nFailures;
+    }
+    double seconds = (double) (nowNanoseconds() - start) / 1e9;
+
+    size_t nTotal = nConnections * nRequests;
+    qsort(latencies, nTotal, sizeof(uint64_t), compareLatencies);
+    printf("requests:   %zu (%zu failed) over %zu connections\n", nTotal, nFailures, nConnections);
+    printf("throughput: %.0f req/s, %.2f MB/s\n", (double) nTotal / seconds,
+           (double) nTotal * payloadSize / seconds / 1e6);
+    printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           percentile(latencies, nTotal, 50), percentile(latencies, nTotal, 90),
+           percentile(latencies, nTotal, 99), percentile(latencies, nTotal, 99.9),
+           (double) latencies[nTotal - 1] / 1000.0);
+
+    free(payload);
+    free(latencies);
+    free(loads);
+    free(threads);
+    return nFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
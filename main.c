@@ -4,6 +4,17 @@
 #include "matrixManager.h"
 #include "fileManager.h"
 #include "starter.h"
+#include "serverManager.h"
+#include "watchManager.h"
+#include "verifyManager.h"
+#include "integrityManager.h"
+#include "searchManager.h"
+#include "indexManager.h"
+#include "crackManager.h"
+#include "cribManager.h"
+#include "dictManager.h"
+#include "statsManager.h"
+#include "optionManager.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -23,7 +34,39 @@ const char *getConsoleClearCommand() {
 #endif
 }
 
+/**
+ * Checks whether the given command processes a batch of files with @startPlayfair().
+ *
+ * @return 1 if the command is "encode", "decode" or "rekey", 0 otherwise
+ */
+int isBatchCommand(const char *command) {
+    return strcmp(command, "encode") == 0 || strcmp(command, "decode") == 0 || strcmp(command, "rekey") == 0;
+}
+
 int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "serve") == 0)
+        return startServer(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "watch") == 0)
+        return startWatcher(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "verify") == 0)
+        return startVerifier(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "check") == 0)
+        return startChecker(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "grep") == 0)
+        return startSearcher(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "index") == 0)
+        return startIndexer(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "crack") == 0)
+        return startCracker(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "crib") == 0)
+        return startCribber(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "dict") == 0)
+        return startDictionary(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "stats") == 0)
+        return startStatistics(argc, argv);
+    if (argc >= 2 && isBatchCommand(argv[1]) && isHeadlessRun(argc, argv))
+        return startPlayfair(argc, argv);
+
     system(getConsoleClearCommand());
     printTitle();
 
@@ -39,10 +82,10 @@ int main(int argc, char **argv) {
                 printVersion();
             else printUnknownCommand(argv[1]);
         default:
-            if (strcmp(argv[1], "encode") != 0 && strcmp(argv[1], "decode") != 0)
+            if (!isBatchCommand(argv[1]))
                 printUnknownCommand(argv[1]);
             else
-                startPlayfair(argc, argv);
+                return startPlayfair(argc, argv);
             break;
     }
     return 0;
@@ -3,10 +3,16 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "utils.h"
 #include "matrixManager.h"
 
+/**
+ * The bit of an uppercase letter in a mask of the letters already inserted in a matrix.
+ */
+#define LETTER_BIT(c) (1u << ((c) - 'A'))
+
 /**
  * Allocates a new matrix and returns it.
  * If the allocation fails, an error occurs and the program ends.
@@ -15,11 +21,7 @@
  * @return the new matrix allocated
  */
 char **matrixMalloc(size_t dimension) {
-    char **matrix = (char **) malloc(dimension * sizeof(char *));
-    if (matrix == NULL) {
-        fprintf(stderr, "\nERROR: The matrix memory allocation has failed\n\n");
-        exit(EXIT_FAILURE);
-    }
+    char **matrix = (char **) memoryMalloc(dimension * sizeof(char *));
     for (int row = 0; row < dimension; row++) {
         matrix[row] = stringMalloc(dimension);
     }
@@ -35,10 +37,23 @@ char **matrixMalloc(size_t dimension) {
  */
 MATRIX createMatrix(KEYFILE keyfile) {
     MATRIX matrix;
-    fillMatrix(&matrix, getMatrixText(keyfile));
+    char *matrixText = getMatrixText(keyfile);
+    fillMatrix(&matrix, matrixText);
+    free(matrixText);
     return matrix;
 }
 
+/**
+ * Frees the rows of the given MATRIX and the MATRIX itself.
+ *
+ * @param matrix - the MATRIX to free
+ */
+void freeMatrix(MATRIX matrix) {
+    for (int row = 0; row < 5; row++)
+        free(matrix.matrix[row]);
+    free(matrix.matrix);
+}
+
 /**
  * Fills the given matrix with the given text.
  *
@@ -62,25 +77,29 @@ void fillMatrix(MATRIX *matrix, const char *matrixText) {
  * that will be used to fill the matrix.
  * It is created by inserting all the char of the @key attribute of the keyFile without repeating
  * the same letters and then adding the remaining letters of the @alphabet of the keyFile that
- * haven't been inserted yet.
+ * haven't been inserted yet (the inserted letters are tracked with a bitmask).
  *
  * @param keyFile - the keyFile whose attributes are required for the composition of the text
  * @param matrixDim - the dimension (nRows = nColumns) of the matrix to fill
  * @return the text to fill the matrix
  */
 char *getMatrixText(KEYFILE keyFile) {
-    char *matrixtext = calloc(26, sizeof(char));
+    char *matrixtext = stringCalloc(26);
+    uint32_t inserted = 0;
     int pos = 0;
 
     while (*keyFile.key != '\0') {
-        if (isalpha(*keyFile.key) != 0)
-            if (strchr(matrixtext, *keyFile.key) == NULL)
-                matrixtext[pos++] = *keyFile.key;
+        if (isalpha(*keyFile.key) != 0 && (inserted & LETTER_BIT(*keyFile.key)) == 0) {
+            inserted |= LETTER_BIT(*keyFile.key);
+            matrixtext[pos++] = *keyFile.key;
+        }
         keyFile.key++;
     }
     while (*keyFile.alphabet != '\0') {
-        if (strchr(matrixtext, *keyFile.alphabet) == NULL)
+        if ((inserted & LETTER_BIT(*keyFile.alphabet)) == 0) {
+            inserted |= LETTER_BIT(*keyFile.alphabet);
             matrixtext[pos++] = *keyFile.alphabet;
+        }
         keyFile.alphabet++;
     }
     matrixtext[pos] = '\0';
@@ -12,6 +12,8 @@ char **matrixMalloc(size_t dimension);
 
 MATRIX createMatrix(KEYFILE keyfile);
 
+void freeMatrix(MATRIX matrix);
+
 void fillMatrix(MATRIX *matrix, const char *matrixText);
 
 char *getMatrixText(KEYFILE keyFile);
@@ -0,0 +1,107 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "ngramManager.h"
+#include "utils.h"
+
+/**
+ * Counts the quadgrams listed in the given file, whose lines have the format "TION 13168375",
+ * adding every count to the given array.
+ *
+ * @return 0 if every non-empty line has that format, -1 otherwise
+ */
+static int readQuadgramList(FILE *file, double *counts) {
+    char line[256], letters[8];
+    double count;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char extra;
+        if (strspn(line, " \t\r\n") == strlen(line))
+            continue;
+        if (sscanf(line, "%7s %lf %c", letters, &count, &extra) != 2 || strlen(letters) != 4 || count < 0)
+            return -1;
+        unsigned char quadgram[4];
+        for (int k = 0; k < 4; k++) {
+            if (!isalpha((unsigned char) letters[k]))
+                return -1;
+            quadgram[k] = (unsigned char) (toupper((unsigned char) letters[k]) - 'A');
+        }
+        counts[getQuadgramIndex(quadgram)] += count;
+    }
+    return 0;
+}
+
+/**
+ * Counts the quadgrams of the letters of the given text file (every other character is ignored).
+ */
+static void countTextQuadgrams(FILE *file, double *counts) {
+    unsigned char window[4];
+    int c, size = 0;
+
+    while ((c = getc(file)) != EOF) {
+        if (c >= 128 || !isalpha(c))
+            continue;
+        if (size == 4)
+            memmove(window, window + 1, 3);
+        else size++;
+        window[size - 1] = (unsigned char) (toupper(c) - 'A');
+        if (size == 4)
+            counts[getQuadgramIndex(window)]++;
+    }
+}
+
+/**
+ * Loads the quadgram statistics of a language from the given file, which is either a list of
+ * quadgrams with their counts (one "TION 13168375" per line) or any plain text in the language,
+ * whose quadgrams are counted. Every quadgram gets the base-10 logarithm of its probability as
+ * score, while the quadgrams never seen get a floor score (the one of a hundredth of an occurrence),
+ * so that the score of a text is the sum of the scores of its quadgrams.
+ *
+ * @param path - the path of the file
+ * @param quadgrams - the QUADGRAMS to fill
+ * @return 0 if the statistics were loaded, -1 if the file cannot be read or contains no quadgrams
+ */
+int loadQuadgrams(const char *path, QUADGRAMS *quadgrams) {
+    FILE *file = fopen(path, "r");
+    double *counts = memoryCalloc(QUADGRAM_COUNT, sizeof(double)), total = 0;
+
+    quadgrams->scores = NULL;
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", path);
+        free(counts);
+        return -1;
+    }
+    if (readQuadgramList(file, counts) != 0) {
+        memset(counts, 0, QUADGRAM_COUNT * sizeof(double));
+        rewind(file);
+        countTextQuadgrams(file, counts);
+    }
+    fclose(file);
+
+    for (unsigned q = 0; q < QUADGRAM_COUNT; q++)
+        total += counts[q];
+    if (total == 0) {
+        fprintf(stderr, "\nERROR: the file '%s' contains no quadgrams!\n\n", path);
+        free(counts);
+        return -1;
+    }
+
+    quadgrams->scores = memoryMalloc(QUADGRAM_COUNT * sizeof(float));
+    quadgrams->floor = (float) log10(0.01 / total);
+    for (unsigned q = 0; q < QUADGRAM_COUNT; q++)
+        quadgrams->scores[q] = counts[q] > 0 ? (float) log10(counts[q] / total) : quadgrams->floor;
+    free(counts);
+    return 0;
+}
+
+/**
+ * Frees the scores of the given QUADGRAMS.
+ */
+void freeQuadgrams(QUADGRAMS *quadgrams) {
+    free(quadgrams->scores);
+    quadgrams->scores = NULL;
+}
@@ -0,0 +1,26 @@
+
+#ifndef PLAYFAIR_NGRAMMANAGER_H
+#define PLAYFAIR_NGRAMMANAGER_H
+
+/**
+ * The amount of possible quadgrams of the 26 letters.
+ */
+#define QUADGRAM_COUNT (26 * 26 * 26 * 26)
+
+typedef struct {
+    float *scores;
+    float floor;
+} QUADGRAMS;
+
+int loadQuadgrams(const char *path, QUADGRAMS *quadgrams);
+
+void freeQuadgrams(QUADGRAMS *quadgrams);
+
+/**
+ * Returns the index of the quadgram made of the given letters (0-25).
+ */
+static inline unsigned getQuadgramIndex(const unsigned char *letters) {
+    return ((letters[0] * 26u + letters[1]) * 26u + letters[2]) * 26u + letters[3];
+}
+
+#endif //PLAYFAIR_NGRAMMANAGER_H
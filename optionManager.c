@@ -0,0 +1,159 @@
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "optionManager.h"
+#include "fileManager.h"
+#include "printer.h"
+#include "rangeManager.h"
+
+/**
+ * Checks whether the given parameter is an option (it starts with "-" and it is
+ * not just "-").
+ */
+static int isOption(const char *parameter) {
+    return parameter[0] == '-' && parameter[1] != '\0';
+}
+
+/**
+ * Parses the parameters of an encode/decode command, whose syntax is:
+ * <playfair> <encode|decode> [options] <keyfile> <outputdir> <file1> ... <filen>
+ * or, for the "rekey" command:
+ * <playfair> rekey [options] <oldkeyfile> <newkeyfile> <outputdir> <file1> ... <filen>
+ * The options are all the parameters starting with "-" that follow the command
+ * (together with their values, for the options that require one).
+ * With the options "--keys" and "--keyring" the keys are selected by the options, so the
+ * <keyfile> parameter must be omitted. With "--auto", the key of every file is identified
+ * among the selected ones instead.
+ * An input file "-" is read from the standard input, and an output directory "-" writes the
+ * output of the (single) input file to the standard output, in which case nothing else is printed
+ * there. The options that need to seek the files or to write next to the output are rejected.
+ * If an option is unknown or some parameters are missing, an error is printed and
+ * the program ends.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return the parsed OPTIONS
+ */
+OPTIONS parseOptions(int argc, char **argv) {
+    OPTIONS options;
+    int i = 2;
+
+    memset(&options, 0, sizeof(options));
+    options.command = argv[1];
+    options.nJobs = 1;
+
+    for (; i < argc && isOption(argv[i]); i++) {
+        if (strcmp(argv[i], "--cache") == 0)
+            options.useCache = 1;
+        else if (strcmp(argv[i], "--resume") == 0)
+            options.resume = 1;
+        else if (strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--recursive") == 0)
+            options.recursive = 1;
+        else if (strcmp(argv[i], "--integrity") == 0)
+            options.integrity = 1;
+        else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc &&
+                 parseRange(argv[i + 1], &options.rangeStart, &options.rangeLength) == 0) {
+            options.hasRange = 1;
+            i++;
+        } else if (strcmp(argv[i], "--range-index") == 0)
+            options.rangeIndex = 1;
+        else if (strcmp(argv[i], "--stats") == 0)
+            options.showStats = 1;
+        else if (strcmp(argv[i], "--perf-counters") == 0)
+            options.showStats = options.perfCounters = 1;
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            options.tracePath = argv[++i];
+        else if (strcmp(argv[i], "--quiet") == 0)
+            options.outputMode = OUTPUT_QUIET;
+        else if (strcmp(argv[i], "--json") == 0)
+            options.outputMode = OUTPUT_JSON;
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            options.nJobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--keys") == 0 && i + 1 < argc)
+            options.keyList = argv[++i];
+        else if (strcmp(argv[i], "--keyring") == 0 && i + 1 < argc)
+            options.keyRingPath = argv[++i];
+        else if (strcmp(argv[i], "--auto") == 0)
+            options.autoKey = 1;
+        else if (strcmp(argv[i], "--expect") == 0 && i + 1 < argc)
+            options.expectedHeader = argv[++i];
+        else printUnknownOption(argv[i]);
+    }
+
+    int selectsKeys = options.keyList != NULL || options.keyRingPath != NULL;
+    int rekeys = strcmp(options.command, "rekey") == 0;
+    if (selectsKeys && (options.useCache || options.resume || options.recursive || rekeys))
+        printIncompatibleOptions(options.keyRingPath != NULL ? "--keyring" : "--keys",
+                                 options.useCache ? "--cache" : options.resume ? "--resume" :
+                                 options.recursive ? "--recursive" : "rekey");
+    if (rekeys && options.resume)
+        printIncompatibleOptions("rekey", "--resume");
+    if ((options.hasRange || options.rangeIndex) && strcmp(options.command, "decode") != 0)
+        printIncompatibleOptions(options.command, options.hasRange ? "--range" : "--range-index");
+    if (options.rangeIndex && !options.hasRange)
+        printIncompatibleOptions("--range-index", "a decoding of the whole file");
+    if (options.hasRange && (options.useCache || options.resume || options.integrity || selectsKeys))
+        printIncompatibleOptions("--range", options.useCache ? "--cache" : options.resume ? "--resume" :
+                                            options.integrity ? "--integrity" :
+                                            options.keyRingPath != NULL ? "--keyring" : "--keys");
+    if (options.autoKey && (!selectsKeys || strcmp(options.command, "decode") != 0))
+        printIncompatibleOptions("--auto", !selectsKeys ? "a single KEYFILE" : options.command);
+    if (options.expectedHeader != NULL && !options.autoKey)
+        printIncompatibleOptions("--expect", "a decoding without '--auto'");
+    if (argc - i < (selectsKeys ? 2 : rekeys ? 4 : 3))
+        printWrongNumberOfParameters(argc);
+
+    if (!selectsKeys)
+        options.keyFilePath = argv[i++];
+    if (rekeys)
+        options.newKeyFilePath = argv[i++];
+    options.outputDir = argv[i];
+    options.inputFiles = argv + i + 1;
+    options.nInputFiles = argc - i - 1;
+
+    int readsStandardInput = 0;
+    for (int f = 0; f < options.nInputFiles; f++)
+        readsStandardInput |= isStandardPath(options.inputFiles[f]);
+    if (readsStandardInput && (options.useCache || options.resume || options.hasRange || options.autoKey))
+        printIncompatibleOptions("-", options.useCache ? "--cache" : options.resume ? "--resume" :
+                                      options.hasRange ? "--range" : "--auto");
+    if (isStandardPath(options.outputDir)) {
+        if (selectsKeys || options.useCache || options.resume || options.recursive || options.integrity ||
+            options.showStats || options.outputMode == OUTPUT_JSON)
+            printIncompatibleOptions("-", selectsKeys ? (options.keyRingPath != NULL ? "--keyring" : "--keys") :
+                                          options.useCache ? "--cache" : options.resume ? "--resume" :
+                                          options.recursive ? "--recursive" : options.integrity ? "--integrity" :
+                                          options.showStats ? "--stats" : "--json");
+        if (options.nInputFiles != 1)
+            printIncompatibleOptions("-", "more than one input file");
+        options.outputMode = OUTPUT_QUIET;
+    }
+    return options;
+}
+
+/**
+ * Checks whether the given encode/decode command has to run headless (with the option
+ * "--quiet" or "--json", or writing to the standard output), in which case the console must
+ * not be cleared and no decoration must be printed.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return 1 if the command runs headless, 0 otherwise
+ */
+int isHeadlessRun(int argc, char **argv) {
+    int i = 2, selectsKeys = 0;
+
+    for (; i < argc && isOption(argv[i]); i++) {
+        if (strcmp(argv[i], "--quiet") == 0 || strcmp(argv[i], "--json") == 0)
+            return 1;
+        if (strcmp(argv[i], "--keys") == 0 || strcmp(argv[i], "--keyring") == 0)
+            selectsKeys = 1;
+        if (strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "--keys") == 0 || strcmp(argv[i], "--keyring") == 0 ||
+            strcmp(argv[i], "--range") == 0 || strcmp(argv[i], "--expect") == 0 ||
+            strcmp(argv[i], "--trace") == 0)
+            i++;
+    }
+    int outputDir = i + (selectsKeys ? 0 : strcmp(argv[1], "rekey") == 0 ? 2 : 1);
+    return outputDir < argc && isStandardPath(argv[outputDir]);
+}
@@ -0,0 +1,43 @@
+
+#ifndef PLAYFAIR_OPTIONMANAGER_H
+#define PLAYFAIR_OPTIONMANAGER_H
+
+#include <stdint.h>
+
+typedef enum {
+    OUTPUT_NORMAL,
+    OUTPUT_QUIET,
+    OUTPUT_JSON
+} OUTPUT_MODE;
+
+typedef struct {
+    char *command;
+    char *keyFilePath;
+    char *newKeyFilePath;
+    char *keyList;
+    char *keyRingPath;
+    char *expectedHeader;
+    char *tracePath;
+    char *outputDir;
+    char **inputFiles;
+    int nInputFiles;
+    int useCache;
+    int resume;
+    int recursive;
+    int integrity;
+    int hasRange;
+    uint64_t rangeStart;
+    uint64_t rangeLength;
+    int rangeIndex;
+    int autoKey;
+    int showStats;
+    int perfCounters;
+    int nJobs;
+    OUTPUT_MODE outputMode;
+} OPTIONS;
+
+OPTIONS parseOptions(int argc, char **argv);
+
+int isHeadlessRun(int argc, char **argv);
+
+#endif //PLAYFAIR_OPTIONMANAGER_H
@@ -0,0 +1,139 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfManager.h"
+
+/**
+ * The names of the hardware events, as printed in the reports.
+ */
+const char *perfEventNames[PERF_EVENTS] = {"cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"};
+
+/**
+ * Fills the attributes of the perf event of the given PERF_EVENT: only the user space of the
+ * calling thread is counted, which is allowed to unprivileged processes by the default
+ * "perf_event_paranoid" setting.
+ */
+static void getEventAttributes(PERF_EVENT event, struct perf_event_attr *attributes) {
+    static const uint64_t cacheReadMiss = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+
+    memset(attributes, 0, sizeof(*attributes));
+    attributes->size = sizeof(*attributes);
+    attributes->type = PERF_TYPE_HARDWARE;
+    attributes->read_format = PERF_FORMAT_GROUP;
+    attributes->exclude_kernel = 1;
+    attributes->exclude_hv = 1;
+    switch (event) {
+        case PERF_CYCLES:
+            attributes->config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_INSTRUCTIONS:
+            attributes->config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_BRANCH_MISSES:
+            attributes->config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PERF_L1D_MISSES:
+            attributes->type = PERF_TYPE_HW_CACHE;
+            attributes->config = PERF_COUNT_HW_CACHE_L1D | cacheReadMiss;
+            break;
+        default:
+            attributes->type = PERF_TYPE_HW_CACHE;
+            attributes->config = PERF_COUNT_HW_CACHE_LL | cacheReadMiss;
+            break;
+    }
+}
+
+/**
+ * Empties the given counters, with no events opened.
+ */
+static void resetPerfCounters(PERF_COUNTERS *counters) {
+    memset(counters, 0, sizeof(*counters));
+    for (int event = 0; event < PERF_EVENTS; event++) {
+        counters->fds[event] = -1;
+        counters->positions[event] = -1;
+    }
+}
+
+/**
+ * Opens the hardware performance counters of the calling thread as a single group led by the
+ * cycles, so that they are all read at once and cover the same instructions. The events that
+ * the CPU (or the virtual machine) does not support are left out of the group.
+ * The counters are started at once, and @markPerfCounters() has to be called to set the point
+ * from which they are counted.
+ *
+ * @param counters - the PERF_COUNTERS to open
+ * @return 0 if at least the cycles are counted, -1 if the counters are not available (no
+ * hardware counters or perf events restricted), in which case nothing is left open
+ */
+int openPerfCounters(PERF_COUNTERS *counters) {
+    struct perf_event_attr attributes;
+
+    resetPerfCounters(counters);
+    for (int event = 0; event < PERF_EVENTS; event++) {
+        getEventAttributes(event, &attributes);
+        attributes.disabled = event == PERF_CYCLES;
+        int fd = (int) syscall(SYS_perf_event_open, &attributes, 0, -1, counters->fds[PERF_CYCLES], 0);
+        if (fd < 0 && event == PERF_CYCLES)
+            return -1;
+        if (fd < 0)
+            continue;
+        counters->fds[event] = fd;
+        counters->positions[event] = counters->nOpened++;
+    }
+    if (ioctl(counters->fds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+        closePerfCounters(counters);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Reads the given counters and adds what they counted since the previous call to the given
+ * counts (one for every PERF_EVENT), so that every stage of the processing gets its own.
+ *
+ * @param counters - the opened PERF_COUNTERS
+ * @param counts - where to add the events counted since the previous call, or NULL to only set
+ * the point from which the next counts start
+ */
+void markPerfCounters(PERF_COUNTERS *counters, uint64_t *counts) {
+    uint64_t values[1 + PERF_EVENTS];
+
+    ssize_t expected = (ssize_t) ((1 + counters->nOpened) * sizeof(uint64_t));
+
+    if (counters->nOpened == 0 || read(counters->fds[PERF_CYCLES], values, sizeof(values)) < expected)
+        return;
+    for (int event = 0; event < PERF_EVENTS; event++) {
+        if (counters->positions[event] < 0)
+            continue;
+        uint64_t value = values[1 + counters->positions[event]];
+        if (counts != NULL)
+            counts[event] += value - counters->last[event];
+        counters->last[event] = value;
+    }
+}
+
+/**
+ * Returns the mask of the PERF_EVENTs counted by the given counters (bit 1 << event).
+ */
+unsigned getPerfEventMask(const PERF_COUNTERS *counters) {
+    unsigned mask = 0;
+    for (int event = 0; event < PERF_EVENTS; event++)
+        if (counters->positions[event] >= 0)
+            mask |= 1u << event;
+    return mask;
+}
+
+/**
+ * Closes the given counters.
+ */
+void closePerfCounters(PERF_COUNTERS *counters) {
+    for (int event = PERF_EVENTS - 1; event >= 0; event--)
+        if (counters->fds[event] >= 0)
+            close(counters->fds[event]);
+    resetPerfCounters(counters);
+}
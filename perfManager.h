@@ -0,0 +1,33 @@
+
+#ifndef PLAYFAIR_PERFMANAGER_H
+#define PLAYFAIR_PERFMANAGER_H
+
+#include <stdint.h>
+
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_EVENTS
+} PERF_EVENT;
+
+typedef struct {
+    int fds[PERF_EVENTS];
+    int positions[PERF_EVENTS];
+    int nOpened;
+    uint64_t last[PERF_EVENTS];
+} PERF_COUNTERS;
+
+extern const char *perfEventNames[PERF_EVENTS];
+
+int openPerfCounters(PERF_COUNTERS *counters);
+
+void markPerfCounters(PERF_COUNTERS *counters, uint64_t *counts);
+
+unsigned getPerfEventMask(const PERF_COUNTERS *counters);
+
+void closePerfCounters(PERF_COUNTERS *counters);
+
+#endif //PLAYFAIR_PERFMANAGER_H
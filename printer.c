@@ -43,6 +43,25 @@ void printMatrix(char **matrix, size_t dimension) {
     printf("\n");
 }
 
+/**
+ * Prints the given string as a JSON string (between quotes and with the special
+ * characters escaped) to the given stream.
+ *
+ * @param out - the stream to print to
+ * @param text - the string to print
+ */
+void printJsonString(FILE *out, const char *text) {
+    fputc('"', out);
+    for (; *text != '\0'; text++) {
+        if (*text == '"' || *text == '\\')
+            fprintf(out, "\\%c", *text);
+        else if ((unsigned char) *text < 0x20)
+            fprintf(out, "\\u%04x", (unsigned char) *text);
+        else fputc(*text, out);
+    }
+    fputc('"', out);
+}
+
 /**
  * Prints an error for when a wrong amount of parameters are typed.
  */
@@ -63,6 +82,26 @@ void printUnknownCommand(char *command) {
     exit(EXIT_FAILURE);
 }
 
+/**
+ * Prints an error for when an unknown option is read.
+ */
+void printUnknownOption(char *option) {
+    fprintf(stderr, "\nERROR: unknown option '%s'!\n", option);
+    printCorrectCommand();
+    printf("Alternatively, try running with flag '--help' to find out more on how\nto use this program.\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Prints an error for when two options that cannot be used together are read.
+ */
+void printIncompatibleOptions(char *first, char *second) {
+    fprintf(stderr, "\nERROR: '%s' cannot be used together with '%s'!\n", first, second);
+    printCorrectCommand();
+    printf("Alternatively, try running with flag '--help' to find out more on how\nto use this program.\n\n");
+    exit(EXIT_FAILURE);
+}
+
 /**
  * Prints a list of all the command line flags for this program.
  */
@@ -72,6 +111,49 @@ void printCommandLineFlags() {
            "Prints the info of the program.\n\n");
     printf("'--version' or '-v'\t"
            "Prints the current version of the program.\n\n");
+    printf("LIST OF ENCODING-DECODING OPTIONS:\n");
+    printf("'--cache'\t\t"
+           "Skips the files that are unchanged since\n\t\t\tthe last run on the same output directory\n\t\t\t"
+           "and processes identical files once.\n\n");
+    printf("'--resume'\t\t"
+           "Checkpoints large files while they are\n\t\t\tprocessed and continues an interrupted\n\t\t\t"
+           "run from the last checkpoint.\n\n");
+    printf("'-r' or '--recursive'\t"
+           "Encodes/decodes all the files contained in\n\t\t\tthe given directories, mirroring their tree\n\t\t\t"
+           "in the output directory.\n\n");
+    printf("'--integrity'\t\t"
+           "Writes a '.pfsum' sidecar with the CRC32C\n\t\t\tof every block of each output, to be\n\t\t\t"
+           "validated with 'check'.\n\n");
+    printf("'--range <start>:<len>'\t"
+           "Decodes only <len> bytes of the decoded\n\t\t\toutput from byte <start>, seeking to\n\t\t\t"
+           "them with the '.pfidx' index of the\n\t\t\tencoded file (built when missing).\n\n");
+    printf("'--range-index'\t\t"
+           "With '--range', rebuilds the '.pfidx'\n\t\t\tsparse index even if it is valid.\n\n");
+    printf("'--quiet'\t\t"
+           "Prints nothing but errors.\n\n");
+    printf("'--json'\t\t"
+           "Prints one JSON record per file instead\n\t\t\tof the console decoration.\n\n");
+    printf("'--stats'\t\t"
+           "Prints the counters, the time of every\n\t\t\tstage and the throughput of every file\n\t\t\t"
+           "and of the whole batch.\n\n");
+    printf("'--perf-counters'\t"
+           "Like '--stats', with the hardware events\n\t\t\t(cycles, instructions, branch and cache\n\t\t\t"
+           "misses) of every stage.\n\n");
+    printf("'--trace <file>'\t"
+           "Records the spans of the files, portions\n\t\t\tand stages of every thread and writes them\n\t\t\t"
+           "to <file> (Chrome trace format).\n\n");
+    printf("'--jobs <n>'\t\t"
+           "Processes up to <n> files in parallel.\n\n");
+    printf("'--keys <k1,...,kn>'\t"
+           "Reads every file once and writes one output\n\t\t\tper KEYFILE in <outputdir>/<k>/ (replaces\n\t\t\t"
+           "<keyfile>; with '--keyring', IDs of keys).\n\n");
+    printf("'--keyring <dir>'\t"
+           "Like '--keys', with the KEYFILEs of the\n\t\t\tgiven keyring directory.\n\n");
+    printf("'--auto'\t\t"
+           "With '--keys' or '--keyring' (decode only),\n\t\t\tdecodes every file once with the key it\n\t\t\t"
+           "was encoded with, identified among them.\n\n");
+    printf("'--expect <text>'\t"
+           "With '--auto', only identifies the keys\n\t\t\twhose plaintext begins with <text>.\n\n");
 }
 
 /**
@@ -80,7 +162,30 @@ void printCommandLineFlags() {
  */
 void printCorrectCommand() {
     printf("\nCORRECT SYNTAX FOR ENCODING-DECODING:\n");
-    printf("'<playfair> <encode|decode> <keyfile> <outputdir> <file1> ... <filen>'\n");
+    printf("'<playfair> <encode|decode> [options] <keyfile> <outputdir> <file1> ... <filen>'\n");
+    printf("\nSYNTAX FOR RE-ENCODING WITH A NEW KEY:\n");
+    printf("'<playfair> rekey [options] <oldkeyfile> <newkeyfile> <outputdir> <file1> ... <filen>'\n");
+    printf("\nSYNTAX FOR THE VERIFICATION:\n");
+    printf("'<playfair> verify [options] <keyfile> <plain1> <cipher1> ... <plainn> <ciphern>'\n");
+    printf("\nSYNTAX FOR THE INTEGRITY CHECK:\n");
+    printf("'<playfair> check [options] <file1> ... <filen>'\n");
+    printf("\nSYNTAX FOR THE SEARCH:\n");
+    printf("'<playfair> grep [options] <keyfile> <word> <file1> ... <filen>'\n");
+    printf("\nSYNTAX FOR THE SEARCH INDEX:\n");
+    printf("'<playfair> index build [options] <indexfile> <file1> ... <filen>'\n");
+    printf("'<playfair> index query [options] <keyfile> <indexfile> <word>'\n");
+    printf("\nSYNTAX FOR THE KEY RECOVERY:\n");
+    printf("'<playfair> crack --ngrams <file> [options] <cipherfile>'\n");
+    printf("\nSYNTAX FOR THE KNOWN PLAINTEXT ATTACK:\n");
+    printf("'<playfair> crib [options] <cipherfile> <crib>'\n");
+    printf("\nSYNTAX FOR THE DICTIONARY ATTACK:\n");
+    printf("'<playfair> dict --ngrams <file> [options] <cipherfile> <wordlist>'\n");
+    printf("\nSYNTAX FOR THE STATISTICS:\n");
+    printf("'<playfair> stats [options] <keyfile> <file1> ... <filen>'\n");
+    printf("\nSYNTAX FOR THE SERVER:\n");
+    printf("'<playfair> serve --socket <path> --keyring <keyringdir> [--threads <n>]'\n");
+    printf("\nSYNTAX FOR THE WATCHER:\n");
+    printf("'<playfair> watch <encode|decode> <keyfile> <inputdir> <outputdir> [--threads <n>]'\n");
     printf("\nALTERNATIVE SYNTAX:\n");
     printf("'<playfair> <flag>'\n\n");
 }
@@ -94,8 +199,16 @@ void printCommandInfo() {
     printf("<flag>\t\t\tThe command line flag to run with.\n\n");
     printf("<encode|decode>\t\tDescribes which action to\n\t\t\tperform ('encode' for encoding,\n\t\t\t'decode' for decoding).\n\n");
     printf("<keyfile>\t\tThe path of the file containing\n\t\t\tall the KeyFile attributes.\n\n");
-    printf("<outputdir>\t\tThe output directory where the\n\t\t\tencoded and decoded files\n\t\t\twill be saved.\n\n");
-    printf("<file1> ... <filen>\tAll the paths of each file\n\t\t\tto encode/decode.\n\n");
+    printf("<oldkeyfile>\t\tThe KeyFile the files to rekey\n\t\t\twere encoded with.\n\n");
+    printf("<newkeyfile>\t\tThe KeyFile the files to rekey\n\t\t\thave to be encoded with.\n\n");
+    printf("<outputdir>\t\tThe output directory where the\n\t\t\tencoded and decoded files\n\t\t\twill be saved ('-' writes the\n\t\t\t"
+           "single file to the standard output).\n\n");
+    printf("<file1> ... <filen>\tAll the paths of each file\n\t\t\tto encode/decode ('-' reads the\n\t\t\tstandard input).\n\n");
+    printf("<plain> <cipher>\tA plaintext and the ciphertext\n\t\t\tthat must decode back to it.\n\n");
+    printf("<path>\t\t\tThe path of the Unix domain socket\n\t\t\tthe server listens on.\n\n");
+    printf("<keyringdir>\t\tThe directory containing the\n\t\t\tKeyFiles of the server (the ID\n\t\t\tof a KeyFile is its file name).\n\t\t\tIt is reloaded on SIGHUP.\n\n");
+    printf("<inputdir>\t\tThe directory watched for new\n\t\t\tfiles to encode/decode.\n\n");
+    printf("<n>\t\t\tThe number of worker threads.\n\n");
 }
 
 /**
@@ -5,6 +5,7 @@
 #include "keyFileManager.h"
 #include "matrixManager.h"
 #include <stddef.h>
+#include <stdio.h>
 
 void printStructures(KEYFILE keyfile, MATRIX playfairMatrix);
 
@@ -12,10 +13,16 @@ void printKeyFile(KEYFILE keyFile);
 
 void printMatrix(char **matrix, size_t dimension);
 
+void printJsonString(FILE *out, const char *text);
+
 void printWrongNumberOfParameters(int n);
 
 void printUnknownCommand(char *command);
 
+void printUnknownOption(char *option);
+
+void printIncompatibleOptions(char *first, char *second);
+
 void printCommandLineFlags();
 
 void printCorrectCommand();
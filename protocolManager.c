@@ -0,0 +1,172 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+#include "protocolManager.h"
+
+/*
+ * Every request is framed as:  [operation:1][keyIdLength:1][payloadSize:4][keyId][payload]
+ * Every response is framed as: [status:1][payloadSize:4][payload]
+ * Sizes are sent in network byte order. On error the payload of the response is a message.
+ */
+
+/**
+ * Reads exactly @size bytes from the given file descriptor, retrying on partial reads.
+ *
+ * @param fd - the file descriptor to read from
+ * @param buffer - the buffer where to store the bytes
+ * @param size - the amount of bytes to read
+ * @return 0 if all the bytes were read, -1 on error or if the peer closed the connection
+ */
+int readFully(int fd, void *buffer, size_t size) {
+    char *position = buffer;
+    while (size > 0) {
+        ssize_t nRead = read(fd, position, size);
+        if (nRead < 0 && errno == EINTR) continue;
+        if (nRead <= 0) return -1;
+        position += nRead;
+        size -= nRead;
+    }
+    return 0;
+}
+
+/**
+ * Writes exactly @size bytes to the given file descriptor, retrying on partial writes.
+ *
+ * @param fd - the file descriptor to write to
+ * @param buffer - the bytes to write
+ * @param size - the amount of bytes to write
+ * @return 0 if all the bytes were written, -1 otherwise
+ */
+int writeFully(int fd, const void *buffer, size_t size) {
+    const char *position = buffer;
+    while (size > 0) {
+        ssize_t nWritten = write(fd, position, size);
+        if (nWritten < 0 && errno == EINTR) continue;
+        if (nWritten <= 0) return -1;
+        position += nWritten;
+        size -= nWritten;
+    }
+    return 0;
+}
+
+/**
+ * Opens a connection to the server listening on the Unix domain socket with the given path.
+ *
+ * @param socketPath - the path of the socket
+ * @return the file descriptor of the connection, or -1 if the connection failed
+ */
+int connectToServer(const char *socketPath) {
+    struct sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0) return -1;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Sends a request to encode or decode the given payload with the KEYFILE with the given ID.
+ *
+ * @param fd - the connection to the server
+ * @param operation - PROTOCOL_ENCODE or PROTOCOL_DECODE
+ * @param keyId - the ID of the KEYFILE to use
+ * @param payload - the text to encode or decode
+ * @param payloadSize - the size of the text
+ * @return 0 if the request was sent, -1 otherwise
+ */
+int sendRequest(int fd, char operation, const char *keyId, const char *payload, uint32_t payloadSize) {
+    size_t keyIdLength = strlen(keyId);
+    unsigned char header[6];
+    uint32_t size = htonl(payloadSize);
+
+    if (keyIdLength > PROTOCOL_MAX_KEY_ID) return -1;
+    header[0] = (unsigned char) operation;
+    header[1] = (unsigned char) keyIdLength;
+    memcpy(header + 2, &size, sizeof(size));
+
+    if (writeFully(fd, header, sizeof(header)) != 0 || writeFully(fd, keyId, keyIdLength) != 0)
+        return -1;
+    return writeFully(fd, payload, payloadSize);
+}
+
+/**
+ * Receives the header of the next request (the payload has to be read separately).
+ *
+ * @param fd - the connection to the client
+ * @param header - the pointer to the REQUEST_HEADER to fill
+ * @return 0 if a valid header was received, -1 otherwise
+ */
+int receiveRequestHeader(int fd, REQUEST_HEADER *header) {
+    unsigned char frame[6];
+    uint32_t size;
+
+    if (readFully(fd, frame, sizeof(frame)) != 0) return -1;
+    header->operation = (char) frame[0];
+    memcpy(&size, frame + 2, sizeof(size));
+    header->payloadSize = ntohl(size);
+
+    if (readFully(fd, header->keyId, frame[1]) != 0) return -1;
+    header->keyId[frame[1]] = '\0';
+    return 0;
+}
+
+/**
+ * Sends a response with the given status and payload.
+ *
+ * @param fd - the connection to the client
+ * @param status - PROTOCOL_OK or PROTOCOL_ERROR
+ * @param payload - the processed text, or the error message
+ * @param payloadSize - the size of the payload
+ * @return 0 if the response was sent, -1 otherwise
+ */
+int sendResponse(int fd, char status, const char *payload, uint32_t payloadSize) {
+    unsigned char header[5];
+    uint32_t size = htonl(payloadSize);
+
+    header[0] = (unsigned char) status;
+    memcpy(header + 1, &size, sizeof(size));
+    if (writeFully(fd, header, sizeof(header)) != 0) return -1;
+    return writeFully(fd, payload, payloadSize);
+}
+
+/**
+ * Receives a response from the server. The payload is allocated and has to be freed
+ * by the caller (it is also terminated with a '\0', so that error messages can be printed).
+ *
+ * @param fd - the connection to the server
+ * @param status - where to store the status of the response
+ * @param payload - where to store the pointer to the payload
+ * @param payloadSize - where to store the size of the payload
+ * @return 0 if the response was received, -1 otherwise
+ */
+int receiveResponse(int fd, char *status, char **payload, uint32_t *payloadSize) {
+    unsigned char header[5];
+    uint32_t size;
+
+    if (readFully(fd, header, sizeof(header)) != 0) return -1;
+    *status = (char) header[0];
+    memcpy(&size, header + 1, sizeof(size));
+    *payloadSize = ntohl(size);
+
+    if ((*payload = malloc(*payloadSize + 1)) == NULL) return -1;
+    if (readFully(fd, *payload, *payloadSize) != 0) {
+        free(*payload);
+        return -1;
+    }
+    (*payload)[*payloadSize] = '\0';
+    return 0;
+}
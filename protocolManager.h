@@ -0,0 +1,46 @@
+
+#ifndef PLAYFAIR_PROTOCOLMANAGER_H
+#define PLAYFAIR_PROTOCOLMANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The operations that can be requested to the server.
+ */
+#define PROTOCOL_ENCODE 'E'
+#define PROTOCOL_DECODE 'D'
+
+/**
+ * The status of a response sent by the server.
+ */
+#define PROTOCOL_OK 0
+#define PROTOCOL_ERROR 1
+
+/**
+ * The maximum length of a key ID and the maximum size of a payload accepted by the server.
+ */
+#define PROTOCOL_MAX_KEY_ID 255
+#define PROTOCOL_MAX_PAYLOAD (64 * 1024 * 1024)
+
+typedef struct {
+    char operation;
+    char keyId[PROTOCOL_MAX_KEY_ID + 1];
+    uint32_t payloadSize;
+} REQUEST_HEADER;
+
+int readFully(int fd, void *buffer, size_t size);
+
+int writeFully(int fd, const void *buffer, size_t size);
+
+int connectToServer(const char *socketPath);
+
+int sendRequest(int fd, char operation, const char *keyId, const char *payload, uint32_t payloadSize);
+
+int receiveRequestHeader(int fd, REQUEST_HEADER *header);
+
+int sendResponse(int fd, char status, const char *payload, uint32_t payloadSize);
+
+int receiveResponse(int fd, char *status, char **payload, uint32_t *payloadSize);
+
+#endif //PLAYFAIR_PROTOCOLMANAGER_H
@@ -0,0 +1,277 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+
+#include "rangeManager.h"
+#include "streamManager.h"
+#include "fileManager.h"
+#include "utils.h"
+
+/**
+ * The amount of characters read from the input file at a time.
+ */
+#define RANGE_BUFFER 500000
+
+/**
+ * The amount of input characters between two entries of a range index.
+ */
+#define RANGE_INDEX_INTERVAL (1024 * 1024)
+
+/**
+ * Parses a range written as "START:LEN", where both numbers are amounts of bytes.
+ *
+ * @param text - the text to parse
+ * @param start - where to store the first byte of the range
+ * @param length - where to store the length of the range
+ * @return 0 if the range is valid, -1 otherwise
+ */
+int parseRange(const char *text, uint64_t *start, uint64_t *length) {
+    char *end;
+
+    if (*text < '0' || *text > '9')
+        return -1;
+    *start = strtoull(text, &end, 10);
+    if (*end != ':' || end[1] < '0' || end[1] > '9')
+        return -1;
+    *length = strtoull(end + 1, &end, 10);
+    return *end == '\0' && *length > 0 ? 0 : -1;
+}
+
+/**
+ * Returns the path of the range index of the given encoded file, which is the path of the file
+ * with the addition of the ".pfidx" extension.
+ *
+ * @param filePath - the path of the encoded file
+ * @return the path of the range index
+ */
+char *getRangeIndexPath(const char *filePath) {
+    char *indexPath = stringMalloc(strlen(filePath) + 7);
+    strcpy(indexPath, filePath);
+    strcat(indexPath, ".pfidx");
+    return indexPath;
+}
+
+/**
+ * Reads the range index stored in the given file, whose format is "playfair-range-index 1",
+ * the header lines "fingerprint", "input-size", "input-mtime" and "entries", followed by one
+ * line per entry with the input offset, the amount of digraphs decoded before it and the
+ * pending letter (as a number).
+ *
+ * @param indexPath - the path of the range index
+ * @param index - the RANGE_INDEX to fill (its entries have to be freed)
+ * @return 0 if a valid range index was read, -1 otherwise
+ */
+int readRangeIndex(const char *indexPath, RANGE_INDEX *index) {
+    FILE *file = fopen(indexPath, "r");
+    int result = -1;
+
+    index->entries = NULL;
+    index->size = 0;
+    if (file == NULL)
+        return -1;
+    if (fscanf(file, "playfair-range-index 1\nfingerprint %" SCNx64 "\ninput-size %" SCNu64 "\ninput-mtime %" SCNu64
+                     "\nentries %zu", &index->fingerprint, &index->inputSize, &index->inputModificationTime,
+               &index->size) == 4 && index->size > 0 && index->size <= index->inputSize / RANGE_INDEX_INTERVAL + 1) {
+        index->entries = memoryMalloc(index->size * sizeof(RANGE_INDEX_ENTRY));
+        result = 0;
+        for (size_t i = 0; i < index->size && result == 0; i++) {
+            int pendingLetter;
+            if (fscanf(file, "%" SCNu64 " %" SCNu64 " %d", &index->entries[i].inputOffset,
+                       &index->entries[i].digraphs, &pendingLetter) != 3)
+                result = -1;
+            index->entries[i].pendingLetter = (char) pendingLetter;
+        }
+    }
+    fclose(file);
+    if (result != 0) {
+        free(index->entries);
+        index->entries = NULL;
+    }
+    return result;
+}
+
+/**
+ * Writes the given range index to the given file (through a temporary file that is then renamed).
+ *
+ * @param indexPath - the path of the range index
+ * @param index - the RANGE_INDEX to write
+ * @return 0 if the range index was written, -1 otherwise
+ */
+int writeRangeIndex(const char *indexPath, const RANGE_INDEX *index) {
+    char *tempPath = stringMalloc(strlen(indexPath) + 5);
+    int result = -1;
+
+    sprintf(tempPath, "%s.tmp", indexPath);
+    FILE *file = fopen(tempPath, "w");
+    if (file != NULL) {
+        fprintf(file, "playfair-range-index 1\nfingerprint %" PRIx64 "\ninput-size %" PRIu64 "\ninput-mtime %" PRIu64
+                      "\nentries %zu\n", index->fingerprint, index->inputSize, index->inputModificationTime, index->size);
+        for (size_t i = 0; i < index->size; i++)
+            fprintf(file, "%" PRIu64 " %" PRIu64 " %d\n", index->entries[i].inputOffset, index->entries[i].digraphs,
+                    index->entries[i].pendingLetter);
+        int failed = ferror(file);
+        failed |= fclose(file) != 0;
+        if (!failed && rename(tempPath, indexPath) == 0)
+            result = 0;
+        else remove(tempPath);
+    }
+    free(tempPath);
+    return result;
+}
+
+/**
+ * Builds the range index of the given encoded file by splitting it once into digraphs like the
+ * decoding does: every @RANGE_INDEX_INTERVAL input characters, the input offset, the amount of
+ * digraphs split so far and the pending unpaired letter are recorded, so that the decoding can
+ * later start from any entry with the same state it would have after decoding the whole file
+ * up to there (also for files that are not in the canonical "AB CD EF" layout).
+ */
+static void buildRangeIndex(FILE *file, const CIPHER_TABLE *cipherTable, RANGE_INDEX *index) {
+    char *text = stringMalloc(RANGE_INDEX_INTERVAL);
+    char *pairs = stringMalloc(SPLIT_OUTPUT_SIZE(RANGE_INDEX_INTERVAL));
+    size_t capacity = index->inputSize / RANGE_INDEX_INTERVAL + 1, nCharRead;
+    uint64_t digraphs = 0;
+    CIPHER_STREAM stream;
+
+    index->entries = memoryMalloc(capacity * sizeof(RANGE_INDEX_ENTRY));
+    index->size = 0;
+    initStream(&stream, cipherTable);
+    do {
+        index->entries[index->size].inputOffset = stream.bytesIn;
+        index->entries[index->size].digraphs = digraphs;
+        index->entries[index->size++].pendingLetter = stream.pendingLetter;
+        nCharRead = fread(text, sizeof(char), RANGE_INDEX_INTERVAL, file);
+        digraphs += splitStream(&stream, text, nCharRead, pairs);
+    } while (nCharRead == RANGE_INDEX_INTERVAL && index->size < capacity);
+    free(text);
+    free(pairs);
+}
+
+/**
+ * Decodes only a window of the given encoded file: the result is the same portion (from byte
+ * @start, @length bytes long) of the output that the decoding of the whole file would produce,
+ * but the decoding starts near the window instead of at the beginning of the file.
+ * The decoding starts from the last entry of the range index of the file before the window (see
+ * @buildRangeIndex()), which is exact for any layout of the encoded file, doubled digraphs included.
+ * If the file has no valid range index (or with @buildIndex), the index is built first, reading the
+ * whole file once, and stored next to it, so that only the first window of a file pays for it (if
+ * the index cannot be stored, a warning is printed and the window is still decoded with it).
+ * The encoded file must be seekable, while the window can be written to the standard output ("-").
+ *
+ * @param filePath - the path of the encoded file
+ * @param outputPath - the output path of the file where to write the decoded window
+ * @param cipherTable - the CIPHER_TABLE used to decode
+ * @param start - the offset of the window in the decoded output
+ * @param length - the length of the window
+ * @param buildIndex - whether the range index has to be built first
+ * @param stats - where to store the counters of the processed part of the file
+ * @return 0 if the window was decoded, -1 otherwise
+ */
+int processFileRange(char *filePath, char *outputPath, const CIPHER_TABLE *cipherTable, uint64_t start,
+                     uint64_t length, int buildIndex, FILE_STATS *stats) {
+    FILE *file = fopen(filePath, "r");
+    char *indexPath = getRangeIndexPath(filePath);
+    RANGE_INDEX_ENTRY entry = {0, 0, 0};
+    RANGE_INDEX index = {0, 0, 0, NULL, 0}, stored;
+    struct stat inputStat;
+
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", filePath);
+        free(indexPath);
+        return -1;
+    }
+    if (fstat(fileno(file), &inputStat) != 0 || inputStat.st_size == 0) {
+        fprintf(stderr, "\nERROR: the file to decode '%s' is empty!\n\n", filePath);
+        fclose(file);
+        free(indexPath);
+        return -1;
+    }
+    index.fingerprint = getCipherTableFingerprint(cipherTable);
+    index.inputSize = (uint64_t) inputStat.st_size;
+    index.inputModificationTime = (uint64_t) inputStat.st_mtim.tv_sec * 1000000000u + inputStat.st_mtim.tv_nsec;
+
+    if (!buildIndex && readRangeIndex(indexPath, &stored) == 0) {
+        if (stored.fingerprint == index.fingerprint && stored.inputSize == index.inputSize &&
+            stored.inputModificationTime == index.inputModificationTime && stored.entries != NULL)
+            index = stored;
+        else free(stored.entries);
+    }
+    if (index.entries == NULL) {
+        buildRangeIndex(file, cipherTable, &index);
+        if (writeRangeIndex(indexPath, &index) != 0)
+            fprintf(stderr, "WARNING: the range index '%s' cannot be written\n", indexPath);
+    }
+
+    size_t low = 0, high = index.size;
+    while (high - low > 1) {
+        size_t middle = (low + high) / 2;
+        uint64_t digraphs = index.entries[middle].digraphs;
+        if ((digraphs > 0 ? 3 * digraphs - 1 : 0) <= start)
+            low = middle;
+        else high = middle;
+    }
+    entry = index.entries[low];
+    free(index.entries);
+    free(indexPath);
+
+    FILE *out = openPath(outputPath, "w");
+    if (out == NULL) {
+        fprintf(stderr, "\nERROR: the output file '%s' cannot be created!\n\n", outputPath);
+        fclose(file);
+        return -1;
+    }
+
+    CIPHER_STREAM stream;
+    uint64_t position = entry.digraphs > 0 ? 3 * entry.digraphs - 1 : 0, end = start + length, written = 0;
+    char *text = stringMalloc(RANGE_BUFFER);
+    char *processedText = stringMalloc(STREAM_OUTPUT_SIZE(RANGE_BUFFER));
+    size_t nCharRead, nCharProcessed;
+    int finished = 0;
+
+    initStream(&stream, cipherTable);
+    stream.digraphs = entry.digraphs;
+    stream.pendingLetter = entry.pendingLetter;
+    if (fseeko(file, (off_t) entry.inputOffset, SEEK_SET) != 0)
+        finished = 1;
+    while (!finished && position < end) {
+        nCharRead = fread(text, sizeof(char), RANGE_BUFFER, file);
+        if (nCharRead > 0)
+            nCharProcessed = feedStream(&stream, text, nCharRead, processedText);
+        else {
+            nCharProcessed = finishStream(&stream, processedText);
+            finished = 1;
+        }
+
+        uint64_t first = position > start ? position : start;
+        uint64_t last = position + nCharProcessed < end ? position + nCharProcessed : end;
+        if (first < last) {
+            fwrite(processedText + (first - position), sizeof(char), (size_t) (last - first), out);
+            written += last - first;
+        }
+        position += nCharProcessed;
+    }
+
+    getStreamStats(&stream, stats);
+    stats->bytesOut = written;
+    stats->digraphs -= entry.digraphs;
+    free(text);
+    free(processedText);
+    int failed = ferror(file) || ferror(out);
+    failed |= closePath(out) != 0;
+    fclose(file);
+
+    if (failed) {
+        removePath(outputPath);
+        fprintf(stderr, "\nERROR: the file '%s' cannot be read or its output cannot be written!\n\n", filePath);
+        return -1;
+    }
+    if (written == 0 && start > 0) {
+        removePath(outputPath);
+        fprintf(stderr, "\nERROR: the range starts after the end of the decoded file '%s'\n\n", filePath);
+        return -1;
+    }
+    return 0;
+}
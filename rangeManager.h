@@ -0,0 +1,34 @@
+
+#ifndef PLAYFAIR_RANGEMANAGER_H
+#define PLAYFAIR_RANGEMANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cipherManager.h"
+
+typedef struct {
+    uint64_t inputOffset;
+    uint64_t digraphs;
+    char pendingLetter;
+} RANGE_INDEX_ENTRY;
+
+typedef struct {
+    uint64_t fingerprint;
+    uint64_t inputSize;
+    uint64_t inputModificationTime;
+    RANGE_INDEX_ENTRY *entries;
+    size_t size;
+} RANGE_INDEX;
+
+int parseRange(const char *text, uint64_t *start, uint64_t *length);
+
+char *getRangeIndexPath(const char *filePath);
+
+int readRangeIndex(const char *indexPath, RANGE_INDEX *index);
+
+int writeRangeIndex(const char *indexPath, const RANGE_INDEX *index);
+
+int processFileRange(char *filePath, char *outputPath, const CIPHER_TABLE *cipherTable, uint64_t start,
+                     uint64_t length, int buildIndex, FILE_STATS *stats);
+
+#endif //PLAYFAIR_RANGEMANAGER_H
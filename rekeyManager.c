@@ -0,0 +1,271 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "rekeyManager.h"
+#include "fileManager.h"
+#include "utils.h"
+
+/**
+ * The default amount of characters to read from the file at a time (if possible).
+ */
+#define REKEY_BUFFER 500000
+
+/**
+ * Creates the REKEY_TABLE that translates a text encoded with the key of @decodeTable into
+ * the same text encoded with the key of @encodeTable.
+ * For every ciphertext digraph, the table contains the digraph obtained by decoding it with
+ * the old key, normalizing the decoded letters for the new key and encoding them with the new
+ * key. This is possible only when the decoded letters are still different once normalized:
+ * otherwise the new encoding would add a special character between them, so such digraphs are
+ * marked as not composable and are processed one letter at a time.
+ *
+ * @param decodeTable - the CIPHER_TABLE decoding with the old key
+ * @param encodeTable - the CIPHER_TABLE encoding with the new key
+ * @return the new REKEY_TABLE
+ */
+REKEY_TABLE createRekeyTable(const CIPHER_TABLE *decodeTable, const CIPHER_TABLE *encodeTable) {
+    REKEY_TABLE table;
+
+    table.decodeTable = decodeTable;
+    table.encodeTable = encodeTable;
+    for (int first = 0; first < 26; first++) {
+        for (int second = 0; second < 26; second++) {
+            const char *decoded = decodeTable->digraphs[first][second];
+            char newFirst = encodeTable->letters[(unsigned char) decoded[0]];
+            char newSecond = encodeTable->letters[(unsigned char) decoded[1]];
+
+            table.composable[first][second] = newFirst != 0 && newSecond != 0 && newFirst != newSecond;
+            table.digraphs[first][second][0] = 0;
+            table.digraphs[first][second][1] = 0;
+            if (table.composable[first][second]) {
+                table.digraphs[first][second][0] = encodeTable->digraphs[newFirst - 'A'][newSecond - 'A'][0];
+                table.digraphs[first][second][1] = encodeTable->digraphs[newFirst - 'A'][newSecond - 'A'][1];
+            }
+        }
+    }
+    return table;
+}
+
+/**
+ * Returns the fingerprint of the given REKEY_TABLE, which depends on both the old and the
+ * new key (see @getCipherTableFingerprint()).
+ */
+uint64_t getRekeyTableFingerprint(const REKEY_TABLE *rekeyTable) {
+    return getCipherTableFingerprint(rekeyTable->decodeTable) * 1099511628211u ^
+           getCipherTableFingerprint(rekeyTable->encodeTable);
+}
+
+/**
+ * Initializes the given stream so that it re-encodes text with the given REKEY_TABLE.
+ *
+ * @param stream - the stream to initialize
+ * @param table - the table to use to re-encode the text
+ */
+void initRekeyStream(REKEY_STREAM *stream, const REKEY_TABLE *table) {
+    stream->table = table;
+    stream->pendingCipherLetter = 0;
+    stream->pendingLetter = 0;
+    stream->bytesIn = 0;
+    stream->letters = 0;
+    stream->digraphs = 0;
+    stream->padding = 0;
+    stream->bytesOut = 0;
+}
+
+/**
+ * Writes the given encoded digraph to @out, preceded by a blank space if it is not the first one.
+ */
+static char *writeRekeyedDigraph(REKEY_STREAM *stream, char *out, const char *digraph) {
+    if (stream->digraphs++ > 0)
+        *out++ = ' ';
+    *out++ = digraph[0];
+    *out++ = digraph[1];
+    return out;
+}
+
+/**
+ * Encodes the given decoded letter with the new key exactly like @feedStream() would, pairing
+ * it with the pending letter of the new encoding.
+ */
+static char *encodeLetter(REKEY_STREAM *stream, char *out, char decodedLetter) {
+    const CIPHER_TABLE *table = stream->table->encodeTable;
+    char letter = table->letters[(unsigned char) decodedLetter];
+
+    if (letter == 0)
+        return out;
+    if (stream->pendingLetter == 0)
+        stream->pendingLetter = letter;
+    else if (stream->pendingLetter == letter) {
+        out = writeRekeyedDigraph(stream, out, table->digraphs[letter - 'A'][table->specialCharacter - 'A']);
+        stream->padding++;
+    } else {
+        out = writeRekeyedDigraph(stream, out, table->digraphs[stream->pendingLetter - 'A'][letter - 'A']);
+        stream->pendingLetter = 0;
+    }
+    return out;
+}
+
+/**
+ * Re-encodes a ciphertext digraph, as split by the decoding with the old key: if the new encoding
+ * has no pending letter and the digraph is composable, its re-encoded version is taken from the
+ * table, otherwise its two decoded letters are encoded one at a time.
+ */
+static char *rekeyDigraph(REKEY_STREAM *stream, char *out, char first, char second) {
+    const REKEY_TABLE *table = stream->table;
+
+    if (stream->pendingLetter == 0 && table->composable[first - 'A'][second - 'A'])
+        return writeRekeyedDigraph(stream, out, table->digraphs[first - 'A'][second - 'A']);
+
+    const char *decoded = table->decodeTable->digraphs[first - 'A'][second - 'A'];
+    out = encodeLetter(stream, out, decoded[0]);
+    return encodeLetter(stream, out, decoded[1]);
+}
+
+/**
+ * Re-encodes @size characters of the given ciphertext, producing the same result of decoding
+ * them with the old key and encoding the decoded text with the new key, without the decoded
+ * text ever being stored. The ciphertext is normalized and split into digraphs like the decoding
+ * does (special characters included) and every digraph is translated with @rekeyDigraph().
+ * Unpaired letters of both stages are kept in the stream until the next call.
+ * @out must be able to contain at least REKEY_OUTPUT_SIZE(@size) characters.
+ *
+ * @param stream - the stream to feed
+ * @param in - the ciphertext characters to process
+ * @param size - the amount of characters to process
+ * @param out - the buffer where to write the re-encoded digraphs
+ * @return the amount of characters written to @out
+ */
+size_t feedRekeyStream(REKEY_STREAM *stream, const char *in, size_t size, char *out) {
+    const CIPHER_TABLE *table = stream->table->decodeTable;
+    char pending = stream->pendingCipherLetter;
+    char *start = out;
+
+    for (size_t i = 0; i < size; i++) {
+        char letter = table->letters[(unsigned char) in[i]];
+        if (letter == 0) continue;
+        stream->letters++;
+
+        if (pending == 0)
+            pending = letter;
+        else if (pending == letter) {
+            out = rekeyDigraph(stream, out, pending, table->specialCharacter);
+            stream->padding++;
+        } else {
+            out = rekeyDigraph(stream, out, pending, letter);
+            pending = 0;
+        }
+    }
+
+    stream->pendingCipherLetter = pending;
+    stream->bytesIn += size;
+    stream->bytesOut += out - start;
+    return out - start;
+}
+
+/**
+ * Ends the given stream: the unpaired letters of the decoding and then of the new encoding are
+ * completed with the respective special characters, like @finishStream() does for each stage.
+ *
+ * @param stream - the stream to finish
+ * @param out - the buffer where to write the last digraphs (at least 9 characters)
+ * @return the amount of characters written to @out
+ */
+size_t finishRekeyStream(REKEY_STREAM *stream, char *out) {
+    const REKEY_TABLE *table = stream->table;
+    char *start = out;
+
+    if (stream->pendingCipherLetter != 0) {
+        out = rekeyDigraph(stream, out, stream->pendingCipherLetter, table->decodeTable->specialCharacter);
+        stream->padding++;
+        stream->pendingCipherLetter = 0;
+    }
+    if (stream->pendingLetter != 0) {
+        const CIPHER_TABLE *encodeTable = table->encodeTable;
+        out = writeRekeyedDigraph(stream, out, encodeTable->digraphs[stream->pendingLetter - 'A']
+                                                                   [encodeTable->specialCharacter - 'A']);
+        stream->padding++;
+        stream->pendingLetter = 0;
+    }
+    stream->bytesOut += out - start;
+    return out - start;
+}
+
+/**
+ * Opens the given encoded file and re-encodes it with the given REKEY_TABLE, writing the result
+ * to the file specified by the given output path in a single pass (no decoded file is written).
+ * The errors are handled like in @processFile(): an error is printed, the partial output file
+ * is removed and -1 is returned.
+ *
+ * @param filePath - the path of the encoded file
+ * @param outputPath - the output path of the file where to write the re-encoded text
+ * @param rekeyTable - the REKEY_TABLE from the old key to the new one
+ * @param stats - where to store the counters of the processed file
+ * @param integrity - the INTEGRITY collecting the checksums of the output, or NULL
+ * @return 0 if the file was processed, -1 otherwise
+ */
+int processFileRekey(char *filePath, char *outputPath, const REKEY_TABLE *rekeyTable, FILE_STATS *stats,
+                     INTEGRITY *integrity) {
+    FILE *file = openPath(filePath, "r");
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", filePath);
+        return -1;
+    }
+
+    FILE *out = openPath(outputPath, "w");
+    if (out == NULL) {
+        fprintf(stderr, "\nERROR: the output file '%s' cannot be created!\n\n", outputPath);
+        closePath(file);
+        return -1;
+    }
+
+    struct stat inputStat;
+    size_t bufferSize = REKEY_BUFFER, nCharRead, nCharProcessed;
+    if (fstat(fileno(file), &inputStat) == 0 && S_ISREG(inputStat.st_mode) && inputStat.st_size < REKEY_BUFFER)
+        bufferSize = (size_t) inputStat.st_size + 1;
+
+    char *text = stringMalloc(bufferSize);
+    char *processedText = stringMalloc(REKEY_OUTPUT_SIZE(bufferSize));
+    REKEY_STREAM stream;
+
+    initRekeyStream(&stream, rekeyTable);
+    while ((nCharRead = fread(text, sizeof(char), bufferSize, file)) > 0) {
+        nCharProcessed = feedRekeyStream(&stream, text, nCharRead, processedText);
+        fwrite(processedText, sizeof(char), nCharProcessed, out);
+        if (integrity != NULL)
+            updateIntegrity(integrity, processedText, nCharProcessed);
+    }
+    nCharProcessed = finishRekeyStream(&stream, processedText);
+    fwrite(processedText, sizeof(char), nCharProcessed, out);
+    if (integrity != NULL)
+        updateIntegrity(integrity, processedText, nCharProcessed);
+    free(text);
+    free(processedText);
+
+    stats->bytesIn = stream.bytesIn;
+    stats->bytesOut = stream.bytesOut;
+    stats->letters = stream.letters;
+    stats->digraphs = stream.digraphs;
+    stats->padding = stream.padding;
+    int failed = ferror(file) || ferror(out);
+    failed |= closePath(out) != 0;
+    closePath(file);
+
+    if (failed) {
+        removePath(outputPath);
+        fprintf(stderr, "\nERROR: the file '%s' cannot be read or its output cannot be written!\n\n", filePath);
+        return -1;
+    }
+    if (stream.bytesIn == 0) {
+        removePath(outputPath);
+        fprintf(stderr, "\nERROR: the file to rekey '%s' is empty!\n\n", filePath);
+        return -1;
+    }
+    if (stream.letters == 0) {
+        removePath(outputPath);
+        fprintf(stderr, "\nERROR: no valid text can be read from the specified file '%s'\n\n", filePath);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+
+#ifndef PLAYFAIR_REKEYMANAGER_H
+#define PLAYFAIR_REKEYMANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cipherManager.h"
+#include "integrityManager.h"
+
+/**
+ * The maximum amount of output characters produced by feeding @n ciphertext characters to
+ * a REKEY_STREAM (plus the final digraphs written when the stream is finished): every letter
+ * can complete a ciphertext digraph whose two decoded letters complete a new digraph each.
+ */
+#define REKEY_OUTPUT_SIZE(n) (6 * (n) + 9)
+
+typedef struct {
+    const CIPHER_TABLE *decodeTable;
+    const CIPHER_TABLE *encodeTable;
+    char digraphs[26][26][2];
+    char composable[26][26];
+} REKEY_TABLE;
+
+typedef struct {
+    const REKEY_TABLE *table;
+    char pendingCipherLetter;
+    char pendingLetter;
+    size_t bytesIn;
+    size_t letters;
+    size_t digraphs;
+    size_t padding;
+    size_t bytesOut;
+} REKEY_STREAM;
+
+REKEY_TABLE createRekeyTable(const CIPHER_TABLE *decodeTable, const CIPHER_TABLE *encodeTable);
+
+uint64_t getRekeyTableFingerprint(const REKEY_TABLE *rekeyTable);
+
+void initRekeyStream(REKEY_STREAM *stream, const REKEY_TABLE *table);
+
+size_t feedRekeyStream(REKEY_STREAM *stream, const char *in, size_t size, char *out);
+
+size_t finishRekeyStream(REKEY_STREAM *stream, char *out);
+
+int processFileRekey(char *filePath, char *outputPath, const REKEY_TABLE *rekeyTable, FILE_STATS *stats,
+                     INTEGRITY *integrity);
+
+#endif //PLAYFAIR_REKEYMANAGER_H
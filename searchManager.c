@@ -0,0 +1,392 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "searchManager.h"
+#include "keyFileManager.h"
+#include "matrixManager.h"
+#include "cipherManager.h"
+#include "threadPool.h"
+#include "printer.h"
+#include "optionManager.h"
+#include "utils.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SEARCH_SIMD
+#endif
+
+/**
+ * The amount of characters read from each file at a time.
+ */
+#define SEARCH_BUFFER (1024 * 1024)
+
+/**
+ * Compiles the given normalized word into the ciphertext it is encoded to when its first letter
+ * is the first (@alignment 0) or the second (@alignment 1) letter of a digraph.
+ * From the first letter that starts a digraph, the word is split into digraphs with the same rules
+ * of the encoding (a special character between doubles) and every complete digraph is encoded and
+ * written in the layout of the encoded files ("AB CD EF"). The letters that fall in the digraphs
+ * shared with the surrounding text are kept apart: the first letter for @alignment 1 (@lead) and a
+ * possible unpaired last letter (@trail), which are checked by decoding the neighbouring digraphs.
+ *
+ * @param encodeTable - the table used to encode the word
+ * @param letters - the normalized letters of the word
+ * @param nLetters - the amount of letters
+ * @param alignment - the position of the first letter in its digraph
+ * @param pattern - the SEARCH_PATTERN to fill
+ */
+static void compilePattern(const CIPHER_TABLE *encodeTable, const char *letters, size_t nLetters, int alignment,
+                           SEARCH_PATTERN *pattern) {
+    char pending = 0;
+
+    pattern->text = stringMalloc(3 * nLetters + 1);
+    pattern->nDigraphs = 0;
+    pattern->alignment = alignment;
+    pattern->lead = alignment == 1 ? letters[0] : 0;
+    for (size_t i = alignment; i < nLetters; i++) {
+        char first = pending, second = letters[i];
+        if (pending == 0) {
+            pending = letters[i];
+            continue;
+        }
+        if (pending == letters[i])
+            second = encodeTable->specialCharacter;
+        else pending = 0;
+
+        const char *encoded = encodeTable->digraphs[first - 'A'][second - 'A'];
+        char *out = pattern->text;
+        if (pattern->nDigraphs++ > 0) {
+            out += 3 * pattern->nDigraphs - 4;
+            *out++ = ' ';
+        }
+        out[0] = encoded[0];
+        out[1] = encoded[1];
+    }
+    pattern->trail = pending;
+    pattern->length = pattern->nDigraphs > 0 ? 3 * pattern->nDigraphs - 1 : 0;
+}
+
+/**
+ * Prepares the search of the given word: the word is normalized and compiled into its ciphertext
+ * at both the alignments it can have in the digraphs (see @compilePattern()). If the word contains
+ * no letters of the alphabet, an error is printed and the program ends.
+ *
+ * @param searcher - the SEARCHER to initialize (its output mode is kept)
+ * @param encodeTable - the table used to encode the word
+ * @param decodeTable - the table used to decode the neighbouring digraphs of the hits
+ * @param word - the word to search
+ */
+void initSearcher(SEARCHER *searcher, const CIPHER_TABLE *encodeTable, const CIPHER_TABLE *decodeTable,
+                  const char *word) {
+    char *letters = stringMalloc(strlen(word) + 1);
+    size_t nLetters = 0;
+
+    for (const char *c = word; *c != '\0'; c++)
+        if (encodeTable->letters[(unsigned char) *c] != 0)
+            letters[nLetters++] = encodeTable->letters[(unsigned char) *c];
+    if (nLetters == 0) {
+        fprintf(stderr, "\nERROR: the word '%s' contains no letters of the alphabet!\n\n", word);
+        exit(EXIT_FAILURE);
+    }
+    searcher->margin = 0;
+    for (int a = 0; a < 2; a++) {
+        compilePattern(encodeTable, letters, nLetters, a, &searcher->patterns[a]);
+        if (3 * searcher->patterns[a].nDigraphs + 2 > searcher->margin)
+            searcher->margin = 3 * searcher->patterns[a].nDigraphs + 2;
+    }
+    searcher->decodeTable = decodeTable;
+    free(letters);
+}
+
+/**
+ * Frees the compiled patterns of the given SEARCHER.
+ */
+void freeSearcher(SEARCHER *searcher) {
+    for (int a = 0; a < 2; a++)
+        free(searcher->patterns[a].text);
+}
+
+/**
+ * Decodes the digraph of the ciphertext starting at the given position.
+ *
+ * @return the decoded digraph, or NULL if the characters are not letters of the alphabet
+ */
+static const char *decodeDigraphAt(const CIPHER_TABLE *decodeTable, const char *text) {
+    char first = decodeTable->letters[(unsigned char) text[0]];
+    char second = decodeTable->letters[(unsigned char) text[1]];
+    return first != 0 && second != 0 ? decodeTable->digraphs[first - 'A'][second - 'A'] : NULL;
+}
+
+/**
+ * Records a hit of the searched word at the given offset of the decoded text.
+ *
+ * @param job - the SEARCH_JOB of the file containing the hit
+ * @param offset - the offset of the first letter of the word in the decoded file
+ */
+void addSearchHit(SEARCH_JOB *job, uint64_t offset) {
+    if (job->nOffsets == job->capacity) {
+        job->capacity = job->capacity == 0 ? 16 : 2 * job->capacity;
+        job->offsets = memoryRealloc(job->offsets, job->capacity * sizeof(uint64_t));
+    }
+    job->offsets[job->nOffsets++] = offset;
+}
+
+/**
+ * Checks whether the given pattern occurs at position @p of the given portion of an encoded file:
+ * its encoded digraphs are compared and the letters of the word shared with the neighbouring
+ * digraphs are checked by decoding them.
+ *
+ * @param searcher - the SEARCHER the pattern belongs to
+ * @param pattern - the SEARCH_PATTERN to check
+ * @param buffer - the portion of the encoded file, which should contain the digraph before @p too
+ * @param size - the size of the portion
+ * @param p - the position in the portion where the encoded digraphs of the pattern should start
+ * @param base - the offset of the portion in the file
+ * @return 1 if the word occurs at @p, 0 otherwise
+ */
+int isSearchHit(const SEARCHER *searcher, const SEARCH_PATTERN *pattern, const char *buffer, size_t size, size_t p,
+                uint64_t base) {
+    const char *decoded;
+
+    // a word of a single letter at alignment 1 has no encoded digraph: @p follows the digraph of
+    // its letter and is size + 1 when that digraph ends the file
+    if (p + pattern->length > size + (pattern->length == 0) || memcmp(buffer + p, pattern->text, pattern->length) != 0)
+        return 0;
+    if (pattern->lead != 0) {
+        if (base + p < 3 || p < 3)
+            return 0;
+        decoded = decodeDigraphAt(searcher->decodeTable, buffer + p - 3);
+        if (decoded == NULL || decoded[1] != pattern->lead)
+            return 0;
+    }
+    if (pattern->trail != 0) {
+        size_t next = p + 3 * pattern->nDigraphs;
+        if (next + 2 > size)
+            return 0;
+        decoded = decodeDigraphAt(searcher->decodeTable, buffer + next);
+        if (decoded == NULL || decoded[0] != pattern->trail)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Records the candidate of the given pattern at position @p of the buffer if it is a hit, at the
+ * offset of the first letter of the word in the decoded text.
+ */
+static void checkCandidate(SEARCH_JOB *job, const SEARCH_PATTERN *pattern, const char *buffer, size_t size,
+                           size_t p, uint64_t base) {
+    if (isSearchHit(job->searcher, pattern, buffer, size, p, base))
+        addSearchHit(job, base + p - (pattern->alignment == 1 ? 2 : 0));
+}
+
+/**
+ * Scans the positions [@from, @to) of the buffer for the given pattern. Only the positions of the
+ * digraphs (multiples of 3 from the beginning of the file) are candidates: they are filtered by
+ * comparing the first and the last character of the pattern with 16 positions at a time (with the
+ * SSE2 instructions, when available), and only the surviving ones are compared in full.
+ */
+static void scanPattern(SEARCH_JOB *job, const SEARCH_PATTERN *pattern, const char *buffer, size_t size,
+                        size_t from, size_t to, uint64_t base) {
+    size_t p = from;
+
+    if (pattern->nDigraphs == 0) {
+        // at the end of the file, a word made of its last letter follows the last digraph
+        if (pattern->trail == 0 && to == size)
+            to = size + 2;
+        for (p += (3 - (base + p) % 3) % 3; p < to; p += 3)
+            checkCandidate(job, pattern, buffer, size, p, base);
+        return;
+    }
+    if (pattern->length > size)
+        return;
+    if (to + pattern->length > size + 1)
+        to = size + 1 - pattern->length;
+#ifdef SEARCH_SIMD
+    const __m128i first = _mm_set1_epi8(pattern->text[0]);
+    const __m128i last = _mm_set1_epi8(pattern->text[pattern->length - 1]);
+    static const unsigned alignmentMasks[3] = {0x9249, 0x2492, 0x4924};
+
+    for (; p + 16 <= to; p += 16) {
+        __m128i firstBlock = _mm_loadu_si128((const __m128i *) (buffer + p));
+        __m128i lastBlock = _mm_loadu_si128((const __m128i *) (buffer + p + pattern->length - 1));
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstBlock, first),
+                                                                   _mm_cmpeq_epi8(lastBlock, last)));
+        mask &= alignmentMasks[(3 - (base + p) % 3) % 3];
+        while (mask != 0) {
+            checkCandidate(job, pattern, buffer, size, p + __builtin_ctz(mask), base);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (p += (3 - (base + p) % 3) % 3; p < to; p += 3)
+        if (buffer[p] == pattern->text[0] && buffer[p + pattern->length - 1] == pattern->text[pattern->length - 1])
+            checkCandidate(job, pattern, buffer, size, p, base);
+}
+
+/**
+ * Compares two offsets, for qsort.
+ */
+static int compareOffsets(const void *first, const void *second) {
+    uint64_t a = *(const uint64_t *) first, b = *(const uint64_t *) second;
+    return a < b ? -1 : a > b;
+}
+
+/**
+ * Prints the result of the given search, depending on the output mode: every hit as
+ * "<file>:<offset>" or a JSON record with all the offsets.
+ *
+ * @param job - the completed SEARCH_JOB
+ */
+void printSearchJob(SEARCH_JOB *job) {
+    static const char *statusNames[] = {"found", "not_found", "failed"};
+
+    if (job->searcher->output == OUTPUT_QUIET)
+        return;
+    flockfile(stdout);
+    if (job->searcher->output == OUTPUT_JSON) {
+        printf("{\"index\":%d,\"file\":", job->index + 1);
+        printJsonString(stdout, job->path);
+        printf(",\"status\":\"%s\",\"hits\":%zu,\"offsets\":[", statusNames[job->status], job->nOffsets);
+        for (size_t i = 0; i < job->nOffsets; i++)
+            printf(i > 0 ? ",%llu" : "%llu", (unsigned long long) job->offsets[i]);
+        printf("]}\n");
+    } else {
+        for (size_t i = 0; i < job->nOffsets; i++)
+            printf("%s:%llu\n", job->path, (unsigned long long) job->offsets[i]);
+    }
+    funlockfile(stdout);
+}
+
+/**
+ * Searches the word in the given encoded file without decoding it: the file is read
+ * @SEARCH_BUFFER characters at a time and scanned for the ciphertext of the word at both its
+ * alignments (see @compilePattern()). The last characters of every portion, which could belong
+ * to a hit continuing in the next portion, are kept and scanned together with the next one.
+ * The offsets of the hits refer to the decoded text and are sorted.
+ *
+ * @param job - the SEARCH_JOB describing the file, whose status and hits are filled
+ */
+void searchFile(SEARCH_JOB *job) {
+    const SEARCHER *searcher = job->searcher;
+    FILE *file = fopen(job->path, "r");
+    size_t capacity = SEARCH_BUFFER + searcher->margin + 3, size = 0, next = 0, nCharRead;
+    uint64_t base = 0;
+    int finished = 0;
+
+    if (file == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", job->path);
+        job->status = SEARCH_FAILED;
+        return;
+    }
+
+    char *buffer = stringMalloc(capacity);
+    while (!finished) {
+        nCharRead = fread(buffer + size, sizeof(char), capacity - size, file);
+        size += nCharRead;
+        finished = size < capacity;
+
+        size_t limit = finished ? size : size - searcher->margin;
+        for (int a = 0; a < 2; a++)
+            scanPattern(job, &searcher->patterns[a], buffer, size, next, limit, base);
+        next = limit;
+
+        size_t keep = next >= 3 ? next - 3 : 0;
+        memmove(buffer, buffer + keep, size - keep);
+        base += keep;
+        size -= keep;
+        next -= keep;
+    }
+
+    job->status = ferror(file) ? SEARCH_FAILED : job->nOffsets > 0 ? SEARCH_FOUND : SEARCH_NOT_FOUND;
+    fclose(file);
+    free(buffer);
+    qsort(job->offsets, job->nOffsets, sizeof(uint64_t), compareOffsets);
+}
+
+/**
+ * Searches and prints the hits of the given SEARCH_JOB, as a task of the thread pool.
+ */
+static void runSearchJob(void *argument) {
+    searchFile(argument);
+    printSearchJob(argument);
+}
+
+/**
+ * Prints the correct syntax of the grep command and ends the program.
+ */
+static void printSearchUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE SEARCH:\n");
+    fprintf(stderr, "'<playfair> grep [--jobs <n>] [--quiet|--json] <keyfile> <word> <file1> ... <filen>'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Searches a word in encoded files without decoding them: the word is normalized and compiled
+ * with the given KEYFILE into its ciphertext at both the alignments it can have in the digraphs
+ * (see @compilePattern()), and the files are scanned for it (see @runSearchJob()).
+ * Every hit is printed as "<file>:<offset>", where the offset is the one of the first letter of the
+ * word in the decoded file (which can be passed to "decode --range"). The files must be in the layout
+ * written by the encoding, and a doubled digraph (the encoding of a doubled special character) or
+ * a double between the word and the text before it can hide a hit.
+ * With the option "--jobs", multiple files are searched in parallel. With the option "--quiet"
+ * nothing is printed, while with "--json" one JSON record is printed for every file.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if the word was found in any file and no file failed, EXIT_FAILURE otherwise
+ */
+int startSearcher(int argc, char **argv) {
+    SEARCHER searcher;
+    size_t nJobs = 1;
+    int i = 2, nFound = 0, nFailed = 0;
+
+    searcher.output = OUTPUT_NORMAL;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            nJobs = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--quiet") == 0)
+            searcher.output = OUTPUT_QUIET;
+        else if (strcmp(argv[i], "--json") == 0)
+            searcher.output = OUTPUT_JSON;
+        else printSearchUsage();
+    }
+    if (argc - i < 3)
+        printSearchUsage();
+
+    KEYFILE keyFile = createKeyFileFromFile(argv[i]);
+    MATRIX playfairMatrix = createMatrix(keyFile);
+    CIPHER_TABLE encodeTable = createCipherTable(playfairMatrix, keyFile, "encode");
+    CIPHER_TABLE decodeTable = createCipherTable(playfairMatrix, keyFile, "decode");
+    initSearcher(&searcher, &encodeTable, &decodeTable, argv[i + 1]);
+
+    int nFiles = argc - i - 2;
+    SEARCH_JOB *jobs = memoryCalloc(nFiles, sizeof(SEARCH_JOB));
+    THREAD_POOL *pool = nJobs > 1 ? createThreadPool(nJobs) : NULL;
+    for (int f = 0; f < nFiles; f++) {
+        jobs[f].searcher = &searcher;
+        jobs[f].index = f;
+        jobs[f].path = argv[i + 2 + f];
+        if (pool != NULL)
+            submitTask(pool, runSearchJob, &jobs[f]);
+        else runSearchJob(&jobs[f]);
+    }
+    if (pool != NULL) {
+        waitThreadPool(pool);
+        destroyThreadPool(pool);
+    }
+
+    for (int f = 0; f < nFiles; f++) {
+        nFound += jobs[f].status == SEARCH_FOUND;
+        nFailed += jobs[f].status == SEARCH_FAILED;
+        free(jobs[f].offsets);
+    }
+    free(jobs);
+    freeSearcher(&searcher);
+    freeMatrix(playfairMatrix);
+    freeKeyFile(keyFile);
+    return nFound > 0 && nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
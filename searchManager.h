@@ -0,0 +1,58 @@
+
+#ifndef PLAYFAIR_SEARCHMANAGER_H
+#define PLAYFAIR_SEARCHMANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cipherManager.h"
+#include "optionManager.h"
+
+typedef enum {
+    SEARCH_FOUND,
+    SEARCH_NOT_FOUND,
+    SEARCH_FAILED
+} SEARCH_STATUS;
+
+typedef struct {
+    char *text;
+    size_t length;
+    size_t nDigraphs;
+    int alignment;
+    char lead;
+    char trail;
+} SEARCH_PATTERN;
+
+typedef struct {
+    SEARCH_PATTERN patterns[2];
+    size_t margin;
+    const CIPHER_TABLE *decodeTable;
+    OUTPUT_MODE output;
+} SEARCHER;
+
+typedef struct {
+    const SEARCHER *searcher;
+    int index;
+    char *path;
+    SEARCH_STATUS status;
+    uint64_t *offsets;
+    size_t nOffsets;
+    size_t capacity;
+} SEARCH_JOB;
+
+void initSearcher(SEARCHER *searcher, const CIPHER_TABLE *encodeTable, const CIPHER_TABLE *decodeTable,
+                  const char *word);
+
+void freeSearcher(SEARCHER *searcher);
+
+int isSearchHit(const SEARCHER *searcher, const SEARCH_PATTERN *pattern, const char *buffer, size_t size, size_t p,
+                uint64_t base);
+
+void addSearchHit(SEARCH_JOB *job, uint64_t offset);
+
+void searchFile(SEARCH_JOB *job);
+
+void printSearchJob(SEARCH_JOB *job);
+
+int startSearcher(int argc, char **argv);
+
+#endif //PLAYFAIR_SEARCHMANAGER_H
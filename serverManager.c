@@ -0,0 +1,307 @@
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "serverManager.h"
+#include "keyRingManager.h"
+#include "protocolManager.h"
+#include "streamManager.h"
+#include "threadPool.h"
+#include "utils.h"
+
+/**
+ * How long (in seconds) a worker waits for the rest of a request, or for the client to accept its
+ * response, before dropping the connection.
+ */
+#define REQUEST_TIMEOUT 5
+
+static KEYRING activeKeyRing;
+static pthread_rwlock_t keyRingLock = PTHREAD_RWLOCK_INITIALIZER;
+static volatile sig_atomic_t reloadRequested = 0;
+static volatile sig_atomic_t stopRequested = 0;
+
+/**
+ * Handles the signals of the server: SIGHUP requests the reload of the keyring,
+ * SIGINT and SIGTERM request the server to stop.
+ *
+ * @param signalNumber - the signal received
+ */
+static void handleSignal(int signalNumber) {
+    if (signalNumber == SIGHUP)
+        reloadRequested = 1;
+    else stopRequested = 1;
+}
+
+/**
+ * Loads the keyring from the given directory again and, if it succeeds, replaces the active
+ * keyring with it. The old keyring is freed once no request is using it anymore.
+ *
+ * @param keyRingPath - the path of the keyring directory
+ */
+static void reloadKeyRing(char *keyRingPath) {
+    KEYRING newKeyRing, oldKeyRing;
+
+    if (loadKeyRing(keyRingPath, &newKeyRing) != 0) {
+        fprintf(stderr, "WARNING: keyring reload failed, the old keyring is kept\n");
+        return;
+    }
+    pthread_rwlock_wrlock(&keyRingLock);
+    oldKeyRing = activeKeyRing;
+    activeKeyRing = newKeyRing;
+    pthread_rwlock_unlock(&keyRingLock);
+
+    freeKeyRing(&oldKeyRing);
+    printf("keyring reloaded (%zu keys)\n", newKeyRing.size);
+    fflush(stdout);
+}
+
+/**
+ * The pipe the workers give the connections back to the main thread with, once they have served
+ * one of their requests. Its write end never blocks, so that a worker drops its connection
+ * instead of waiting for a main thread that stopped reading.
+ */
+static int returnPipe[2];
+
+/**
+ * Serves one request of a client: the payload is encoded/decoded in memory with the warm
+ * CIPHER_TABLE of the requested KEYFILE, and the result is sent back in the same layout used for
+ * the output files.
+ *
+ * @param client - the connection to the client, which has data to read
+ * @return 0 if the connection can serve other requests, -1 if it must be closed (the client closed
+ * it, timed out or sent a malformed request)
+ */
+static int serveRequest(int client) {
+    REQUEST_HEADER header;
+    CIPHER_STREAM stream;
+
+    if (receiveRequestHeader(client, &header) != 0)
+        return -1;
+    if (header.operation != PROTOCOL_ENCODE && header.operation != PROTOCOL_DECODE) {
+        sendResponse(client, PROTOCOL_ERROR, "unknown operation", 17);
+        return -1;
+    }
+    if (header.payloadSize > PROTOCOL_MAX_PAYLOAD) {
+        sendResponse(client, PROTOCOL_ERROR, "payload too large", 17);
+        return -1;
+    }
+    char *payload = header.payloadSize > 0 ? stringMalloc(header.payloadSize) : NULL;
+    if (readFully(client, payload, header.payloadSize) != 0) {
+        free(payload);
+        return -1;
+    }
+
+    pthread_rwlock_rdlock(&keyRingLock);
+    KEYRING_ENTRY *entry = findKeyRingEntry(&activeKeyRing, header.keyId);
+    if (entry == NULL) {
+        pthread_rwlock_unlock(&keyRingLock);
+        free(payload);
+        return sendResponse(client, PROTOCOL_ERROR, "unknown key", 11);
+    }
+    char *output = stringMalloc(STREAM_OUTPUT_SIZE(header.payloadSize));
+    initStream(&stream, header.operation == PROTOCOL_ENCODE ? &entry->encodeTable : &entry->decodeTable);
+    size_t outputSize = feedStream(&stream, payload, header.payloadSize, output);
+    outputSize += finishStream(&stream, output + outputSize);
+    pthread_rwlock_unlock(&keyRingLock);
+
+    int result = stream.letters == 0
+                 ? sendResponse(client, PROTOCOL_ERROR, "no valid text", 13)
+                 : sendResponse(client, PROTOCOL_OK, output, (uint32_t) outputSize);
+    free(payload);
+    free(output);
+    return result;
+}
+
+/**
+ * Serves one request of a connection in a worker thread, then gives the connection back to the
+ * main thread, which waits for its next request together with all the other idle connections, or
+ * closes it.
+ *
+ * @param argument - the file descriptor of the connection
+ */
+static void handleRequest(void *argument) {
+    int client = (int) (intptr_t) argument;
+
+    if (serveRequest(client) != 0 || write(returnPipe[1], &client, sizeof(client)) != sizeof(client))
+        close(client);
+}
+
+/**
+ * Adds a file descriptor to the given set of the polled ones, growing it if needed.
+ *
+ * @param pollFds - the polled file descriptors
+ * @param nPollFds - the amount of polled file descriptors
+ * @param capacity - the capacity of @pollFds
+ * @param fd - the file descriptor to add
+ */
+static void addPollFd(struct pollfd **pollFds, size_t *nPollFds, size_t *capacity, int fd) {
+    if (*nPollFds == *capacity) {
+        *capacity *= 2;
+        *pollFds = memoryRealloc(*pollFds, *capacity * sizeof(struct pollfd));
+    }
+    (*pollFds)[*nPollFds].fd = fd;
+    (*pollFds)[*nPollFds].events = POLLIN;
+    (*pollFds)[(*nPollFds)++].revents = 0;
+}
+
+/**
+ * Creates the Unix domain socket with the given path and starts listening on it.
+ * A stale socket left by a previous server is removed first.
+ * If the socket cannot be created, an error is printed and the program ends.
+ *
+ * @param socketPath - the path of the socket
+ * @return the file descriptor of the listening socket
+ */
+static int createServerSocket(char *socketPath) {
+    struct sockaddr_un address;
+    struct stat socketStat;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "\nERROR: the socket path '%s' is too long!\n\n", socketPath);
+        exit(EXIT_FAILURE);
+    }
+    if (stat(socketPath, &socketStat) == 0 && S_ISSOCK(socketStat.st_mode))
+        unlink(socketPath);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+
+    if (fd < 0 || bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror("\nERROR: the server socket cannot be created");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+/**
+ * Prints the correct syntax of the serve command and ends the program.
+ */
+static void printServeUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE SERVER:\n");
+    fprintf(stderr, "'<playfair> serve --socket <path> --keyring <keyringdir> [--threads <n>]'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Starts the playfair server: the KEYFILEs of the keyring are loaded and their MATRIX and
+ * CIPHER_TABLEs are built once, then the server accepts connections on the Unix domain socket and
+ * waits for the requests of all the idle connections at once: every request is served by one task
+ * of a pool of worker threads, which then gives its connection back, so an idle client never holds
+ * a worker and any amount of clients can stay connected. A client that stops in the middle of a
+ * request is dropped after @REQUEST_TIMEOUT seconds.
+ * The keyring is reloaded on SIGHUP, while SIGINT and SIGTERM stop the server gracefully.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return the exit status of the program
+ */
+int startServer(int argc, char **argv) {
+    char *socketPath = NULL, *keyRingPath = NULL;
+    size_t nThreads = getDefaultThreadCount();
+    sigset_t blockedSignals, originalSignals;
+    struct sigaction action;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+            socketPath = argv[++i];
+        else if (strcmp(argv[i], "--keyring") == 0 && i + 1 < argc)
+            keyRingPath = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            nThreads = (size_t) strtoul(argv[++i], NULL, 10);
+        else printServeUsage();
+    }
+    if (socketPath == NULL || keyRingPath == NULL)
+        printServeUsage();
+
+    if (loadKeyRing(keyRingPath, &activeKeyRing) != 0)
+        exit(EXIT_FAILURE);
+
+    sigemptyset(&blockedSignals);
+    sigaddset(&blockedSignals, SIGHUP);
+    sigaddset(&blockedSignals, SIGINT);
+    sigaddset(&blockedSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blockedSignals, &originalSignals);
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleSignal;
+    sigaction(SIGHUP, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int serverFd = createServerSocket(socketPath);
+    if (pipe(returnPipe) != 0 || fcntl(returnPipe[1], F_SETFL, O_NONBLOCK) != 0) {
+        perror("\nERROR: the server pipe cannot be created");
+        exit(EXIT_FAILURE);
+    }
+    THREAD_POOL *pool = createThreadPool(nThreads);
+    printf("playfair server listening on '%s' (%zu keys, %zu threads)\n", socketPath, activeKeyRing.size,
+           pool->nThreads);
+    fflush(stdout);
+
+    size_t nPollFds = 0, capacity = 64;
+    struct pollfd *pollFds = memoryMalloc(capacity * sizeof(struct pollfd));
+    addPollFd(&pollFds, &nPollFds, &capacity, serverFd);
+    addPollFd(&pollFds, &nPollFds, &capacity, returnPipe[0]);
+
+    while (!stopRequested) {
+        int ready = ppoll(pollFds, nPollFds, NULL, &originalSignals);
+        if (reloadRequested) {
+            reloadRequested = 0;
+            reloadKeyRing(keyRingPath);
+        }
+        if (ready <= 0 || stopRequested)
+            continue;
+
+        for (size_t i = nPollFds; i-- > 2;) {
+            if (pollFds[i].revents != 0) {
+                submitTask(pool, handleRequest, (void *) (intptr_t) pollFds[i].fd);
+                pollFds[i] = pollFds[--nPollFds];
+            }
+        }
+        if (pollFds[1].revents & POLLIN) {
+            int returned[256];
+            ssize_t nRead = read(returnPipe[0], returned, sizeof(returned));
+            for (ssize_t i = 0; i < nRead / (ssize_t) sizeof(int); i++)
+                addPollFd(&pollFds, &nPollFds, &capacity, returned[i]);
+        }
+        if (pollFds[0].revents & POLLIN) {
+            struct timeval timeout = {REQUEST_TIMEOUT, 0};
+            int client = accept(serverFd, NULL, NULL);
+            if (client >= 0) {
+                setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                addPollFd(&pollFds, &nPollFds, &capacity, client);
+            }
+        }
+    }
+
+    close(serverFd);
+    unlink(socketPath);
+    for (size_t i = 2; i < nPollFds; i++)
+        close(pollFds[i].fd);
+    free(pollFds);
+    destroyThreadPool(pool);
+    close(returnPipe[1]);
+    int returned;
+    while (read(returnPipe[0], &returned, sizeof(returned)) == sizeof(returned))
+        close(returned);
+    close(returnPipe[0]);
+    freeKeyRing(&activeKeyRing);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,7 @@
+
+#ifndef PLAYFAIR_SERVERMANAGER_H
+#define PLAYFAIR_SERVERMANAGER_H
+
+int startServer(int argc, char **argv);
+
+#endif //PLAYFAIR_SERVERMANAGER_H
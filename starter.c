@@ -1,29 +1,851 @@
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include "starter.h"
 #include "keyFileManager.h"
 #include "matrixManager.h"
 #include "printer.h"
 #include "fileManager.h"
 #include "cipherManager.h"
+#include "optionManager.h"
+#include "cacheManager.h"
+#include "checkpointManager.h"
+#include "keyRingManager.h"
+#include "rekeyManager.h"
+#include "integrityManager.h"
+#include "rangeManager.h"
+#include "identifyManager.h"
+#include "threadPool.h"
+#include "traceManager.h"
+#include "utils.h"
+
+typedef enum {
+    FILE_PROCESSED,
+    FILE_SKIPPED,
+    FILE_LINKED,
+    FILE_FAILED
+} FILE_STATUS;
+
+typedef struct BATCH BATCH;
+
+typedef struct FILE_JOB {
+    BATCH *batch;
+    int index;
+    char *inputPath;
+    char *outputPath;
+    const CIPHER_TABLE *cipherTable;
+    const char *keyId;
+    struct FILE_JOB *primary;
+    struct FILE_JOB *nextKey;
+    FILE_STATUS status;
+    FILE_STATS stats;
+    int sharedInput;
+    uint64_t elapsedTime;
+} FILE_JOB;
+
+typedef struct {
+    BATCH *batch;
+    char *inputPath;
+    char *outputDir;
+} DIRECTORY_JOB;
+
+struct BATCH {
+    OPTIONS *options;
+    const CIPHER_TABLE *cipherTable;
+    const REKEY_TABLE *rekeyTable;
+    const KEYRING *keyRing;
+    uint64_t fingerprint;
+    uint64_t keyFileTime;
+    uint64_t matrixTime;
+    THREAD_POOL *pool;
+    CACHE cache;
+    pthread_mutex_t lock;
+    FILE_JOB **jobs;
+    int nJobs;
+    int capacity;
+};
+
+/**
+ * Returns the fingerprint of the key the output of the given file is written with, which is
+ * stored in its integrity sidecar.
+ */
+static uint64_t getOutputFingerprint(FILE_JOB *job) {
+    if (job->batch->rekeyTable != NULL)
+        return getCipherTableFingerprint(job->batch->rekeyTable->encodeTable);
+    return getCipherTableFingerprint(job->cipherTable);
+}
+
+/**
+ * Checks whether the output of the given file already has an integrity sidecar.
+ */
+static int hasIntegrity(FILE_JOB *job) {
+    char *integrityPath = getIntegrityPath(job->outputPath);
+    int exists = access(integrityPath, F_OK) == 0;
+    free(integrityPath);
+    return exists;
+}
+
+/**
+ * Encodes, decodes or re-encodes a single input file, recording checkpoints (and resuming
+ * from a previous one) if the option "--resume" was given, or decoding only the window selected
+ * by the option "--range".
+ * With the option "--integrity", the checksums of the output are computed while it is written
+ * (or by reading it again, if it was resumed) and stored in its sidecar.
+ *
+ * @return 0 if the file was processed, -1 otherwise
+ */
+static int processInputFile(OPTIONS *options, FILE_JOB *job) {
+    INTEGRITY integrity, *streamIntegrity =
+            options->integrity && !options->resume ? &integrity : NULL;
+    int result;
+
+    initIntegrity(&integrity);
+    if (job->batch->rekeyTable != NULL)
+        result = processFileRekey(job->inputPath, job->outputPath, job->batch->rekeyTable, &job->stats,
+                                  streamIntegrity);
+    else if (options->hasRange)
+        result = processFileRange(job->inputPath, job->outputPath, job->cipherTable, options->rangeStart,
+                                  options->rangeLength, options->rangeIndex, &job->stats);
+    else if (options->resume)
+        result = processFileResumable(job->inputPath, job->outputPath, job->cipherTable, options->command,
+                                      &job->stats);
+    else result = processFile(job->inputPath, job->outputPath, job->cipherTable, options->command, &job->stats,
+                              streamIntegrity, options->perfCounters);
+
+    if (result == 0 && streamIntegrity != NULL)
+        result = writeIntegrity(job->outputPath, streamIntegrity, job->stats.digraphs, getOutputFingerprint(job));
+    else if (result == 0 && options->integrity)
+        result = writeIntegrityFromFile(job->outputPath, getOutputFingerprint(job));
+    freeIntegrity(&integrity);
+    return result;
+}
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds.
+ */
+static uint64_t getMonotonicTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Executes the given task on the pool of the batch if the option "--jobs" was given,
+ * or immediately otherwise.
+ */
+static void scheduleTask(BATCH *batch, TASK_FUNCTION function, void *argument) {
+    if (batch->pool != NULL)
+        submitTask(batch->pool, function, argument);
+    else function(argument);
+}
+
+/**
+ * Adds a new file to the batch (the batch takes ownership of the given paths).
+ * Files can be added while other files are being processed, since the files contained
+ * in the input directories are discovered while the batch is running.
+ *
+ * @return the FILE_JOB describing the new file
+ */
+static FILE_JOB *addFileJob(BATCH *batch, char *inputPath, char *outputPath) {
+    FILE_JOB *job = memoryCalloc(1, sizeof(FILE_JOB));
+    job->batch = batch;
+    job->inputPath = inputPath;
+    job->outputPath = outputPath;
+    job->cipherTable = batch->cipherTable;
+
+    pthread_mutex_lock(&batch->lock);
+    if (batch->nJobs == batch->capacity) {
+        batch->capacity = batch->capacity == 0 ? 64 : batch->capacity * 2;
+        batch->jobs = memoryRealloc(batch->jobs, batch->capacity * sizeof(FILE_JOB *));
+    }
+    job->index = batch->nJobs;
+    batch->jobs[batch->nJobs++] = job;
+    pthread_mutex_unlock(&batch->lock);
+    return job;
+}
+
+/**
+ * Returns a copy of the given string.
+ */
+static char *copyString(const char *text) {
+    char *copy = stringMalloc(strlen(text) + 1);
+    strcpy(copy, text);
+    return copy;
+}
+
+/**
+ * Prints the given times of the stages of the processing of the files, together with the
+ * throughput of the given counters over the given time, as the fields of a JSON record or as text.
+ * If the files were not processed one stage at a time (the counters are not @staged), only the
+ * throughput is printed, since there are no stage times to report.
+ *
+ * @param stageTimes - the times of the stages (FILE_STAGES of them)
+ * @param stats - the counters of the processed files
+ * @param elapsedTime - the time the throughput refers to
+ * @param outputMode - the output mode
+ */
+static void printStageTimes(const uint64_t *stageTimes, const FILE_STATS *stats, uint64_t elapsedTime,
+                            OUTPUT_MODE outputMode) {
+    double megabytesPerSecond = elapsedTime > 0 ? (double) stats->bytesIn * 1e3 / (double) elapsedTime : 0;
+    double nsPerDigraph = stats->digraphs > 0 ? (double) elapsedTime / (double) stats->digraphs : 0;
+
+    if (!stats->staged) {
+        if (outputMode == OUTPUT_JSON)
+            printf(",\"mb_per_second\":%.1f", megabytesPerSecond);
+        else printf("%.1f MB/s\n", megabytesPerSecond);
+        return;
+    }
+    if (outputMode == OUTPUT_JSON) {
+        printf(",\"stages\":{");
+        for (int stage = 0; stage < FILE_STAGES; stage++)
+            printf("%s\"%s_ns\":%llu", stage > 0 ? "," : "", fileStageNames[stage],
+                   (unsigned long long) stageTimes[stage]);
+        printf("},\"mb_per_second\":%.1f,\"ns_per_digraph\":%.2f", megabytesPerSecond, nsPerDigraph);
+        return;
+    }
+    printf("stages:");
+    for (int stage = 0; stage < FILE_STAGES; stage++)
+        printf(" %s %.3f ms%s", fileStageNames[stage], (double) stageTimes[stage] / 1e6,
+               stage + 1 < FILE_STAGES ? "," : "\n");
+    printf("%.1f MB/s, %.2f ns/digraph\n", megabytesPerSecond, nsPerDigraph);
+}
+
+/**
+ * Prints the hardware events counted in every stage of the processing of the files, with the
+ * instructions per cycle and the misses per KB of input of every stage, as the fields of a JSON
+ * record or as text. The events that were not counted are left out.
+ *
+ * @param stageCounts - the events of every stage (FILE_STAGES of them)
+ * @param perfEvents - the mask of the events counted (bit 1 << PERF_EVENT)
+ * @param bytesIn - the size of the input of the stages
+ * @param outputMode - the output mode
+ */
+static void printStageCounts(const uint64_t (*stageCounts)[PERF_EVENTS], unsigned perfEvents, uint64_t bytesIn,
+                             OUTPUT_MODE outputMode) {
+    double kilobytes = bytesIn > 0 ? (double) bytesIn / 1024 : 1;
+
+    if (outputMode == OUTPUT_JSON)
+        printf(",\"perf\":{");
+    for (int stage = 0; stage < FILE_STAGES; stage++) {
+        const uint64_t *counts = stageCounts[stage];
+        double ipc = counts[PERF_CYCLES] > 0 ? (double) counts[PERF_INSTRUCTIONS] / (double) counts[PERF_CYCLES] : 0;
+
+        if (outputMode == OUTPUT_JSON) {
+            printf("%s\"%s\":{", stage > 0 ? "," : "", fileStageNames[stage]);
+            for (int event = 0, n = 0; event < PERF_EVENTS; event++)
+                if (perfEvents & 1u << event)
+                    printf("%s\"%s\":%llu", n++ > 0 ? "," : "", perfEventNames[event],
+                           (unsigned long long) counts[event]);
+            if (perfEvents & 1u << PERF_INSTRUCTIONS)
+                printf(",\"ipc\":%.2f", ipc);
+            for (int event = PERF_BRANCH_MISSES; event < PERF_EVENTS; event++)
+                if (perfEvents & 1u << event)
+                    printf(",\"%s_per_kb\":%.3f", perfEventNames[event], (double) counts[event] / kilobytes);
+            printf("}");
+            continue;
+        }
+        printf("perf %s: %llu cycles", fileStageNames[stage], (unsigned long long) counts[PERF_CYCLES]);
+        if (perfEvents & 1u << PERF_INSTRUCTIONS)
+            printf(", IPC %.2f", ipc);
+        for (int event = PERF_BRANCH_MISSES; event < PERF_EVENTS; event++)
+            if (perfEvents & 1u << event)
+                printf(", %s/KB %.3f", perfEventNames[event], (double) counts[event] / kilobytes);
+        printf("\n");
+    }
+    if (outputMode == OUTPUT_JSON)
+        printf("}");
+}
+
+/**
+ * Prints the result of a single file of the batch, depending on the output mode:
+ * the input and output lines, a JSON record or nothing at all. With the option "--stats", the
+ * counters and the stage times of the file are printed too, and with "--perf-counters" the
+ * hardware events of its stages.
+ */
+static void printFileJob(FILE_JOB *job, OUTPUT_MODE outputMode) {
+    int showStats = job->batch->options->showStats && job->status == FILE_PROCESSED;
+    static const char *statusNames[] = {"processed", "skipped", "linked", "failed"};
+
+    if (outputMode == OUTPUT_QUIET)
+        return;
+    flockfile(stdout);
+    if (outputMode == OUTPUT_JSON) {
+        printf("{\"index\":%d,\"input\":", job->index + 1);
+        printJsonString(stdout, job->inputPath);
+        printf(",\"output\":");
+        printJsonString(stdout, job->outputPath);
+        if (job->keyId != NULL) {
+            printf(",\"key\":");
+            printJsonString(stdout, job->keyId);
+        }
+        printf(",\"status\":\"%s\",\"bytes_in\":%llu,\"bytes_out\":%llu,\"letters\":%llu,\"digraphs\":%llu,"
+               "\"padding\":%llu,\"elapsed_ns\":%llu", statusNames[job->status],
+               (unsigned long long) job->stats.bytesIn, (unsigned long long) job->stats.bytesOut,
+               (unsigned long long) job->stats.letters, (unsigned long long) job->stats.digraphs,
+               (unsigned long long) job->stats.padding, (unsigned long long) job->elapsedTime);
+        if (showStats)
+            printStageTimes(job->stats.stageTimes, &job->stats, job->elapsedTime, outputMode);
+        if (showStats && job->stats.perfEvents != 0)
+            printStageCounts(job->stats.stageCounts, job->stats.perfEvents, job->stats.bytesIn, outputMode);
+        printf("}\n");
+    } else {
+        printf("\ninput %d: %s\n", job->index + 1, job->inputPath);
+        if (job->status == FILE_SKIPPED)
+            printf("unchanged, skipped\n");
+        else if (job->status == FILE_LINKED)
+            printf("identical to input %d\n", job->primary->index + 1);
+        if (job->keyId != NULL)
+            printf("key: %s\n", job->keyId);
+        if (job->status == FILE_FAILED)
+            printf("output %d: FAILED\n", job->index + 1);
+        else printf("output %d: %s\n", job->index + 1, job->outputPath);
+        if (showStats) {
+            printf("bytes: %llu -> %llu, letters: %llu, digraphs: %llu, padding: %llu\n",
+                   (unsigned long long) job->stats.bytesIn, (unsigned long long) job->stats.bytesOut,
+                   (unsigned long long) job->stats.letters, (unsigned long long) job->stats.digraphs,
+                   (unsigned long long) job->stats.padding);
+            printStageTimes(job->stats.stageTimes, &job->stats, job->elapsedTime, outputMode);
+            if (job->stats.perfEvents != 0)
+                printStageCounts(job->stats.stageCounts, job->stats.perfEvents, job->stats.bytesIn, outputMode);
+        }
+    }
+    funlockfile(stdout);
+}
+
+/**
+ * Processes a single file of the batch and records its status. With the option "--cache",
+ * the file is skipped if it is unchanged, or gets a copy of the output of an identical file of
+ * the batch that was already processed. Errors never stop the batch.
+ *
+ * @param argument - the FILE_JOB describing the file
+ */
+static void runFileJob(void *argument) {
+    FILE_JOB *job = argument;
+    BATCH *batch = job->batch;
+    OPTIONS *options = batch->options;
+    CACHE_RECORD record;
+    uint64_t startTime = getMonotonicTime();
+
+    ALLOC_STAGE("file");
+
+    if (!options->useCache) {
+        job->status = processInputFile(options, job) == 0 ? FILE_PROCESSED : FILE_FAILED;
+    } else {
+        pthread_mutex_lock(&batch->lock);
+        int cached = lookupCache(&batch->cache, job->inputPath, job->outputPath, batch->fingerprint, &record);
+        pthread_mutex_unlock(&batch->lock);
+
+        if (cached) {
+            job->status = FILE_SKIPPED;
+            free(record.inputPath);
+            if (options->integrity && !hasIntegrity(job) &&
+                writeIntegrityFromFile(job->outputPath, getOutputFingerprint(job)) != 0)
+                job->status = FILE_FAILED;
+        } else {
+            if (job->primary != NULL && job->primary->status != FILE_FAILED &&
+                cloneOrCopyFile(job->primary->outputPath, job->outputPath) == 0)
+                job->status = !options->integrity ||
+                              writeIntegrityFromFile(job->outputPath, getOutputFingerprint(job)) == 0 ? FILE_LINKED
+                                                                                                        : FILE_FAILED;
+            else {
+                if (!options->resume)
+                    remove(job->outputPath);
+                job->status = processInputFile(options, job) == 0 ? FILE_PROCESSED : FILE_FAILED;
+            }
+
+            pthread_mutex_lock(&batch->lock);
+            if (job->status != FILE_FAILED)
+                updateCache(&batch->cache, &record, job->outputPath);
+            else free(record.inputPath);
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+
+    job->elapsedTime = getMonotonicTime() - startTime;
+    if (traceEnabled)
+        addTraceSpan("file", "file", job->inputPath, job->index, startTime, startTime + job->elapsedTime);
+    printFileJob(job, options->outputMode);
+}
+
+/**
+ * Processes a single file of the batch under many keys at once: the file is read once and
+ * written with the CIPHER_TABLE of every FILE_JOB of the chain (one for every selected key).
+ * Every FILE_JOB of the chain gets the status and the counters of its own output. The ones after the
+ * first processed FILE_JOB share its input and time (see @sharedInput), so the batch counts the file
+ * once.
+ *
+ * @param argument - the first FILE_JOB of the chain
+ */
+static void runFanOutJob(void *argument) {
+    FILE_JOB *first = argument, *job;
+    OPTIONS *options = first->batch->options;
+    int nKeys = 0, k = 0, counted = 0;
+
+    ALLOC_STAGE("file");
+    for (job = first; job != NULL; job = job->nextKey)
+        nKeys++;
+
+    char **outputPaths = memoryMalloc(nKeys * sizeof(char *));
+    const CIPHER_TABLE **cipherTables = memoryMalloc(nKeys * sizeof(CIPHER_TABLE *));
+    FILE_STATS *stats = memoryCalloc(nKeys, sizeof(FILE_STATS));
+    for (job = first; job != NULL; job = job->nextKey, k++) {
+        outputPaths[k] = job->outputPath;
+        cipherTables[k] = job->cipherTable;
+    }
+
+    uint64_t startTime = getMonotonicTime();
+    int result = processFileFanOut(first->inputPath, outputPaths, cipherTables, nKeys, options->command, stats);
+    uint64_t elapsedTime = getMonotonicTime() - startTime;
+    if (traceEnabled)
+        addTraceSpan("file", "file", first->inputPath, first->index, startTime, startTime + elapsedTime);
+
+    for (job = first, k = 0; job != NULL; job = job->nextKey, k++) {
+        job->status = result == 0 ? FILE_PROCESSED : FILE_FAILED;
+        if (result == 0 && options->integrity && writeIntegrityFromFile(job->outputPath, getOutputFingerprint(job)) != 0)
+            job->status = FILE_FAILED;
+        job->stats = stats[k];
+        job->sharedInput = counted;
+        counted |= job->status == FILE_PROCESSED;
+        job->elapsedTime = elapsedTime;
+        printFileJob(job, options->outputMode);
+    }
+    free(outputPaths);
+    free(cipherTables);
+    free(stats);
+}
+
+/**
+ * Decodes a single file of the batch with the key of the keyring it was encoded with, which is
+ * identified first by decoding only the beginning of the file under every key (see
+ * @identifyKey()). If no key can be identified, the file fails.
+ *
+ * @param argument - the FILE_JOB describing the file
+ */
+static void runAutoKeyJob(void *argument) {
+    FILE_JOB *job = argument;
+    OPTIONS *options = job->batch->options;
+    KEY_IDENTIFICATION identification;
+    uint64_t startTime = traceEnabled ? getMonotonicTime() : 0;
+
+    ALLOC_STAGE("identify");
+    int result = identifyKey(job->inputPath, job->batch->keyRing, options->expectedHeader, &identification);
+    if (traceEnabled)
+        addTraceSpan("identify", "file", job->inputPath, job->index, startTime, getMonotonicTime());
+    if (result != 0) {
+        fprintf(stderr, "\nERROR: no key of the keyring can be identified for the file '%s'!\n\n", job->inputPath);
+        job->status = FILE_FAILED;
+        printFileJob(job, options->outputMode);
+        return;
+    }
+    job->cipherTable = &job->batch->keyRing->entries[identification.index].decodeTable;
+    job->keyId = job->batch->keyRing->entries[identification.index].id;
+    runFileJob(job);
+}
+
+/**
+ * Walks a directory of the input tree: its mirrored directory is created in the output tree,
+ * every regular file it contains is scheduled as soon as it is found and every subdirectory is
+ * scheduled to be walked as well (in parallel, with the option "--jobs"). The directory is read
+ * through its file descriptor, so its entries are checked with "fstatat()" only when the type
+ * reported by the directory itself is not enough. Symbolic links to directories are not followed.
+ * A directory that cannot be read is recorded in the batch as a failed entry.
+ *
+ * @param argument - the DIRECTORY_JOB describing the directory
+ */
+static void walkDirectory(void *argument) {
+    DIRECTORY_JOB *directoryJob = argument;
+    BATCH *batch = directoryJob->batch;
+    int directoryFd = open(directoryJob->inputPath, O_RDONLY | O_DIRECTORY);
+    DIR *directory = directoryFd >= 0 ? fdopendir(directoryFd) : NULL;
+    struct dirent *entry;
+    uint64_t startTime = traceEnabled ? getMonotonicTime() : 0;
+
+    ALLOC_STAGE("walk");
+    if (directory == NULL || makeDirectories(directoryJob->outputDir) != 0) {
+        fprintf(stderr, "\nERROR: the directory '%s' cannot be walked!\n\n", directoryJob->inputPath);
+        FILE_JOB *job = addFileJob(batch, directoryJob->inputPath, directoryJob->outputDir);
+        job->status = FILE_FAILED;
+        printFileJob(job, batch->options->outputMode);
+        if (directory != NULL) closedir(directory);
+        else if (directoryFd >= 0) close(directoryFd);
+        free(directoryJob);
+        return;
+    }
+
+    while ((entry = readdir(directory)) != NULL) {
+        struct stat entryStat;
+        int isDirectory = entry->d_type == DT_DIR, isFile = entry->d_type == DT_REG;
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+            if (fstatat(directoryFd, entry->d_name, &entryStat, 0) != 0)
+                continue;
+            isDirectory = entry->d_type == DT_UNKNOWN && S_ISDIR(entryStat.st_mode);
+            isFile = S_ISREG(entryStat.st_mode);
+        }
+
+        char *entryPath = joinPath(directoryJob->inputPath, entry->d_name);
+        if (isDirectory) {
+            DIRECTORY_JOB *subdirectoryJob = memoryMalloc(sizeof(DIRECTORY_JOB));
+            subdirectoryJob->batch = batch;
+            subdirectoryJob->inputPath = entryPath;
+            subdirectoryJob->outputDir = joinPath(directoryJob->outputDir, entry->d_name);
+            scheduleTask(batch, walkDirectory, subdirectoryJob);
+        } else if (isFile) {
+            char *outputPath = getOutputFilePath(directoryJob->outputDir, entryPath,
+                                                 getExtension(batch->options->command));
+            scheduleTask(batch, runFileJob, addFileJob(batch, entryPath, outputPath));
+        } else free(entryPath);
+    }
+    closedir(directory);
+    if (traceEnabled)
+        addTraceSpan("walk", "file", NULL, -1, startTime, getMonotonicTime());
+    free(directoryJob->inputPath);
+    free(directoryJob->outputDir);
+    free(directoryJob);
+}
+
+/**
+ * Schedules the walk of an input directory given on the command line. Its tree is mirrored
+ * in a directory of the output directory with the same name of the input directory.
+ */
+static void scheduleInputDirectory(BATCH *batch, char *inputDir) {
+    DIRECTORY_JOB *directoryJob = memoryMalloc(sizeof(DIRECTORY_JOB));
+    char *name = copyString(inputDir);
+    size_t length = strlen(name);
+
+    while (length > 1 && name[length - 1] == getSeparator())
+        name[--length] = '\0';
+    char *baseName = strrchr(name, getSeparator()) != NULL ? strrchr(name, getSeparator()) + 1 : name;
+
+    directoryJob->batch = batch;
+    directoryJob->inputPath = copyString(inputDir);
+    directoryJob->outputDir = joinPath(batch->options->outputDir, baseName);
+    free(name);
+    scheduleTask(batch, walkDirectory, directoryJob);
+}
+
+/**
+ * Prints how many files were processed, skipped, linked and failed, followed by the list of
+ * the files that failed.
+ * With the option "--stats", the total counters and stage times of the processed files are
+ * printed too (as a last JSON record with "--json"), together with the time spent parsing the
+ * KEYFILEs and building their matrices (with "--keys" and "--keyring", loading the keys counts
+ * as parsing, matrices included), and with "--perf-counters" the hardware events of the stages
+ * (only the events counted for every file). The throughput refers to the time of the whole batch,
+ * while the time per digraph refers to the sum of the times of the files, that is to the work
+ * of a single thread. A file written under many keys counts once, like a single file (its input,
+ * its counters and its time are the ones of its first processed key). The stage times and the
+ * times per digraph are left out unless all the processed files were processed one stage at a time.
+ *
+ * @param batch - the BATCH to summarize
+ * @param elapsedTime - the time of the whole batch
+ * @return the number of files that failed
+ */
+static int printBatchSummary(BATCH *batch, uint64_t elapsedTime) {
+    OUTPUT_MODE outputMode = batch->options->outputMode;
+    int count[FILE_FAILED + 1] = {0};
+    uint64_t stageTimes[FILE_STAGES] = {0}, filesTime = 0;
+    FILE_STATS total;
+
+    memset(&total, 0, sizeof(total));
+    total.perfEvents = (1u << PERF_EVENTS) - 1;
+    total.staged = 1;
+    for (int i = 0; i < batch->nJobs; i++) {
+        const FILE_JOB *job = batch->jobs[i];
+        count[job->status]++;
+        if (job->status != FILE_PROCESSED || job->sharedInput)
+            continue;
+        total.bytesIn += job->stats.bytesIn;
+        filesTime += job->elapsedTime;
+        total.bytesOut += job->stats.bytesOut;
+        total.letters += job->stats.letters;
+        total.digraphs += job->stats.digraphs;
+        total.padding += job->stats.padding;
+        for (int stage = 0; stage < FILE_STAGES; stage++) {
+            stageTimes[stage] += job->stats.stageTimes[stage];
+            for (int event = 0; event < PERF_EVENTS; event++)
+                total.stageCounts[stage][event] += job->stats.stageCounts[stage][event];
+        }
+        total.perfEvents &= job->stats.perfEvents;
+        total.staged &= job->stats.staged;
+    }
+    total.staged &= count[FILE_PROCESSED] > 0;
+    if (outputMode == OUTPUT_NORMAL)
+        printf("\nprocessed: %d, skipped: %d, linked: %d, failed: %d\n\n", count[FILE_PROCESSED], count[FILE_SKIPPED],
+               count[FILE_LINKED], count[FILE_FAILED]);
+
+    if (batch->options->showStats && outputMode == OUTPUT_JSON) {
+        printf("{\"files\":%d,\"processed\":%d,\"bytes_in\":%llu,\"bytes_out\":%llu,\"letters\":%llu,"
+               "\"digraphs\":%llu,\"padding\":%llu,\"keyfile_ns\":%llu,\"matrix_ns\":%llu,\"elapsed_ns\":%llu",
+               batch->nJobs, count[FILE_PROCESSED], (unsigned long long) total.bytesIn,
+               (unsigned long long) total.bytesOut, (unsigned long long) total.letters,
+               (unsigned long long) total.digraphs, (unsigned long long) total.padding,
+               (unsigned long long) batch->keyFileTime, (unsigned long long) batch->matrixTime,
+               (unsigned long long) elapsedTime);
+        printStageTimes(stageTimes, &total, elapsedTime, outputMode);
+        if (total.staged)
+            printf(",\"ns_per_digraph_per_thread\":%.2f",
+                   total.digraphs > 0 ? (double) filesTime / (double) total.digraphs : 0);
+        if (count[FILE_PROCESSED] > 0 && total.perfEvents != 0)
+            printStageCounts(total.stageCounts, total.perfEvents, total.bytesIn, outputMode);
+        printf("}\n");
+    } else if (batch->options->showStats && outputMode == OUTPUT_NORMAL) {
+        printf("total bytes: %llu -> %llu, letters: %llu, digraphs: %llu, padding: %llu\n",
+               (unsigned long long) total.bytesIn, (unsigned long long) total.bytesOut,
+               (unsigned long long) total.letters, (unsigned long long) total.digraphs,
+               (unsigned long long) total.padding);
+        printf("keyfile: %.3f ms, matrix: %.3f ms, batch: %.3f ms\n", (double) batch->keyFileTime / 1e6,
+               (double) batch->matrixTime / 1e6, (double) elapsedTime / 1e6);
+        printStageTimes(stageTimes, &total, elapsedTime, outputMode);
+        if (total.staged)
+            printf("%.2f ns/digraph per thread\n",
+                   total.digraphs > 0 ? (double) filesTime / (double) total.digraphs : 0);
+        if (count[FILE_PROCESSED] > 0 && total.perfEvents != 0)
+            printStageCounts(total.stageCounts, total.perfEvents, total.bytesIn, outputMode);
+        printf("\n");
+    }
+
+    if (count[FILE_FAILED] > 0) {
+        fprintf(stderr, "ERROR: %d of %d files could not be processed:\n", count[FILE_FAILED], batch->nJobs);
+        for (int i = 0; i < batch->nJobs; i++)
+            if (batch->jobs[i]->status == FILE_FAILED)
+                fprintf(stderr, "  %s\n", batch->jobs[i]->inputPath);
+    }
+    return count[FILE_FAILED];
+}
 
 /**
  * Creates all the necessary structures and starts the encoding/decoding of
  * the given files.
+ * A file that cannot be processed does not stop the others: its status is recorded
+ * and reported in the summary at the end.
+ * With the option "--cache", the files that are unchanged since the last run on the
+ * same output directory (with the same KEYFILE and command) are skipped, and the other files
+ * with identical content are processed once and then copied (or cloned): only the files that
+ * miss the cache are compared, so an unchanged batch reads no input at all.
+ * With the option "--resume", large files are checkpointed while they are processed
+ * and an interrupted run continues from the last checkpoint.
+ * With the option "--recursive", the given directories are walked and all their files
+ * are processed into a mirrored tree of the output directory, while they are discovered.
+ * With the options "--keys" and "--keyring", every file is read once and written under every
+ * selected key, in a directory of the output directory named after the ID of the key, or, with
+ * the option "--auto", decoded once with the key it was encoded with, identified among them.
+ * With the "rekey" command, the files encoded with the old KEYFILE are re-encoded with the new
+ * one in a single pass, without writing the decoded text.
+ * With the option "--range", only the selected window of the decoded output of every file is
+ * written, decoding from the nearest point of the file instead of from its beginning.
+ * With the option "--jobs", multiple files (and directories) are processed in parallel.
+ * With the option "--integrity", an integrity sidecar is written next to every output.
+ * With the option "--stats", the counters and the time of every stage of every file are printed,
+ * followed by their total. With "--perf-counters", the hardware events of every stage are counted
+ * and printed too (if the counters are not available, a warning is printed and the batch goes on).
+ * With the option "--trace", the spans of the setup, of the batch and of every file, portion and
+ * stage are recorded by every thread and written at the end in the Chrome trace event format.
+ * With the options "--quiet" and "--json", the console decoration is replaced by nothing
+ * or by one JSON record per file.
  *
  * @param argc - the command's number of parameters
  * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if every file was processed, EXIT_FAILURE otherwise
  */
-void startPlayfair(int argc, char **argv) {
-    KEYFILE keyFile = createKeyFileFromFile(argv[2]);
-    MATRIX playfairMatrix = createMatrix(keyFile);
-    printStructures(keyFile, playfairMatrix);
+int startPlayfair(int argc, char **argv) {
+    OPTIONS options = parseOptions(argc, argv);
+    KEYRING keys = {NULL, 0};
+    KEYFILE keyFile;
+    MATRIX playfairMatrix;
+    CIPHER_TABLE cipherTable;
+    KEYFILE newKeyFile;
+    MATRIX newMatrix;
+    CIPHER_TABLE newCipherTable;
+    REKEY_TABLE rekeyTable;
+    char **keyOutputDirs = NULL;
+    char **explicitFiles = memoryCalloc(options.nInputFiles, sizeof(char *));
+    FILE_JOB **explicitJobs = memoryCalloc(options.nInputFiles, sizeof(FILE_JOB *));
+    char **missedFiles = memoryCalloc(options.nInputFiles, sizeof(char *));
+    int *missedIndexes = memoryCalloc(options.nInputFiles, sizeof(int));
+    int *duplicateOf = memoryCalloc(options.nInputFiles, sizeof(int));
+    int nExplicitFiles = 0;
+    BATCH batch;
 
-    for (int i = 4; i < argc; i++) {
-        printf("\ninput %d: %s\n", i - 3, argv[i]);
-        char *outputPath = getOutputFilePath(argv[3], argv[i], getExtension(argv[1]));
-        processFile(argv[i], outputPath, playfairMatrix, keyFile, argv[1]);
-        printf("output %d: %s\n", i - 3, outputPath);
-        free(outputPath);
+    memset(&batch, 0, sizeof(batch));
+    batch.options = &options;
+    if (options.tracePath != NULL)
+        startTrace();
+    if (options.perfCounters) {
+        PERF_COUNTERS counters;
+        if (openPerfCounters(&counters) == 0)
+            closePerfCounters(&counters);
+        else {
+            fprintf(stderr, "\nWARNING: the hardware performance counters are not available (no PMU or perf events "
+                            "restricted by 'perf_event_paranoid'), only the stage times are reported.\n\n");
+            options.perfCounters = 0;
+        }
+    }
+    uint64_t startTime = getMonotonicTime(), keyFileTime;
+    ALLOC_STAGE("keys");
+    if (options.newKeyFilePath != NULL) {
+        keyFile = createKeyFileFromFile(options.keyFilePath);
+        newKeyFile = createKeyFileFromFile(options.newKeyFilePath);
+        keyFileTime = getMonotonicTime();
+        batch.keyFileTime = keyFileTime - startTime;
+        playfairMatrix = createMatrix(keyFile);
+        cipherTable = createCipherTable(playfairMatrix, keyFile, "decode");
+        newMatrix = createMatrix(newKeyFile);
+        newCipherTable = createCipherTable(newMatrix, newKeyFile, "encode");
+        rekeyTable = createRekeyTable(&cipherTable, &newCipherTable);
+        batch.rekeyTable = &rekeyTable;
+        batch.fingerprint = getRekeyTableFingerprint(&rekeyTable);
+        batch.matrixTime = getMonotonicTime() - keyFileTime;
+    } else if (options.keyFilePath != NULL) {
+        keyFile = createKeyFileFromFile(options.keyFilePath);
+        keyFileTime = getMonotonicTime();
+        batch.keyFileTime = keyFileTime - startTime;
+        playfairMatrix = createMatrix(keyFile);
+        cipherTable = createCipherTable(playfairMatrix, keyFile, options.command);
+        batch.cipherTable = &cipherTable;
+        batch.fingerprint = getCipherTableFingerprint(&cipherTable);
+        batch.matrixTime = getMonotonicTime() - keyFileTime;
+    } else {
+        if (loadKeySelection(options.keyRingPath, options.keyList, &keys) != 0)
+            exit(EXIT_FAILURE);
+        batch.keyFileTime = getMonotonicTime() - startTime;
+        batch.keyRing = &keys;
+        keyOutputDirs = memoryCalloc(keys.size, sizeof(char *));
+        for (size_t k = 0; k < keys.size && !options.autoKey; k++) {
+            keyOutputDirs[k] = joinPath(options.outputDir, keys.entries[k].id);
+            if (makeDirectories(keyOutputDirs[k]) != 0)
+                fprintf(stderr, "\nERROR: the output directory '%s' cannot be created!\n\n", keyOutputDirs[k]);
+        }
+    }
+    if (traceEnabled) {
+        addTraceSpan("keyfile", "setup", NULL, -1, startTime, startTime + batch.keyFileTime);
+        addTraceSpan("matrix", "setup", NULL, -1, startTime + batch.keyFileTime,
+                     startTime + batch.keyFileTime + batch.matrixTime);
+    }
+    ALLOC_STAGE("batch");
+    batch.pool = options.nJobs > 1 ? createThreadPool(options.nJobs) : NULL;
+    pthread_mutex_init(&batch.lock, NULL);
+    if (options.outputMode == OUTPUT_NORMAL && options.newKeyFilePath != NULL) {
+        printf("\nOLD KEY:\n");
+        printStructures(keyFile, playfairMatrix);
+        printf("\nNEW KEY:\n");
+        printStructures(newKeyFile, newMatrix);
+    } else if (options.outputMode == OUTPUT_NORMAL && options.keyFilePath != NULL)
+        printStructures(keyFile, playfairMatrix);
+    for (size_t k = 0; k < keys.size && options.outputMode == OUTPUT_NORMAL && !options.autoKey; k++) {
+        printf("\nKEY '%s':\n", keys.entries[k].id);
+        printStructures(keys.entries[k].keyFile, keys.entries[k].matrix);
+    }
+    if (options.useCache)
+        loadCache(options.outputDir, &batch.cache);
+
+    for (int i = 0; i < options.nInputFiles; i++) {
+        struct stat inputStat;
+        char *inputPath = options.inputFiles[i];
+
+        if (options.recursive && stat(inputPath, &inputStat) == 0 && S_ISDIR(inputStat.st_mode))
+            scheduleInputDirectory(&batch, inputPath);
+        else if (options.autoKey)
+            explicitJobs[nExplicitFiles++] = addFileJob(&batch, copyString(inputPath),
+                                                        getOutputFilePath(options.outputDir, inputPath,
+                                                                          getExtension(options.command)));
+        else if (options.keyFilePath == NULL) {
+            FILE_JOB *previous = NULL;
+            for (size_t k = 0; k < keys.size; k++) {
+                FILE_JOB *job = addFileJob(&batch, copyString(inputPath),
+                                           getOutputFilePath(keyOutputDirs[k], inputPath, getExtension(options.command)));
+                job->cipherTable = strcmp(options.command, "encode") == 0 ? &keys.entries[k].encodeTable
+                                                                          : &keys.entries[k].decodeTable;
+                if (previous != NULL)
+                    previous->nextKey = job;
+                else explicitJobs[nExplicitFiles++] = job;
+                previous = job;
+            }
+        } else {
+            explicitFiles[nExplicitFiles] = inputPath;
+            explicitJobs[nExplicitFiles++] = addFileJob(&batch, copyString(inputPath),
+                                                        getOutputFilePath(options.outputDir, inputPath,
+                                                                          getExtension(options.command)));
+        }
+    }
+
+    uint64_t batchTime = traceEnabled ? getMonotonicTime() : 0;
+    if (options.useCache) {
+        int nMissed = 0;
+        for (int i = 0; i < nExplicitFiles; i++) {
+            CACHE_RECORD record;
+            if (explicitFiles[i] == NULL)
+                continue;
+            int cached = lookupCache(&batch.cache, explicitFiles[i], explicitJobs[i]->outputPath, batch.fingerprint,
+                                     &record);
+            free(record.inputPath);
+            if (!cached) {
+                missedFiles[nMissed] = explicitFiles[i];
+                missedIndexes[nMissed++] = i;
+            }
+        }
+        findDuplicateInputs(missedFiles, nMissed, duplicateOf);
+        for (int m = 0; m < nMissed; m++)
+            if (duplicateOf[m] >= 0)
+                explicitJobs[missedIndexes[m]]->primary = explicitJobs[missedIndexes[duplicateOf[m]]];
+    }
+    for (int i = 0; i < nExplicitFiles; i++)
+        if (explicitJobs[i]->primary == NULL)
+            scheduleTask(&batch, options.autoKey ? runAutoKeyJob :
+                                 explicitJobs[i]->nextKey != NULL ? runFanOutJob : runFileJob, explicitJobs[i]);
+    if (batch.pool != NULL)
+        waitThreadPool(batch.pool);
+    for (int i = 0; i < nExplicitFiles; i++)
+        if (explicitJobs[i]->primary != NULL)
+            scheduleTask(&batch, runFileJob, explicitJobs[i]);
+    if (batch.pool != NULL)
+        waitThreadPool(batch.pool);
+    if (traceEnabled)
+        addTraceSpan("batch", "batch", NULL, -1, batchTime, getMonotonicTime());
+
+    int nFailed = printBatchSummary(&batch, getMonotonicTime() - startTime);
+
+    if (batch.pool != NULL)
+        destroyThreadPool(batch.pool);
+    if (options.tracePath != NULL && writeTrace(options.tracePath) != 0)
+        nFailed++;
+    if (options.useCache) {
+        saveCache(&batch.cache);
+        freeCache(&batch.cache);
+    }
+    for (int i = 0; i < batch.nJobs; i++) {
+        free(batch.jobs[i]->inputPath);
+        free(batch.jobs[i]->outputPath);
+        free(batch.jobs[i]);
+    }
+    free(batch.jobs);
+    free(explicitFiles);
+    free(explicitJobs);
+    free(missedFiles);
+    free(missedIndexes);
+    free(duplicateOf);
+    pthread_mutex_destroy(&batch.lock);
+    if (options.keyFilePath != NULL) {
+        freeMatrix(playfairMatrix);
+        freeKeyFile(keyFile);
+    }
+    if (options.newKeyFilePath != NULL) {
+        freeMatrix(newMatrix);
+        freeKeyFile(newKeyFile);
     }
-}
\ No newline at end of file
+    for (size_t k = 0; k < keys.size; k++)
+        free(keyOutputDirs[k]);
+    free(keyOutputDirs);
+    freeKeyRing(&keys);
+    return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,6 +2,6 @@
 #ifndef PLAYFAIR_STARTER_H
 #define PLAYFAIR_STARTER_H
 
-void startPlayfair(int argc, char **argv);
+int startPlayfair(int argc, char **argv);
 
 #endif //PLAYFAIR_STARTER_H
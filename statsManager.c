@@ -0,0 +1,506 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "statsManager.h"
+#include "utils.h"
+#include "cipherManager.h"
+#include "threadPool.h"
+#include "optionManager.h"
+#include "printer.h"
+
+/**
+ * The minimum size of the part of a file counted by a single job.
+ */
+#define STATS_JOB_SIZE (1 << 20)
+
+/**
+ * The maximum size of the part of a file counted by a single job, so that the 32-bit counters of
+ * its characters cannot overflow.
+ */
+#define STATS_MAX_JOB_SIZE ((size_t) 1 << 32)
+
+/**
+ * The amount of characters normalized at a time by a job, so that their letters stay in the cache
+ * while they are split into digraphs.
+ */
+#define STATS_BLOCK (1 << 16)
+
+/**
+ * The amount of digraphs printed for a file (the most frequent ones).
+ */
+#define STATS_TOP_DIGRAPHS 10
+
+/**
+ * The marker of a character that is not a letter.
+ */
+#define STATS_SKIP 0xFF
+
+/**
+ * The letter counted before the first letter of a job, which never forms a double.
+ */
+#define STATS_NO_LETTER 0xFE
+
+/**
+ * The runs of the digraphs of a job: the one for a job beginning a new digraph, the one for a job
+ * whose first letter completes the digraph of the previous job, and the common run after they meet.
+ */
+enum {
+    RUN_EVEN,
+    RUN_ODD,
+    RUN_SHARED
+};
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t letters[26];
+    uint64_t doubled[26];
+    uint64_t digraphs[26 * 26];
+    uint64_t padding;
+} LETTER_STATS;
+
+typedef struct {
+    const unsigned char *map;
+    int special;
+    const unsigned char *data;
+    size_t start;
+    size_t end;
+    uint64_t letters[26];
+    uint64_t doubled[26];
+    uint64_t digraphs[3][26 * 26];
+    uint64_t padding[3];
+    uint64_t nLetters;
+    int first;
+    int last;
+    int pending[2];
+} STATS_JOB;
+
+typedef struct {
+    char *path;
+    void *data;
+    size_t size;
+    int failed;
+    STATS_JOB *jobs;
+    size_t nJobs;
+    LETTER_STATS stats;
+} STATS_FILE;
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds.
+ */
+static uint64_t getMonotonicTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Splits the letters of a run into digraphs like the encoding does, from the given position of the
+ * letters and while a complete digraph is left: a doubled letter forms a digraph with the special
+ * character and begins the next digraph too. Doubled letters are rare in texts, so they are left
+ * to a predicted branch: the next position does not wait for the comparison of the letters.
+ *
+ * @param letters - the letters 0-25 to split
+ * @param nLetters - the amount of letters
+ * @param position - the position of the first letter of the next digraph
+ * @param special - the special character 0-25
+ * @param digraphs - the histogram of the digraphs of the run
+ * @param padding - the counter of the special characters inserted by the run
+ * @return the position of the first letter of the next digraph, after the last complete one
+ */
+static size_t splitRun(const unsigned char *restrict letters, size_t nLetters, size_t position, int special,
+                       uint64_t *restrict digraphs, uint64_t *restrict padding) {
+    uint64_t inserted = 0;
+
+    while (position + 1 < nLetters) {
+        unsigned first = letters[position], second = letters[position + 1];
+        if (__builtin_expect(first != second, 1)) {
+            digraphs[first * 26 + second]++;
+            position += 2;
+        } else {
+            digraphs[first * 26 + special]++;
+            inserted++;
+            position++;
+        }
+    }
+    *padding += inserted;
+    return position;
+}
+
+/**
+ * Counts the letters, doubled letters and digraphs of the part of the file of the job.
+ * Every block of @STATS_BLOCK characters is first normalized with the table of the encoding into
+ * a compact array of letters (without branches), while the characters are counted in 4 banks of
+ * histograms, so that consecutive equal characters do not wait for each other's counts. The
+ * letters are then split into digraphs.
+ * Since the split of a part depends on whether a digraph of the previous part is still open, the
+ * job splits its letters both from its first letter and from its second one (as the first letter
+ * may complete the digraph of the previous part): the two runs meet at the first doubled letter
+ * that only one of them pairs, and the rest of the part is split once. The right run is chosen
+ * when the jobs of the file are merged in order (see @mergeJobs()).
+ *
+ * @param argument - the STATS_JOB to run
+ */
+static void runStatsJob(void *argument) {
+    STATS_JOB *job = argument;
+    const unsigned char *map = job->map, *data = job->data;
+    unsigned char *restrict letters = memoryMalloc(STATS_BLOCK + 1);
+    uint32_t (*banks)[256] = memoryCalloc(4, sizeof(*banks));
+    size_t positions[2] = {1, 2};
+    int synced = 0;
+
+    letters[0] = STATS_NO_LETTER;
+    job->first = -1;
+    job->last = -1;
+
+    for (size_t blockStart = job->start; blockStart < job->end; blockStart += STATS_BLOCK) {
+        size_t blockSize = job->end - blockStart < STATS_BLOCK ? job->end - blockStart : STATS_BLOCK;
+        const unsigned char *block = data + blockStart;
+        size_t n = 1, c = 0;
+
+        for (; c + 4 <= blockSize; c += 4) {
+            unsigned char c0 = block[c], c1 = block[c + 1], c2 = block[c + 2], c3 = block[c + 3];
+            banks[0][c0]++;
+            banks[1][c1]++;
+            banks[2][c2]++;
+            banks[3][c3]++;
+            letters[n] = map[c0];
+            n += map[c0] != STATS_SKIP;
+            letters[n] = map[c1];
+            n += map[c1] != STATS_SKIP;
+            letters[n] = map[c2];
+            n += map[c2] != STATS_SKIP;
+            letters[n] = map[c3];
+            n += map[c3] != STATS_SKIP;
+        }
+        for (; c < blockSize; c++) {
+            banks[0][block[c]]++;
+            letters[n] = map[block[c]];
+            n += map[block[c]] != STATS_SKIP;
+        }
+        if (n == 1)
+            continue;
+
+        if (job->first < 0)
+            job->first = letters[1];
+        for (size_t l = 1; l < n; l++)
+            job->doubled[letters[l]] += letters[l] == letters[l - 1];
+
+        while (!synced) {
+            int run = positions[RUN_EVEN] < positions[RUN_ODD] ? RUN_EVEN : RUN_ODD;
+            size_t position = positions[run];
+            if (position + 1 >= n)
+                break;
+            unsigned first = letters[position], second = letters[position + 1], doubled = first == second;
+            job->digraphs[run][first * 26 + (doubled ? (unsigned) job->special : second)]++;
+            job->padding[run] += doubled;
+            positions[run] = position + 2 - doubled;
+            synced = positions[RUN_EVEN] == positions[RUN_ODD];
+        }
+        if (synced)
+            positions[RUN_EVEN] = positions[RUN_ODD] = splitRun(letters, n, positions[RUN_EVEN], job->special,
+                                                                job->digraphs[RUN_SHARED],
+                                                                &job->padding[RUN_SHARED]);
+
+        job->nLetters += n - 1;
+        letters[0] = letters[n - 1];
+        positions[RUN_EVEN] -= n - 1;
+        positions[RUN_ODD] -= n - 1;
+    }
+
+    for (int run = RUN_EVEN; run <= RUN_ODD; run++)
+        job->pending[run] = positions[run] == 0 ? letters[0] : -1;
+    if (job->nLetters > 0)
+        job->last = letters[0];
+    for (int character = 0; character < 256; character++) {
+        uint64_t count = (uint64_t) banks[0][character] + banks[1][character] + banks[2][character] +
+                         banks[3][character];
+        if (map[character] != STATS_SKIP)
+            job->letters[map[character]] += count;
+    }
+    free(banks);
+    free(letters);
+}
+
+/**
+ * Merges the counts of the jobs of the given file in order, completing the digraph left open by
+ * every part with the first letter of the next one (or the special character if it is the same
+ * letter), and the last digraph of the file with the special character, like the encoding does.
+ *
+ * @param file - the STATS_FILE whose jobs have to be merged
+ * @param special - the special character 0-25
+ */
+static void mergeJobs(STATS_FILE *file, int special) {
+    LETTER_STATS *stats = &file->stats;
+    int pending = -1, last = -1;
+
+    stats->bytes = file->size;
+    for (size_t j = 0; j < file->nJobs; j++) {
+        const STATS_JOB *job = &file->jobs[j];
+        int run = RUN_EVEN;
+
+        if (job->nLetters == 0)
+            continue;
+        for (int letter = 0; letter < 26; letter++) {
+            stats->letters[letter] += job->letters[letter];
+            stats->doubled[letter] += job->doubled[letter];
+        }
+        if (last == job->first)
+            stats->doubled[last]++;
+        last = job->last;
+
+        if (pending == job->first) {
+            stats->digraphs[pending * 26 + special]++;
+            stats->padding++;
+        } else if (pending >= 0) {
+            stats->digraphs[pending * 26 + job->first]++;
+            run = RUN_ODD;
+        }
+        for (int d = 0; d < 26 * 26; d++)
+            stats->digraphs[d] += job->digraphs[run][d] + job->digraphs[RUN_SHARED][d];
+        stats->padding += job->padding[run] + job->padding[RUN_SHARED];
+        pending = job->pending[run];
+    }
+    if (pending >= 0) {
+        stats->digraphs[pending * 26 + special]++;
+        stats->padding++;
+    }
+}
+
+/**
+ * Adds the counts of the given LETTER_STATS to the given total.
+ */
+static void addStats(LETTER_STATS *total, const LETTER_STATS *stats) {
+    total->bytes += stats->bytes;
+    total->padding += stats->padding;
+    for (int letter = 0; letter < 26; letter++) {
+        total->letters[letter] += stats->letters[letter];
+        total->doubled[letter] += stats->doubled[letter];
+    }
+    for (int d = 0; d < 26 * 26; d++)
+        total->digraphs[d] += stats->digraphs[d];
+}
+
+/**
+ * Returns the amount of letters, digraphs or doubled letters in the given histogram.
+ */
+static uint64_t sumCounts(const uint64_t *counts, int size) {
+    uint64_t sum = 0;
+    for (int k = 0; k < size; k++)
+        sum += counts[k];
+    return sum;
+}
+
+/**
+ * Prints the counts of the given LETTER_STATS, as the fields of a JSON record or as text.
+ * The size of the encoded output is the one written by the encoding (3 characters per digraph
+ * but the last one).
+ *
+ * @param stats - the counts to print
+ * @param output - the output mode
+ */
+static void printStats(const LETTER_STATS *stats, OUTPUT_MODE output) {
+    uint64_t nLetters = sumCounts(stats->letters, 26), nDigraphs = sumCounts(stats->digraphs, 26 * 26);
+    uint64_t bytesOut = nDigraphs > 0 ? 3 * nDigraphs - 1 : 0;
+
+    if (output == OUTPUT_JSON) {
+        printf("\"bytes_in\":%llu,\"letters\":%llu,\"digraphs\":%llu,\"padding\":%llu,\"bytes_out\":%llu",
+               (unsigned long long) stats->bytes, (unsigned long long) nLetters, (unsigned long long) nDigraphs,
+               (unsigned long long) stats->padding, (unsigned long long) bytesOut);
+        printf(",\"letter_counts\":{");
+        for (int letter = 0; letter < 26; letter++)
+            printf("%s\"%c\":%llu", letter > 0 ? "," : "", 'A' + letter,
+                   (unsigned long long) stats->letters[letter]);
+        printf("},\"doubled_letters\":{");
+        for (int letter = 0, n = 0; letter < 26; letter++)
+            if (stats->doubled[letter] > 0)
+                printf("%s\"%c\":%llu", n++ > 0 ? "," : "", 'A' + letter,
+                       (unsigned long long) stats->doubled[letter]);
+        printf("},\"digraph_counts\":{");
+        for (int d = 0, n = 0; d < 26 * 26; d++)
+            if (stats->digraphs[d] > 0)
+                printf("%s\"%c%c\":%llu", n++ > 0 ? "," : "", 'A' + d / 26, 'A' + d % 26,
+                       (unsigned long long) stats->digraphs[d]);
+        printf("}");
+        return;
+    }
+
+    printf("bytes: %llu, letters: %llu, digraphs: %llu, padding: %llu, encoded bytes: %llu\n",
+           (unsigned long long) stats->bytes, (unsigned long long) nLetters, (unsigned long long) nDigraphs,
+           (unsigned long long) stats->padding, (unsigned long long) bytesOut);
+    printf("letters:");
+    for (int letter = 0; letter < 26; letter++)
+        if (stats->letters[letter] > 0)
+            printf(" %c %.2f%%", 'A' + letter, 100.0 * (double) stats->letters[letter] / (double) nLetters);
+    printf("\ndoubled letters: %llu", (unsigned long long) sumCounts(stats->doubled, 26));
+    for (int letter = 0; letter < 26; letter++)
+        if (stats->doubled[letter] > 0)
+            printf(" %c %llu", 'A' + letter, (unsigned long long) stats->doubled[letter]);
+    printf("\ndigraphs:");
+    int printed[26 * 26] = {0};
+    for (int k = 0; k < STATS_TOP_DIGRAPHS; k++) {
+        int best = -1;
+        for (int d = 0; d < 26 * 26; d++)
+            if (!printed[d] && stats->digraphs[d] > 0 && (best < 0 || stats->digraphs[d] > stats->digraphs[best]))
+                best = d;
+        if (best < 0)
+            break;
+        printed[best] = 1;
+        printf(" %c%c %.2f%%", 'A' + best / 26, 'A' + best % 26,
+               100.0 * (double) stats->digraphs[best] / (double) nDigraphs);
+    }
+    printf("\n");
+}
+
+/**
+ * Prints the correct syntax of the stats command and ends the program.
+ */
+static void printStatsUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE STATISTICS:\n");
+    fprintf(stderr, "'<playfair> stats [--threads <n>] [--json] <keyfile> <file1> ... <filen>'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Counts the letters, the doubled letters and the digraphs of the given files as the encoding
+ * with the given KEYFILE would split them (with the same normalization and the special characters
+ * inserted between doubles and at the end), together with the amount of special characters
+ * inserted and the size of the encoded files, without encoding them.
+ * Every file is memory-mapped and split into parts counted in parallel (see @runStatsJob()),
+ * which are merged in order for every file (see @mergeJobs()). The counts of every file and their
+ * total are printed, as text or as JSON records.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if all the files were counted, EXIT_FAILURE otherwise
+ */
+int startStatistics(int argc, char **argv) {
+    OUTPUT_MODE output = OUTPUT_NORMAL;
+    size_t nThreads = getDefaultThreadCount();
+    unsigned char map[256];
+    int i = 2, nFailed = 0;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            nThreads = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0)
+            output = OUTPUT_JSON;
+        else printStatsUsage();
+    }
+    if (argc - i < 2)
+        printStatsUsage();
+
+    KEYFILE keyFile = createKeyFileFromFile(argv[i]);
+    MATRIX playfairMatrix = createMatrix(keyFile);
+    CIPHER_TABLE table = createCipherTable(playfairMatrix, keyFile, "encode");
+    int special = table.specialCharacter - 'A';
+    for (int character = 0; character < 256; character++)
+        map[character] = table.letters[character] != 0 ? (unsigned char) (table.letters[character] - 'A')
+                                                        : STATS_SKIP;
+
+    int nFiles = argc - i - 1;
+    STATS_FILE *files = memoryCalloc(nFiles, sizeof(STATS_FILE));
+    uint64_t startTime = getMonotonicTime();
+    THREAD_POOL *pool = nThreads > 1 ? createThreadPool(nThreads) : NULL;
+    for (int f = 0; f < nFiles; f++) {
+        STATS_FILE *file = &files[f];
+        struct stat fileStat;
+        int fd = open(argv[i + 1 + f], O_RDONLY);
+
+        file->path = argv[i + 1 + f];
+        if (fd < 0 || fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+            fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", file->path);
+            if (fd >= 0)
+                close(fd);
+            file->failed = 1;
+            continue;
+        }
+        file->size = (size_t) fileStat.st_size;
+        file->data = file->size > 0 ? mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+        close(fd);
+        if (file->data == MAP_FAILED) {
+            fprintf(stderr, "\nERROR: the file '%s' cannot be read!\n\n", file->path);
+            file->data = NULL;
+            file->failed = 1;
+            continue;
+        }
+        if (file->data != NULL)
+            madvise(file->data, file->size, MADV_SEQUENTIAL);
+
+        size_t chunk = file->size / (4 * nThreads) + 1;
+        if (chunk < STATS_JOB_SIZE)
+            chunk = STATS_JOB_SIZE;
+        else if (chunk > STATS_MAX_JOB_SIZE)
+            chunk = STATS_MAX_JOB_SIZE;
+        file->nJobs = (file->size + chunk - 1) / chunk;
+        file->jobs = memoryCalloc(file->nJobs + 1, sizeof(STATS_JOB));
+        for (size_t j = 0; j < file->nJobs; j++) {
+            STATS_JOB *job = &file->jobs[j];
+            job->map = map;
+            job->special = special;
+            job->data = file->data;
+            job->start = j * chunk;
+            job->end = j + 1 < file->nJobs ? (j + 1) * chunk : file->size;
+            if (pool != NULL)
+                submitTask(pool, runStatsJob, job);
+            else runStatsJob(job);
+        }
+    }
+    if (pool != NULL) {
+        waitThreadPool(pool);
+        destroyThreadPool(pool);
+    }
+
+    LETTER_STATS *total = memoryCalloc(1, sizeof(LETTER_STATS));
+    for (int f = 0; f < nFiles; f++) {
+        STATS_FILE *file = &files[f];
+
+        if (!file->failed) {
+            mergeJobs(file, special);
+            addStats(total, &file->stats);
+        } else nFailed++;
+        if (output == OUTPUT_JSON) {
+            printf("{\"index\":%d,\"input\":", f + 1);
+            printJsonString(stdout, file->path);
+            printf(",\"status\":\"%s\"", file->failed ? "failed" : "processed");
+            if (!file->failed) {
+                printf(",");
+                printStats(&file->stats, output);
+            }
+            printf("}\n");
+        } else {
+            printf("\ninput %d: %s\n", f + 1, file->path);
+            if (file->failed)
+                printf("FAILED\n");
+            else printStats(&file->stats, output);
+        }
+        if (file->data != NULL)
+            munmap(file->data, file->size);
+        free(file->jobs);
+    }
+    uint64_t elapsedTime = getMonotonicTime() - startTime;
+    double rate = (double) total->bytes / 1e6 / ((double) elapsedTime / 1e9);
+
+    if (output == OUTPUT_JSON) {
+        printf("{\"files\":%d,\"failed\":%d,", nFiles, nFailed);
+        printStats(total, output);
+        printf(",\"elapsed_ns\":%llu,\"mb_per_second\":%.1f}\n", (unsigned long long) elapsedTime, rate);
+    } else {
+        printf("\ntotal of %d files (%d failed):\n", nFiles, nFailed);
+        printStats(total, output);
+        printf("elapsed: %.3f s (%.1f MB/s)\n\n", (double) elapsedTime / 1e9, rate);
+    }
+
+    free(total);
+    free(files);
+    freeMatrix(playfairMatrix);
+    freeKeyFile(keyFile);
+    return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
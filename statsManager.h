@@ -0,0 +1,7 @@
+
+#ifndef PLAYFAIR_STATSMANAGER_H
+#define PLAYFAIR_STATSMANAGER_H
+
+int startStatistics(int argc, char **argv);
+
+#endif //PLAYFAIR_STATSMANAGER_H
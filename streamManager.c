@@ -0,0 +1,465 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "streamManager.h"
+#include "traceManager.h"
+#include "utils.h"
+
+/**
+ * The default amount of characters to read from the file at a time (if possible).
+ */
+#define BUFFER 500000
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds.
+ */
+static uint64_t getMonotonicTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Writes the encoded/decoded version of the digraph formed by @first and @second to @out
+ * using the table of the given stream. Every digraph but the first one is preceded by a
+ * blank space, so that the output has the same layout regardless of how the input was split.
+ *
+ * @param stream - the stream whose table and counters have to be used
+ * @param out - the buffer where to write the digraph
+ * @param first - the first letter of the digraph
+ * @param second - the second letter of the digraph
+ * @return a pointer to the first free position of @out after the digraph
+ */
+static char *writeDigraph(CIPHER_STREAM *stream, char *out, char first, char second) {
+    const char *digraph = stream->table->digraphs[first - 'A'][second - 'A'];
+    if (stream->digraphs++ > 0)
+        *out++ = ' ';
+    *out++ = digraph[0];
+    *out++ = digraph[1];
+    return out;
+}
+
+/**
+ * Initializes the given stream so that it encodes/decodes text with the given CIPHER_TABLE
+ * (with no stage statistics and the default buffer size of @processStream()).
+ *
+ * @param stream - the stream to initialize
+ * @param table - the table to use to normalize and encode/decode the text
+ */
+void initStream(CIPHER_STREAM *stream, const CIPHER_TABLE *table) {
+    stream->table = table;
+    stream->pendingLetter = 0;
+    stream->bytesIn = 0;
+    stream->letters = 0;
+    stream->digraphs = 0;
+    stream->padding = 0;
+    stream->bytesOut = 0;
+    stream->stageStats = NULL;
+    stream->counters = NULL;
+    stream->bufferSize = 0;
+}
+
+/**
+ * Normalizes @size characters of the given input (non-letters are skipped, letters are
+ * changed to uppercase and the missing character is substituted) and splits them into
+ * digraphs, adding the special character between doubles. Every complete digraph is
+ * encoded/decoded and written to @out, while a possible unpaired last letter is kept in
+ * the stream until the next call, so that the input can be split at any position.
+ * @out must be able to contain at least STREAM_OUTPUT_SIZE(@size) characters.
+ *
+ * @param stream - the stream to feed
+ * @param in - the characters to process
+ * @param size - the amount of characters to process
+ * @param out - the buffer where to write the encoded/decoded digraphs
+ * @return the amount of characters written to @out
+ */
+size_t feedStream(CIPHER_STREAM *stream, const char *in, size_t size, char *out) {
+    const CIPHER_TABLE *table = stream->table;
+    char pending = stream->pendingLetter;
+    char *start = out;
+
+    for (size_t i = 0; i < size; i++) {
+        char letter = table->letters[(unsigned char) in[i]];
+        if (letter == 0) continue;
+        stream->letters++;
+
+        if (pending == 0)
+            pending = letter;
+        else if (pending == letter) {
+            out = writeDigraph(stream, out, pending, table->specialCharacter);
+            stream->padding++;
+        } else {
+            out = writeDigraph(stream, out, pending, letter);
+            pending = 0;
+        }
+    }
+
+    stream->pendingLetter = pending;
+    stream->bytesIn += size;
+    stream->bytesOut += out - start;
+    return out - start;
+}
+
+/**
+ * Ends the given stream: if there is an unpaired letter left, the special character is
+ * added to complete the last digraph, which is then encoded/decoded and written to @out.
+ *
+ * @param stream - the stream to finish
+ * @param out - the buffer where to write the last digraph (at least 3 characters)
+ * @return the amount of characters written to @out
+ */
+size_t finishStream(CIPHER_STREAM *stream, char *out) {
+    char *start = out;
+
+    if (stream->pendingLetter != 0) {
+        out = writeDigraph(stream, out, stream->pendingLetter, stream->table->specialCharacter);
+        stream->padding++;
+        stream->pendingLetter = 0;
+    }
+    stream->bytesOut += out - start;
+    return out - start;
+}
+
+/**
+ * Normalizes @size characters of the given input like @feedStream() does, writing only their
+ * letters to @letters (the non-letters are skipped without branches).
+ *
+ * @param table - the table to use to normalize the text
+ * @param in - the characters to normalize
+ * @param size - the amount of characters to normalize
+ * @param letters - the buffer where to write the letters (at least @size characters)
+ * @return the amount of letters written to @letters
+ */
+static size_t normalizeText(const CIPHER_TABLE *table, const char *restrict in, size_t size,
+                            char *restrict letters) {
+    size_t nLetters = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        char letter = table->letters[(unsigned char) in[i]];
+        letters[nLetters] = letter;
+        nLetters += letter != 0;
+    }
+    return nLetters;
+}
+
+/**
+ * Splits the given normalized letters into digraphs like @splitStream() does, adding the special
+ * character between doubles and carrying a possible unpaired last letter over to the next call.
+ * Doubles are rare in texts, so the letters are taken two at a time and a double is left to a
+ * predicted branch.
+ *
+ * @param stream - the stream to feed
+ * @param letters - the normalized letters to split
+ * @param nLetters - the amount of letters
+ * @param pairs - the buffer where to write the letters of the complete digraphs
+ *                (at least SPLIT_OUTPUT_SIZE(@nLetters) characters)
+ * @return the amount of digraphs written to @pairs
+ */
+static size_t splitLetters(CIPHER_STREAM *stream, const char *restrict letters, size_t nLetters,
+                           char *restrict pairs) {
+    const char specialCharacter = stream->table->specialCharacter;
+    char *start = pairs;
+    size_t i = 0, padding = 0;
+
+    if (stream->pendingLetter != 0 && nLetters > 0) {
+        *pairs++ = stream->pendingLetter;
+        if (stream->pendingLetter == letters[0]) {
+            *pairs++ = specialCharacter;
+            padding++;
+        } else {
+            *pairs++ = letters[0];
+            i = 1;
+        }
+        stream->pendingLetter = 0;
+    }
+    while (i + 1 < nLetters) {
+        char first = letters[i], second = letters[i + 1];
+        pairs[0] = first;
+        if (__builtin_expect(first != second, 1)) {
+            pairs[1] = second;
+            i += 2;
+        } else {
+            pairs[1] = specialCharacter;
+            padding++;
+            i++;
+        }
+        pairs += 2;
+    }
+    if (i < nLetters)
+        stream->pendingLetter = letters[i];
+
+    stream->letters += nLetters;
+    stream->padding += padding;
+    return (pairs - start) / 2;
+}
+
+/**
+ * Ends a stage of the processing of a portion of a file: if the stream has @stageStats, the time
+ * since the end of the previous stage is added to the time of the given stage, together with the
+ * hardware events counted meanwhile, if the stream has @counters too. While a trace is recorded,
+ * the stage is recorded as a span ("io" for reading and writing, "cpu" for the others).
+ *
+ * @param stream - the stream processing the file
+ * @param stage - the FILE_STAGE that ends
+ * @param time - the time the stage began, updated to the current one
+ */
+static void endStage(CIPHER_STREAM *stream, FILE_STAGE stage, uint64_t *time) {
+    if (stream->stageStats == NULL && !traceEnabled)
+        return;
+    uint64_t now = getMonotonicTime();
+    if (traceEnabled)
+        addTraceSpan(fileStageNames[stage], stage == STAGE_READ || stage == STAGE_WRITE ? "io" : "cpu", NULL, -1,
+                     *time, now);
+    if (stream->stageStats != NULL)
+        stream->stageStats->stageTimes[stage] += now - *time;
+    *time = now;
+    if (stream->counters != NULL)
+        markPerfCounters(stream->counters, stream->stageStats->stageCounts[stage]);
+}
+
+/**
+ * Reads @BUFFER characters at a time (or @bufferSize, if the stream has one) from the given input
+ * until the end of the file is reached (smaller files are read with a buffer of their own size). Every
+ * portion of the file is normalized, split into digraphs carrying a possible unpaired letter over to
+ * the next portion, and encoded or decoded in separate passes (see @normalizeText(), @splitLetters()
+ * and @applyDigraphs()), and the result is written to the given output.
+ * At the end the stream is finished, so its counters describe the whole file.
+ * If the stream has @stageStats, the time (and the hardware events) of every stage is added to them
+ * (see @endStage()): the clock and the counters are only read once per stage and portion, so they
+ * cost nothing per character. While a trace is recorded, every portion ("chunk") and every stage of
+ * it is recorded as a span.
+ * If an INTEGRITY is given, the checksums of the output are computed while it is written.
+ *
+ * @param in - the file to read from
+ * @param out - the file to write the encoded or decoded text to
+ * @param stream - the initialized CIPHER_STREAM to use
+ * @param integrity - the INTEGRITY collecting the checksums of the output, or NULL
+ */
+void processStream(FILE *in, FILE *out, CIPHER_STREAM *stream, INTEGRITY *integrity) {
+    struct stat inputStat;
+    size_t bufferSize = stream->bufferSize > 0 ? stream->bufferSize : BUFFER;
+
+    if (fstat(fileno(in), &inputStat) == 0 && S_ISREG(inputStat.st_mode) && (size_t) inputStat.st_size < bufferSize)
+        bufferSize = (size_t) inputStat.st_size + 1;
+
+    char *text = stringMalloc(bufferSize);
+    char *letters = stringMalloc(bufferSize);
+    char *pairs = stringMalloc(SPLIT_OUTPUT_SIZE(bufferSize));
+    char *processedText = stringMalloc(STREAM_OUTPUT_SIZE(bufferSize));
+    size_t nCharRead, nDigraphs;
+    uint64_t time = getMonotonicTime(), portionTime;
+    int64_t portion = 0;
+
+    if (stream->counters != NULL)
+        markPerfCounters(stream->counters, NULL);
+    do {
+        portionTime = time;
+        nCharRead = fread(text, sizeof(char), bufferSize, in);
+        endStage(stream, STAGE_READ, &time);
+
+        size_t nLetters = normalizeText(stream->table, text, nCharRead, letters);
+        endStage(stream, STAGE_NORMALIZE, &time);
+
+        stream->bytesIn += nCharRead;
+        nDigraphs = nCharRead > 0 ? splitLetters(stream, letters, nLetters, pairs) : finishSplitStream(stream, pairs);
+        endStage(stream, STAGE_DOUBLING, &time);
+
+        size_t nCharProcessed = applyDigraphs(stream, pairs, nDigraphs, processedText);
+        endStage(stream, STAGE_CIPHER, &time);
+
+        fwrite(processedText, sizeof(char), nCharProcessed, out);
+        if (integrity != NULL)
+            updateIntegrity(integrity, processedText, nCharProcessed);
+        endStage(stream, STAGE_WRITE, &time);
+        if (traceEnabled)
+            addTraceSpan("chunk", "chunk", NULL, portion, portionTime, time);
+        portion++;
+    } while (nCharRead > 0);
+
+    free(text);
+    free(letters);
+    free(pairs);
+    free(processedText);
+}
+
+/**
+ * Checks whether the two given tables normalize and split the text in the same way, that is
+ * whether they have the same normalized version of every character and the same special character.
+ * Only the encoded/decoded digraphs can differ between such tables.
+ *
+ * @return 1 if the tables split the text in the same way, 0 otherwise
+ */
+int haveSameNormalization(const CIPHER_TABLE *first, const CIPHER_TABLE *second) {
+    return first->specialCharacter == second->specialCharacter &&
+           memcmp(first->letters, second->letters, sizeof(first->letters)) == 0;
+}
+
+/**
+ * Normalizes @size characters of the given input and splits them into digraphs exactly like
+ * @feedStream(), but the digraphs are not encoded/decoded: their two normalized letters are
+ * written to @pairs, so that the same split can be applied to many tables with @applyDigraphs().
+ * The stream counts the characters, the letters and the padding, while the digraphs and the
+ * output are counted by @applyDigraphs().
+ * @pairs must be able to contain at least SPLIT_OUTPUT_SIZE(@size) characters.
+ *
+ * @param stream - the stream to feed
+ * @param in - the characters to process
+ * @param size - the amount of characters to process
+ * @param pairs - the buffer where to write the letters of the complete digraphs
+ * @return the amount of digraphs written to @pairs
+ */
+size_t splitStream(CIPHER_STREAM *stream, const char *in, size_t size, char *pairs) {
+    const CIPHER_TABLE *table = stream->table;
+    const char specialCharacter = table->specialCharacter;
+    char pending = stream->pendingLetter;
+    char *start = pairs;
+    size_t letters = 0, padding = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        char letter = table->letters[(unsigned char) in[i]];
+        if (letter == 0) continue;
+        letters++;
+
+        if (pending == 0)
+            pending = letter;
+        else if (pending == letter) {
+            *pairs++ = pending;
+            *pairs++ = specialCharacter;
+            padding++;
+        } else {
+            *pairs++ = pending;
+            *pairs++ = letter;
+            pending = 0;
+        }
+    }
+
+    stream->pendingLetter = pending;
+    stream->letters += letters;
+    stream->padding += padding;
+    stream->bytesIn += size;
+    return (pairs - start) / 2;
+}
+
+/**
+ * Ends the split of the given stream: if there is an unpaired letter left, it is written to
+ * @pairs together with the special character.
+ *
+ * @param stream - the stream to finish
+ * @param pairs - the buffer where to write the last digraph (at least 2 characters)
+ * @return the amount of digraphs written to @pairs (0 or 1)
+ */
+size_t finishSplitStream(CIPHER_STREAM *stream, char *pairs) {
+    if (stream->pendingLetter == 0)
+        return 0;
+    pairs[0] = stream->pendingLetter;
+    pairs[1] = stream->table->specialCharacter;
+    stream->padding++;
+    stream->pendingLetter = 0;
+    return 1;
+}
+
+/**
+ * Encodes/decodes the given digraphs, produced by @splitStream(), with the table of the given
+ * stream and writes them to @out with the same layout of @feedStream().
+ * @out must be able to contain at least 3 * @nDigraphs characters.
+ *
+ * @param stream - the stream whose table and counters have to be used
+ * @param pairs - the letters of the digraphs to encode/decode
+ * @param nDigraphs - the amount of digraphs to encode/decode
+ * @param out - the buffer where to write the encoded/decoded digraphs
+ * @return the amount of characters written to @out
+ */
+size_t applyDigraphs(CIPHER_STREAM *stream, const char *pairs, size_t nDigraphs, char *out) {
+    const CIPHER_TABLE *table = stream->table;
+    char *start = out;
+    size_t i = 0;
+
+    if (nDigraphs > 0 && stream->digraphs == 0) {
+        out = writeDigraph(stream, out, pairs[0], pairs[1]);
+        i = 1;
+    }
+    stream->digraphs += nDigraphs - i;
+    for (; i < nDigraphs; i++, out += 3) {
+        const char *digraph = table->digraphs[pairs[2 * i] - 'A'][pairs[2 * i + 1] - 'A'];
+        out[0] = ' ';
+        out[1] = digraph[0];
+        out[2] = digraph[1];
+    }
+    stream->bytesOut += out - start;
+    return out - start;
+}
+
+/**
+ * Reads the given input once, like @processStream(), and writes its encoded/decoded version
+ * with the table of every given stream to the corresponding output.
+ * The input is normalized and split into digraphs once for every group of streams whose tables
+ * have the same normalization (usually all of them), and only the lookup of the digraphs is
+ * repeated for every table. At the end every stream has the counters of the whole file.
+ *
+ * @param in - the file to read from
+ * @param out - the files to write the encoded or decoded text to (one for every stream)
+ * @param streams - the initialized CIPHER_STREAMs to use
+ * @param nStreams - the amount of streams
+ */
+void processStreamFanOut(FILE *in, FILE **out, CIPHER_STREAM *streams, int nStreams) {
+    struct stat inputStat;
+    size_t bufferSize = BUFFER;
+
+    if (fstat(fileno(in), &inputStat) == 0 && S_ISREG(inputStat.st_mode) && inputStat.st_size < BUFFER)
+        bufferSize = (size_t) inputStat.st_size + 1;
+
+    char *text = stringMalloc(bufferSize);
+    char *pairs = stringMalloc(SPLIT_OUTPUT_SIZE(bufferSize));
+    char *processedText = stringMalloc(STREAM_OUTPUT_SIZE(bufferSize));
+    int *group = memoryMalloc(nStreams * sizeof(int));
+    size_t nCharRead, nDigraphs;
+
+    for (int i = 0; i < nStreams; i++) {
+        group[i] = i;
+        for (int j = 0; j < i && group[i] == i; j++)
+            if (group[j] == j && haveSameNormalization(streams[i].table, streams[j].table))
+                group[i] = j;
+    }
+
+    do {
+        nCharRead = fread(text, sizeof(char), bufferSize, in);
+        for (int i = 0; i < nStreams; i++) {
+            if (group[i] != i)
+                continue;
+            nDigraphs = nCharRead > 0 ? splitStream(&streams[i], text, nCharRead, pairs)
+                                      : finishSplitStream(&streams[i], pairs);
+            for (int j = i; j < nStreams; j++)
+                if (group[j] == i)
+                    fwrite(processedText, sizeof(char), applyDigraphs(&streams[j], pairs, nDigraphs, processedText),
+                           out[j]);
+        }
+    } while (nCharRead > 0);
+
+    for (int i = 0; i < nStreams; i++) {
+        streams[i].bytesIn = streams[group[i]].bytesIn;
+        streams[i].letters = streams[group[i]].letters;
+        streams[i].padding = streams[group[i]].padding;
+    }
+
+    free(text);
+    free(pairs);
+    free(processedText);
+    free(group);
+}
+
+/**
+ * Copies the counters of the given stream to the given FILE_STATS.
+ *
+ * @param stream - the stream whose counters have to be copied
+ * @param stats - the FILE_STATS to fill
+ */
+void getStreamStats(const CIPHER_STREAM *stream, FILE_STATS *stats) {
+    stats->bytesIn = stream->bytesIn;
+    stats->bytesOut = stream->bytesOut;
+    stats->letters = stream->letters;
+    stats->digraphs = stream->digraphs;
+    stats->padding = stream->padding;
+}
@@ -0,0 +1,55 @@
+
+#ifndef PLAYFAIR_STREAMMANAGER_H
+#define PLAYFAIR_STREAMMANAGER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "cipherManager.h"
+#include "integrityManager.h"
+
+/**
+ * The maximum amount of output characters produced by feeding @n input characters
+ * to a CIPHER_STREAM (plus the final digraph written when the stream is finished).
+ */
+#define STREAM_OUTPUT_SIZE(n) (3 * (n) + 3)
+
+/**
+ * The maximum amount of normalized digraph letters produced by splitting @n input characters
+ * (plus the final digraph produced when the split is finished).
+ */
+#define SPLIT_OUTPUT_SIZE(n) (2 * (n) + 2)
+
+typedef struct {
+    const CIPHER_TABLE *table;
+    char pendingLetter;
+    size_t bytesIn;
+    size_t letters;
+    size_t digraphs;
+    size_t padding;
+    size_t bytesOut;
+    FILE_STATS *stageStats;
+    PERF_COUNTERS *counters;
+    size_t bufferSize;
+} CIPHER_STREAM;
+
+void initStream(CIPHER_STREAM *stream, const CIPHER_TABLE *table);
+
+size_t feedStream(CIPHER_STREAM *stream, const char *in, size_t size, char *out);
+
+size_t finishStream(CIPHER_STREAM *stream, char *out);
+
+void processStream(FILE *in, FILE *out, CIPHER_STREAM *stream, INTEGRITY *integrity);
+
+int haveSameNormalization(const CIPHER_TABLE *first, const CIPHER_TABLE *second);
+
+size_t splitStream(CIPHER_STREAM *stream, const char *in, size_t size, char *pairs);
+
+size_t finishSplitStream(CIPHER_STREAM *stream, char *pairs);
+
+size_t applyDigraphs(CIPHER_STREAM *stream, const char *pairs, size_t nDigraphs, char *out);
+
+void processStreamFanOut(FILE *in, FILE **out, CIPHER_STREAM *streams, int nStreams);
+
+void getStreamStats(const CIPHER_STREAM *stream, FILE_STATS *stats);
+
+#endif //PLAYFAIR_STREAMMANAGER_H
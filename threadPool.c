@@ -0,0 +1,135 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "threadPool.h"
+#include "utils.h"
+
+/**
+ * The body of every worker thread of the pool: it waits for new tasks and executes them
+ * one at a time until the pool is destroyed and there are no more queued tasks.
+ *
+ * @param argument - the THREAD_POOL the worker belongs to
+ * @return NULL
+ */
+static void *workerThread(void *argument) {
+    THREAD_POOL *pool = argument;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->head == NULL && !pool->stopping)
+            pthread_cond_wait(&pool->taskAvailable, &pool->lock);
+        if (pool->head == NULL)
+            break;
+
+        TASK *task = pool->head;
+        pool->head = task->next;
+        if (pool->head == NULL)
+            pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        task->function(task->argument);
+        free(task);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pendingTasks == 0)
+            pthread_cond_broadcast(&pool->idle);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * Creates a new THREAD_POOL with the given amount of worker threads (at least one).
+ * If the allocation or the creation of a thread fails, an error is printed and the program ends.
+ *
+ * @param nThreads - the amount of worker threads to start
+ * @return a pointer to the new THREAD_POOL
+ */
+THREAD_POOL *createThreadPool(size_t nThreads) {
+    THREAD_POOL *pool = memoryCalloc(1, sizeof(THREAD_POOL));
+    if (nThreads == 0) nThreads = 1;
+    pool->threads = memoryCalloc(nThreads, sizeof(pthread_t));
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->taskAvailable, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (pool->nThreads = 0; pool->nThreads < nThreads; pool->nThreads++) {
+        if (pthread_create(&pool->threads[pool->nThreads], NULL, workerThread, pool) != 0) {
+            fprintf(stderr, "\nERROR: the creation of a worker thread has failed\n\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+/**
+ * Adds a new task to the queue of the given pool. The task will be executed by the first
+ * worker thread available.
+ *
+ * @param pool - the pool that has to execute the task
+ * @param function - the function to execute
+ * @param argument - the argument to pass to the function
+ */
+void submitTask(THREAD_POOL *pool, TASK_FUNCTION function, void *argument) {
+    TASK *task = memoryMalloc(sizeof(TASK));
+    task->function = function;
+    task->argument = argument;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail != NULL)
+        pool->tail->next = task;
+    else pool->head = task;
+    pool->tail = task;
+    pool->pendingTasks++;
+    pthread_cond_signal(&pool->taskAvailable);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Waits until every task submitted to the given pool has been executed.
+ *
+ * @param pool - the pool to wait for
+ */
+void waitThreadPool(THREAD_POOL *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pendingTasks > 0)
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Executes all the tasks left in the queue of the given pool, then stops its worker
+ * threads and frees it.
+ *
+ * @param pool - the pool to destroy
+ */
+void destroyThreadPool(THREAD_POOL *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->taskAvailable);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->nThreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->taskAvailable);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->threads);
+    free(pool);
+}
+
+/**
+ * Returns the amount of worker threads to use when it is not specified by the user,
+ * which is the number of processors currently online.
+ *
+ * @return the default amount of worker threads
+ */
+size_t getDefaultThreadCount() {
+    long nProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+    return nProcessors > 0 ? (size_t) nProcessors : 1;
+}
@@ -0,0 +1,38 @@
+
+#ifndef PLAYFAIR_THREADPOOL_H
+#define PLAYFAIR_THREADPOOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+typedef void (*TASK_FUNCTION)(void *argument);
+
+typedef struct TASK {
+    TASK_FUNCTION function;
+    void *argument;
+    struct TASK *next;
+} TASK;
+
+typedef struct {
+    pthread_t *threads;
+    size_t nThreads;
+    TASK *head;
+    TASK *tail;
+    size_t pendingTasks;
+    int stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t taskAvailable;
+    pthread_cond_t idle;
+} THREAD_POOL;
+
+THREAD_POOL *createThreadPool(size_t nThreads);
+
+void submitTask(THREAD_POOL *pool, TASK_FUNCTION function, void *argument);
+
+void waitThreadPool(THREAD_POOL *pool);
+
+void destroyThreadPool(THREAD_POOL *pool);
+
+size_t getDefaultThreadCount();
+
+#endif //PLAYFAIR_THREADPOOL_H
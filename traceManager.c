@@ -0,0 +1,175 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "traceManager.h"
+#include "utils.h"
+#include "printer.h"
+
+typedef struct {
+    const char *name;
+    const char *category;
+    const char *detail;
+    int64_t index;
+    uint64_t start;
+    uint64_t end;
+} TRACE_SPAN;
+
+typedef struct TRACE_BUFFER {
+    TRACE_SPAN *spans;
+    size_t nSpans;
+    size_t capacity;
+    int threadId;
+    struct TRACE_BUFFER *next;
+} TRACE_BUFFER;
+
+/**
+ * Whether the spans are recorded: every caller checks it before reading the clock, so a run
+ * without a trace only pays a predictable branch.
+ */
+int traceEnabled = 0;
+
+/**
+ * The buffers of all the threads that recorded spans, most recent first.
+ */
+static TRACE_BUFFER *traceBuffers = NULL;
+
+/**
+ * The amount of threads that recorded spans, which gives the ID of the next one.
+ */
+static int nTraceThreads = 0;
+
+/**
+ * The time the trace started, which is the origin of its timestamps.
+ */
+static uint64_t traceStartTime;
+
+/**
+ * The buffer of the calling thread, or NULL if it has not recorded any span yet.
+ */
+static __thread TRACE_BUFFER *threadBuffer = NULL;
+
+/**
+ * Returns the current value of the monotonic clock in nanoseconds, the clock of the spans.
+ */
+uint64_t getTraceTime() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * Returns the buffer of the calling thread, creating it the first time: the new buffer is pushed
+ * on the list of the buffers with an atomic compare-and-swap, so no thread ever waits for another
+ * one to record its spans.
+ */
+static TRACE_BUFFER *getThreadBuffer() {
+    if (threadBuffer != NULL)
+        return threadBuffer;
+
+    TRACE_BUFFER *buffer = memoryCalloc(1, sizeof(TRACE_BUFFER));
+    buffer->threadId = __atomic_fetch_add(&nTraceThreads, 1, __ATOMIC_RELAXED);
+    buffer->next = __atomic_load_n(&traceBuffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&traceBuffers, &buffer->next, buffer, 1, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED));
+    threadBuffer = buffer;
+    return buffer;
+}
+
+/**
+ * Starts recording the spans of all the threads. The calling thread is the main thread of the
+ * trace (ID 0).
+ */
+void startTrace() {
+    traceStartTime = getTraceTime();
+    traceEnabled = 1;
+    getThreadBuffer();
+}
+
+/**
+ * Records a span of the calling thread in its own buffer. The given strings are not copied, so
+ * they must be valid until the trace is written.
+ *
+ * @param name - the name of the span
+ * @param category - the category of the span (e.g. "io")
+ * @param detail - the file the span refers to, or NULL
+ * @param index - the index of the file or of the portion of the file the span refers to, or -1
+ * @param start - the time the span began (see @getTraceTime())
+ * @param end - the time the span ended
+ */
+void addTraceSpan(const char *name, const char *category, const char *detail, int64_t index, uint64_t start,
+                  uint64_t end) {
+    TRACE_BUFFER *buffer = getThreadBuffer();
+
+    if (buffer->nSpans == buffer->capacity) {
+        buffer->capacity = buffer->capacity == 0 ? 1024 : buffer->capacity * 2;
+        buffer->spans = memoryRealloc(buffer->spans, buffer->capacity * sizeof(TRACE_SPAN));
+    }
+    TRACE_SPAN *span = &buffer->spans[buffer->nSpans++];
+    span->name = name;
+    span->category = category;
+    span->detail = detail;
+    span->index = index;
+    span->start = start;
+    span->end = end;
+}
+
+/**
+ * Writes all the recorded spans to the given file in the Chrome trace event format (complete
+ * "X" events, with timestamps in microseconds from the start of the trace), which can be opened
+ * in Perfetto or chrome://tracing, and stops the trace. Every thread gets a name: "main" or
+ * "worker <n>". It must be called when the other threads no longer record spans (e.g. after their
+ * pool is destroyed), and it frees all the buffers.
+ *
+ * @param path - the path of the file to write
+ * @return 0 if the trace was written, -1 otherwise
+ */
+int writeTrace(const char *path) {
+    FILE *file = fopen(path, "w");
+    TRACE_BUFFER *buffer = __atomic_load_n(&traceBuffers, __ATOMIC_ACQUIRE), *next;
+    int pid = (int) getpid(), first = 1;
+
+    traceEnabled = 0;
+    if (file != NULL) {
+        fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        for (TRACE_BUFFER *b = buffer; b != NULL; b = b->next) {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                    first ? "" : ",\n", pid, b->threadId);
+            if (b->threadId == 0)
+                fprintf(file, "\"main\"}}");
+            else fprintf(file, "\"worker %d\"}}", b->threadId);
+            first = 0;
+            for (size_t s = 0; s < b->nSpans; s++) {
+                const TRACE_SPAN *span = &b->spans[s];
+                fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,"
+                              "\"dur\":%.3f,\"args\":{", span->name, span->category, pid, b->threadId,
+                        (double) (span->start - traceStartTime) / 1e3, (double) (span->end - span->start) / 1e3);
+                if (span->detail != NULL) {
+                    fprintf(file, "\"input\":");
+                    printJsonString(file, span->detail);
+                }
+                if (span->index >= 0)
+                    fprintf(file, "%s\"index\":%lld", span->detail != NULL ? "," : "", (long long) span->index);
+                fprintf(file, "}}");
+            }
+        }
+        fprintf(file, "\n]}\n");
+    }
+    int failed = file == NULL || ferror(file);
+    if (file != NULL)
+        failed |= fclose(file) != 0;
+
+    for (; buffer != NULL; buffer = next) {
+        next = buffer->next;
+        free(buffer->spans);
+        free(buffer);
+    }
+    traceBuffers = NULL;
+    nTraceThreads = 0;
+    threadBuffer = NULL;
+    if (failed)
+        fprintf(stderr, "\nERROR: the trace file '%s' cannot be written!\n\n", path);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,18 @@
+
+#ifndef PLAYFAIR_TRACEMANAGER_H
+#define PLAYFAIR_TRACEMANAGER_H
+
+#include <stdint.h>
+
+extern int traceEnabled;
+
+void startTrace();
+
+uint64_t getTraceTime();
+
+void addTraceSpan(const char *name, const char *category, const char *detail, int64_t index, uint64_t start,
+                  uint64_t end);
+
+int writeTrace(const char *path);
+
+#endif //PLAYFAIR_TRACEMANAGER_H
@@ -7,6 +7,15 @@
 #include "utils.h"
 #include "fileManager.h"
 
+#ifdef PLAYFAIR_ALLOC_PROFILE
+#undef stringMalloc
+#undef stringRealloc
+#undef stringCalloc
+#undef memoryMalloc
+#undef memoryRealloc
+#undef memoryCalloc
+#endif
+
 /**
  * Allocates a new string of the given @size (comprehensive of the '\0')
  * and returns a pointer to the first element.
@@ -42,6 +51,76 @@ char *stringRealloc(char *in, size_t size) {
     return reallocatedString;
 }
 
+/**
+ * Allocates a new string of the given @size (comprehensive of the '\0') filled with '\0'
+ * and returns a pointer to the first element.
+ * If the allocation fails, an error occurs and the program ends.
+ *
+ * @param size - the length of the string to allocate
+ * @return a pointer to the first element of the allocated string
+ */
+char *stringCalloc(size_t size) {
+    char *newString = (char *) calloc(size, sizeof(char));
+    if (newString == NULL) {
+        fprintf(stderr, "\nERROR: The memory allocation has failed\n\n");
+        exit(EXIT_FAILURE);
+    }
+    return newString;
+}
+
+/**
+ * Allocates a new block of the given @size (in bytes), for any type,
+ * and returns a pointer to it.
+ * If the allocation fails, an error occurs and the program ends.
+ *
+ * @param size - the amount of bytes to allocate
+ * @return a pointer to the allocated block
+ */
+void *memoryMalloc(size_t size) {
+    void *block = malloc(size);
+    if (block == NULL) {
+        fprintf(stderr, "\nERROR: The memory allocation has failed\n\n");
+        exit(EXIT_FAILURE);
+    }
+    return block;
+}
+
+/**
+ * Resizes the given block to the given @size (in bytes), keeping its content,
+ * and returns a pointer to it.
+ * If the allocation fails, an error occurs and the program ends.
+ *
+ * @param in - the block to resize, or NULL to allocate a new one
+ * @param size - the new amount of bytes of the block
+ * @return a pointer to the resized block
+ */
+void *memoryRealloc(void *in, size_t size) {
+    void *block = realloc(in, size);
+    if (block == NULL) {
+        fprintf(stderr, "\nERROR: The memory allocation has failed\n\n");
+        exit(EXIT_FAILURE);
+    }
+    return block;
+}
+
+/**
+ * Allocates a new array of @count elements of the given @size, filled with zeros,
+ * and returns a pointer to its first element.
+ * If the allocation fails, an error occurs and the program ends.
+ *
+ * @param count - the amount of elements to allocate
+ * @param size - the size of every element
+ * @return a pointer to the first element of the allocated array
+ */
+void *memoryCalloc(size_t count, size_t size) {
+    void *block = calloc(count, size);
+    if (block == NULL) {
+        fprintf(stderr, "\nERROR: The memory allocation has failed\n\n");
+        exit(EXIT_FAILURE);
+    }
+    return block;
+}
+
 /**
  * Change every single letter of the given text to uppercase.
  *
@@ -70,76 +149,3 @@ void substituteMissingCharacter(char *text, char replacementCharacter) {
             text++;
         }
 }
-
-/**
- * Copies the given text to a new string two letter at a time and, if two equal
- * letters occur, a @specialCharacter is inserted between them.
- *
- * @param text - the text to check
- * @param specialCharacter - the special character to use to separate equal letters
- * @return a pointer to the first element of the new string
- */
-char *addSpecialCharactersBetweenDoubles(char *text, char specialCharacter) {
-    size_t textSize = strlen(text);
-    char *processedText = stringMalloc(textSize + 1);
-    int counter = 0;
-
-    while (*text != '\0') {
-        processedText[counter++] = *text;
-        text++;
-        if (*text != '\0') {
-            if (processedText[counter - 1] != *text) {
-                processedText[counter++] = *text;
-                text++;
-            } else {
-                textSize++;
-                processedText = stringRealloc(processedText, textSize + 1);
-                processedText[counter++] = specialCharacter;
-            }
-        }
-    }
-    processedText[counter] = '\0';
-    return processedText;
-}
-
-/**
- * The method receives a text whose length is odd and copies its content to
- * a new string and eventually adds one letter at the end to make the length
- * even.
- * The letter which is added at the end of the new string is either a new letter
- * read from the given file (if and only if there are any left and if such letter
- * is not equal to the last of the given text) or the @specialCharacter from the
- * given KEYFILE.
- *
- * @param text - the text that needs to be added a new letter
- * @param keyFile - the KEYFILE whose @specialCharacter needs to be used
- * @param file - the file where to read from possible next letter
- * @return a pointer to the first element of the new string
- */
-char *addLastLetter(char *text, KEYFILE keyFile, FILE *file) {
-    char *processedText = stringMalloc(strlen(text) + 2);
-    int counter = 0;
-
-    while (*text != '\0') {
-        processedText[counter++] = *text;
-        text++;
-    }
-
-    long currentPosition = ftell(file);
-    size_t fileSize = getFileSize(file);
-
-    if (currentPosition == fileSize) {
-        processedText[counter++] = keyFile.specialCharacter;
-    } else {
-        char nextLetter = readNextLetterFromFile(file, keyFile.replacementCharacter);
-        if (processedText[counter - 1] != nextLetter)
-            processedText[counter++] = nextLetter;
-        else {
-            processedText[counter++] = keyFile.specialCharacter;
-            fseek(file, -1, SEEK_CUR);
-        }
-    }
-
-    processedText[counter] = '\0';
-    return processedText;
-}
\ No newline at end of file
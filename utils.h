@@ -10,12 +10,18 @@ char *stringMalloc(size_t size);
 
 char *stringRealloc(char *in, size_t size);
 
+char *stringCalloc(size_t size);
+
+void *memoryMalloc(size_t size);
+
+void *memoryRealloc(void *in, size_t size);
+
+void *memoryCalloc(size_t count, size_t size);
+
 void toUpperString(char *text);
 
 void substituteMissingCharacter(char *text, char replacementCharacter);
 
-char *addSpecialCharactersBetweenDoubles(char *text, char specialCharacter);
-
-char *addLastLetter(char *text, KEYFILE keyFile, FILE *file);
+#include "allocManager.h"
 
 #endif //PLAYFAIR_UTIL_H
@@ -0,0 +1,318 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "verifyManager.h"
+#include "keyFileManager.h"
+#include "matrixManager.h"
+#include "cipherManager.h"
+#include "streamManager.h"
+#include "threadPool.h"
+#include "printer.h"
+#include "optionManager.h"
+#include "utils.h"
+
+/**
+ * The default amount of characters to read from each file at a time (if possible).
+ */
+#define VERIFY_BUFFER 500000
+
+typedef enum {
+    VERIFY_MATCH,
+    VERIFY_MISMATCH,
+    VERIFY_FAILED
+} VERIFY_STATUS;
+
+typedef struct {
+    const CIPHER_TABLE *encodeTable;
+    const CIPHER_TABLE *decodeTable;
+    OUTPUT_MODE output;
+} VERIFIER;
+
+typedef struct {
+    const VERIFIER *verifier;
+    int index;
+    char *plainPath;
+    char *cipherPath;
+    VERIFY_STATUS status;
+    uint64_t digraphs;
+    uint64_t plainOffset;
+    uint64_t cipherOffset;
+    char expected[3];
+    char found[3];
+} VERIFY_JOB;
+
+typedef struct {
+    FILE *file;
+    CIPHER_STREAM stream;
+    size_t bufferSize;
+    char *text;
+    char *pairs;
+    size_t nPairs;
+    size_t position;
+    int finished;
+} PAIR_READER;
+
+/**
+ * Opens the given file and prepares to split it into digraphs with the given table.
+ *
+ * @return 0 if the file was opened, -1 otherwise
+ */
+static int openPairReader(PAIR_READER *reader, const char *path, const CIPHER_TABLE *table) {
+    struct stat fileStat;
+
+    memset(reader, 0, sizeof(PAIR_READER));
+    if ((reader->file = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "\nERROR: the specified file:\n\n'%s'\n\ndoes not exist!\n\n", path);
+        return -1;
+    }
+    reader->bufferSize = VERIFY_BUFFER;
+    if (fstat(fileno(reader->file), &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size < VERIFY_BUFFER)
+        reader->bufferSize = (size_t) fileStat.st_size + 1;
+    reader->text = stringMalloc(reader->bufferSize);
+    reader->pairs = stringMalloc(SPLIT_OUTPUT_SIZE(reader->bufferSize));
+    initStream(&reader->stream, table);
+    return 0;
+}
+
+/**
+ * Makes sure that the given reader has some digraphs left to compare, reading and splitting the
+ * next portion of its file if all the previous digraphs were compared.
+ *
+ * @return 1 if there are digraphs to compare, 0 if the file is over
+ */
+static int fillPairReader(PAIR_READER *reader) {
+    while (reader->position == reader->nPairs) {
+        size_t nCharRead = fread(reader->text, sizeof(char), reader->bufferSize, reader->file);
+
+        if (nCharRead > 0)
+            reader->nPairs = splitStream(&reader->stream, reader->text, nCharRead, reader->pairs);
+        else if (!reader->finished) {
+            reader->nPairs = finishSplitStream(&reader->stream, reader->pairs);
+            reader->finished = 1;
+        } else return 0;
+        reader->position = 0;
+    }
+    return 1;
+}
+
+/**
+ * Closes the file of the given reader and frees its buffers.
+ *
+ * @return 0 if the whole file was read without errors, -1 otherwise
+ */
+static int closePairReader(PAIR_READER *reader) {
+    int failed = 0;
+
+    if (reader->file != NULL) {
+        failed = ferror(reader->file);
+        fclose(reader->file);
+    }
+    free(reader->text);
+    free(reader->pairs);
+    return failed ? -1 : 0;
+}
+
+/**
+ * Finds the offset of the first letter of the digraph with the given index in the given file,
+ * splitting it again like @splitStream() does (this happens only once, after a divergence).
+ *
+ * @param path - the path of the file
+ * @param table - the table used to split the file
+ * @param index - the index of the digraph to find
+ * @return the offset of the digraph, or the size of the file if it has less digraphs
+ */
+static uint64_t findDigraphOffset(const char *path, const CIPHER_TABLE *table, uint64_t index) {
+    FILE *file = fopen(path, "r");
+    uint64_t offset = 0, pendingOffset = 0, digraphs = 0;
+    char pending = 0;
+    int c;
+
+    if (file == NULL)
+        return 0;
+    for (; (c = getc(file)) != EOF; offset++) {
+        char letter = table->letters[(unsigned char) c];
+        if (letter == 0) continue;
+
+        if (pending == 0) {
+            pending = letter;
+            pendingOffset = offset;
+        } else if (digraphs++ == index) {
+            fclose(file);
+            return pendingOffset;
+        } else if (pending == letter)
+            pendingOffset = offset;
+        else pending = 0;
+    }
+    fclose(file);
+    return pending != 0 && digraphs == index ? pendingOffset : offset;
+}
+
+/**
+ * Prints the result of the given verification, depending on the output mode.
+ */
+static void printVerifyJob(VERIFY_JOB *job) {
+    static const char *statusNames[] = {"match", "mismatch", "failed"};
+
+    if (job->verifier->output == OUTPUT_QUIET)
+        return;
+    flockfile(stdout);
+    if (job->verifier->output == OUTPUT_JSON) {
+        printf("{\"index\":%d,\"plain\":", job->index + 1);
+        printJsonString(stdout, job->plainPath);
+        printf(",\"cipher\":");
+        printJsonString(stdout, job->cipherPath);
+        printf(",\"status\":\"%s\",\"digraphs\":%llu", statusNames[job->status], (unsigned long long) job->digraphs);
+        if (job->status == VERIFY_MISMATCH) {
+            printf(",\"plain_offset\":%llu,\"cipher_offset\":%llu,\"expected\":",
+                   (unsigned long long) job->plainOffset, (unsigned long long) job->cipherOffset);
+            printJsonString(stdout, job->expected);
+            printf(",\"found\":");
+            printJsonString(stdout, job->found);
+        }
+        printf("}\n");
+    } else {
+        printf("\npair %d: %s <-> %s\n", job->index + 1, job->plainPath, job->cipherPath);
+        if (job->status == VERIFY_MATCH)
+            printf("OK (%llu digraphs)\n", (unsigned long long) job->digraphs);
+        else if (job->status == VERIFY_MISMATCH)
+            printf("MISMATCH at digraph %llu (plaintext offset %llu, ciphertext offset %llu): expected '%s', found '%s'\n",
+                   (unsigned long long) job->digraphs, (unsigned long long) job->plainOffset,
+                   (unsigned long long) job->cipherOffset, job->expected, job->found);
+        else printf("FAILED\n");
+    }
+    funlockfile(stdout);
+}
+
+/**
+ * Verifies that a ciphertext decodes back to its plaintext, without writing anything to disk.
+ * Both files are streamed at the same time: the plaintext is normalized and split into digraphs
+ * with the same rules of the encoding (special characters between doubles and at the end), the
+ * ciphertext is split like the decoding does and its digraphs are decoded through the table,
+ * and the two sequences of digraphs are compared in memory.
+ * At the first divergence (a different digraph or a file with more digraphs than the other),
+ * the index of the digraph and its offset in both files are recorded.
+ *
+ * @param argument - the VERIFY_JOB describing the two files
+ */
+static void runVerifyJob(void *argument) {
+    VERIFY_JOB *job = argument;
+    const CIPHER_TABLE *decodeTable = job->verifier->decodeTable;
+    PAIR_READER plain = {NULL}, cipher = {NULL};
+    int hasPlain = 0, hasCipher = 0;
+
+    job->status = VERIFY_FAILED;
+    if (openPairReader(&plain, job->plainPath, job->verifier->encodeTable) == 0 &&
+        openPairReader(&cipher, job->cipherPath, decodeTable) == 0) {
+        job->status = VERIFY_MATCH;
+        while (job->status == VERIFY_MATCH && (hasPlain = fillPairReader(&plain)) & (hasCipher = fillPairReader(&cipher))) {
+            size_t n = plain.nPairs - plain.position < cipher.nPairs - cipher.position ? plain.nPairs - plain.position
+                                                                                     : cipher.nPairs - cipher.position;
+            const char *plainPairs = plain.pairs + 2 * plain.position, *cipherPairs = cipher.pairs + 2 * cipher.position;
+            size_t i = 0;
+
+            for (; i < n; i++) {
+                const char *decoded = decodeTable->digraphs[cipherPairs[2 * i] - 'A'][cipherPairs[2 * i + 1] - 'A'];
+                if (decoded[0] != plainPairs[2 * i] || decoded[1] != plainPairs[2 * i + 1]) {
+                    memcpy(job->expected, plainPairs + 2 * i, 2);
+                    memcpy(job->found, decoded, 2);
+                    job->status = VERIFY_MISMATCH;
+                    break;
+                }
+            }
+            job->digraphs += i;
+            plain.position += i;
+            cipher.position += i;
+        }
+        if (job->status == VERIFY_MATCH && hasPlain != hasCipher) {
+            if (hasPlain)
+                memcpy(job->expected, plain.pairs + 2 * plain.position, 2);
+            else memcpy(job->found, decodeTable->digraphs[cipher.pairs[2 * cipher.position] - 'A']
+                                                         [cipher.pairs[2 * cipher.position + 1] - 'A'], 2);
+            job->status = VERIFY_MISMATCH;
+        }
+    }
+    if ((closePairReader(&plain) | closePairReader(&cipher)) != 0)
+        job->status = VERIFY_FAILED;
+
+    if (job->status == VERIFY_MISMATCH) {
+        job->plainOffset = findDigraphOffset(job->plainPath, job->verifier->encodeTable, job->digraphs);
+        job->cipherOffset = findDigraphOffset(job->cipherPath, decodeTable, job->digraphs);
+    }
+    printVerifyJob(job);
+}
+
+/**
+ * Prints the correct syntax of the verify command and ends the program.
+ */
+static void printVerifyUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE VERIFICATION:\n");
+    fprintf(stderr, "'<playfair> verify [--jobs <n>] [--quiet|--json] <keyfile> <plain1> <cipher1> ... "
+                    "<plainn> <ciphern>'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Verifies that every given ciphertext decodes back to the corresponding plaintext with the given
+ * KEYFILE (see @runVerifyJob()), without temporary files. With the option "--jobs", multiple pairs
+ * of files are verified in parallel. The options "--quiet" and "--json" work like for the
+ * encode/decode commands.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return EXIT_SUCCESS if every ciphertext matches its plaintext, EXIT_FAILURE otherwise
+ */
+int startVerifier(int argc, char **argv) {
+    VERIFIER verifier = {NULL, NULL, OUTPUT_NORMAL};
+    size_t nJobs = 1;
+    int i = 2, nFailed = 0;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            nJobs = (size_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--quiet") == 0)
+            verifier.output = OUTPUT_QUIET;
+        else if (strcmp(argv[i], "--json") == 0)
+            verifier.output = OUTPUT_JSON;
+        else printVerifyUsage();
+    }
+    if (argc - i < 3 || (argc - i - 1) % 2 != 0)
+        printVerifyUsage();
+
+    KEYFILE keyFile = createKeyFileFromFile(argv[i]);
+    MATRIX playfairMatrix = createMatrix(keyFile);
+    CIPHER_TABLE encodeTable = createCipherTable(playfairMatrix, keyFile, "encode");
+    CIPHER_TABLE decodeTable = createCipherTable(playfairMatrix, keyFile, "decode");
+    int nPairs = (argc - i - 1) / 2;
+    VERIFY_JOB *jobs = memoryCalloc(nPairs, sizeof(VERIFY_JOB));
+    THREAD_POOL *pool = nJobs > 1 ? createThreadPool(nJobs) : NULL;
+
+    verifier.encodeTable = &encodeTable;
+    verifier.decodeTable = &decodeTable;
+    for (int p = 0; p < nPairs; p++) {
+        jobs[p].verifier = &verifier;
+        jobs[p].index = p;
+        jobs[p].plainPath = argv[i + 1 + 2 * p];
+        jobs[p].cipherPath = argv[i + 2 + 2 * p];
+        if (pool != NULL)
+            submitTask(pool, runVerifyJob, &jobs[p]);
+        else runVerifyJob(&jobs[p]);
+    }
+    if (pool != NULL) {
+        waitThreadPool(pool);
+        destroyThreadPool(pool);
+    }
+
+    for (int p = 0; p < nPairs; p++)
+        nFailed += jobs[p].status != VERIFY_MATCH;
+    if (verifier.output == OUTPUT_NORMAL)
+        printf("\nverified: %d, mismatched or failed: %d\n\n", nPairs - nFailed, nFailed);
+
+    free(jobs);
+    freeMatrix(playfairMatrix);
+    freeKeyFile(keyFile);
+    return nFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,7 @@
+
+#ifndef PLAYFAIR_VERIFYMANAGER_H
+#define PLAYFAIR_VERIFYMANAGER_H
+
+int startVerifier(int argc, char **argv);
+
+#endif //PLAYFAIR_VERIFYMANAGER_H
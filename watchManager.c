@@ -0,0 +1,234 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "watchManager.h"
+#include "keyFileManager.h"
+#include "matrixManager.h"
+#include "cipherManager.h"
+#include "streamManager.h"
+#include "fileManager.h"
+#include "threadPool.h"
+#include "utils.h"
+
+typedef struct {
+    char *inputPath;
+    char *outputDir;
+    char *command;
+    const CIPHER_TABLE *cipherTable;
+} WATCH_TASK;
+
+static volatile sig_atomic_t stopRequested = 0;
+static mode_t outputFileMode;
+
+/**
+ * Handles SIGINT and SIGTERM by requesting the watcher to stop.
+ */
+static void handleSignal(int signalNumber) {
+    (void) signalNumber;
+    stopRequested = 1;
+}
+
+/**
+ * Encodes or decodes a file of the watched directory. The result is written to a hidden
+ * temporary file of the output directory, which is renamed to the final output path only
+ * when it is complete, so that readers of the output directory never see partial files.
+ * Errors are reported without stopping the watcher.
+ *
+ * @param argument - the WATCH_TASK describing the file to process
+ */
+static void processWatchedFile(void *argument) {
+    WATCH_TASK *task = argument;
+    char *outputPath = getOutputFilePath(task->outputDir, task->inputPath, getExtension(task->command));
+    char *tempPath = stringMalloc(strlen(task->outputDir) + strlen(task->inputPath) + 16);
+    char *fileName = strrchr(task->inputPath, getSeparator()) + 1;
+    CIPHER_STREAM stream;
+    FILE *in = fopen(task->inputPath, "r"), *out = NULL;
+    int tempFd = -1;
+
+    sprintf(tempPath, "%s%c.%s.XXXXXX", task->outputDir, getSeparator(), fileName);
+    if (in == NULL || (tempFd = mkstemp(tempPath)) < 0 || (out = fdopen(tempFd, "w")) == NULL) {
+        fprintf(stderr, "ERROR: '%s' cannot be processed\n", task->inputPath);
+        if (tempFd >= 0) {
+            close(tempFd);
+            unlink(tempPath);
+        }
+    } else {
+        fchmod(tempFd, outputFileMode);
+        initStream(&stream, task->cipherTable);
+        processStream(in, out, &stream, NULL);
+        int failed = ferror(in) || ferror(out);
+        failed |= fclose(out) != 0;
+
+        if (failed) {
+            fprintf(stderr, "ERROR: '%s' cannot be processed\n", task->inputPath);
+            unlink(tempPath);
+        } else if (stream.letters == 0) {
+            fprintf(stderr, "ERROR: no valid text can be read from '%s'\n", task->inputPath);
+            unlink(tempPath);
+        } else if (rename(tempPath, outputPath) != 0) {
+            fprintf(stderr, "ERROR: '%s' cannot be renamed to '%s'\n", tempPath, outputPath);
+            unlink(tempPath);
+        } else printf("%s -> %s\n", task->inputPath, outputPath);
+    }
+
+    if (in != NULL)
+        fclose(in);
+    fflush(stdout);
+    free(tempPath);
+    free(outputPath);
+    free(task->inputPath);
+    free(task);
+}
+
+/**
+ * Submits the file with the given name of the watched directory to the worker pool.
+ * Hidden files (such as temporary files being written) are ignored.
+ */
+static void submitWatchedFile(THREAD_POOL *pool, WATCH_TASK *template, char *inputDir, const char *fileName) {
+    if (fileName[0] == '.')
+        return;
+
+    WATCH_TASK *task = memoryMalloc(sizeof(WATCH_TASK));
+    *task = *template;
+    task->inputPath = joinPath(inputDir, fileName);
+    submitTask(pool, processWatchedFile, task);
+}
+
+/**
+ * Submits all the regular files already contained in the watched directory, so that files
+ * dropped while the watcher was not running (or whose events were lost) are processed too.
+ */
+static void submitExistingFiles(THREAD_POOL *pool, WATCH_TASK *template, char *inputDir) {
+    DIR *directory = opendir(inputDir);
+    struct dirent *dirEntry;
+
+    while (directory != NULL && (dirEntry = readdir(directory)) != NULL) {
+        struct stat fileStat;
+        char *path = joinPath(inputDir, dirEntry->d_name);
+        if (stat(path, &fileStat) == 0 && S_ISREG(fileStat.st_mode))
+            submitWatchedFile(pool, template, inputDir, dirEntry->d_name);
+        free(path);
+    }
+    if (directory != NULL)
+        closedir(directory);
+}
+
+/**
+ * Prints the correct syntax of the watch command and ends the program.
+ */
+static void printWatchUsage() {
+    fprintf(stderr, "\nCORRECT SYNTAX FOR THE WATCHER:\n");
+    fprintf(stderr, "'<playfair> watch <encode|decode> <keyfile> <inputdir> <outputdir> [--threads <n>]'\n\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Starts watching the input directory: the KEYFILE, the MATRIX and the CIPHER_TABLE are built
+ * once, then every file that is completely written into (or moved into) the input directory is
+ * reported by inotify and encoded/decoded by a pool of worker threads into the output directory.
+ * If the queue of the events overflows (the events of the dropped files are lost), the input
+ * directory is scanned again like at startup.
+ * The input and output directories must be different. SIGINT and SIGTERM stop the watcher after
+ * the files already submitted have been processed.
+ *
+ * @param argc - the command's number of parameters
+ * @param argv - the command's list of the parameters
+ * @return the exit status of the program
+ */
+int startWatcher(int argc, char **argv) {
+#ifdef __linux__
+    size_t nThreads = getDefaultThreadCount();
+    char inputDir[PATH_MAX], outputDir[PATH_MAX];
+    char events[64 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+    sigset_t blockedSignals, originalSignals;
+    struct sigaction action;
+
+    if (argc != 6 && !(argc == 8 && strcmp(argv[6], "--threads") == 0))
+        printWatchUsage();
+    if (strcmp(argv[2], "encode") != 0 && strcmp(argv[2], "decode") != 0)
+        printWatchUsage();
+    if (argc == 8)
+        nThreads = (size_t) strtoul(argv[7], NULL, 10);
+    if (realpath(argv[4], inputDir) == NULL || realpath(argv[5], outputDir) == NULL) {
+        fprintf(stderr, "\nERROR: the input and output directories must exist!\n\n");
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(inputDir, outputDir) == 0) {
+        fprintf(stderr, "\nERROR: the input and output directories must be different!\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    KEYFILE keyFile = createKeyFileFromFile(argv[3]);
+    MATRIX playfairMatrix = createMatrix(keyFile);
+    CIPHER_TABLE cipherTable = createCipherTable(playfairMatrix, keyFile, argv[2]);
+    WATCH_TASK template = {NULL, outputDir, argv[2], &cipherTable};
+
+    outputFileMode = umask(0);
+    umask(outputFileMode);
+    outputFileMode = 0666 & ~outputFileMode;
+
+    int watchFd = inotify_init1(IN_CLOEXEC);
+    if (watchFd < 0 || inotify_add_watch(watchFd, inputDir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        perror("\nERROR: the input directory cannot be watched");
+        exit(EXIT_FAILURE);
+    }
+
+    sigemptyset(&blockedSignals);
+    sigaddset(&blockedSignals, SIGINT);
+    sigaddset(&blockedSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blockedSignals, &originalSignals);
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    THREAD_POOL *pool = createThreadPool(nThreads);
+    printf("watching '%s' (%s to '%s', %zu threads)\n", inputDir, argv[2], outputDir, pool->nThreads);
+    fflush(stdout);
+    submitExistingFiles(pool, &template, inputDir);
+
+    while (!stopRequested) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(watchFd, &readSet);
+
+        if (pselect(watchFd + 1, &readSet, NULL, NULL, NULL, &originalSignals) <= 0)
+            continue;
+        ssize_t size = read(watchFd, events, sizeof(events));
+        for (char *position = events; size > 0 && position < events + size;) {
+            struct inotify_event *event = (struct inotify_event *) position;
+            if (event->mask & IN_Q_OVERFLOW) {
+                fprintf(stderr, "WARNING: the event queue of '%s' overflowed, all its files are processed again\n",
+                        inputDir);
+                submitExistingFiles(pool, &template, inputDir);
+            } else if (event->len > 0 && (event->mask & IN_ISDIR) == 0)
+                submitWatchedFile(pool, &template, inputDir, event->name);
+            position += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    destroyThreadPool(pool);
+    close(watchFd);
+    freeMatrix(playfairMatrix);
+    freeKeyFile(keyFile);
+    return EXIT_SUCCESS;
+#else
+    (void) argc;
+    (void) argv;
+    fprintf(stderr, "\nERROR: the watch mode is only available on Linux (inotify)!\n\n");
+    return EXIT_FAILURE;
+#endif
+}
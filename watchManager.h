@@ -0,0 +1,7 @@
+
+#ifndef PLAYFAIR_WATCHMANAGER_H
+#define PLAYFAIR_WATCHMANAGER_H
+
+int startWatcher(int argc, char **argv);
+
+#endif //PLAYFAIR_WATCHMANAGER_H